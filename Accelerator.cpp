@@ -0,0 +1,198 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: Accelerator.cpp
+//  ========
+//  Source file for scene actor accelerator.
+
+#ifndef __ActorBVH_h
+#include "ActorBVH.h"
+#endif
+#ifndef __ActorGrid_h
+#include "ActorGrid.h"
+#endif
+#ifndef __ActorKdTree_h
+#include "ActorKdTree.h"
+#endif
+
+using namespace Graphics;
+
+
+//////////////////////////////////////////////////////////
+//
+// Accelerator implementation
+// ===========
+Accelerator*
+Accelerator::create(Type type)
+//[]---------------------------------------------------[]
+//|  Make an empty accelerator of a type                |
+//[]---------------------------------------------------[]
+{
+	switch (type)
+	{
+		case UniformGrid:
+			return new ActorGrid();
+		case KdTree:
+			return new ActorKdTree();
+		default:
+			return new ActorBVH();
+	}
+}
+
+const char*
+Accelerator::getName(Type type)
+//[]---------------------------------------------------[]
+//|  Get the name of a type                             |
+//[]---------------------------------------------------[]
+{
+	static const char* names[] =
+	{
+		"bvh",
+		"grid",
+		"kdtree"
+	};
+
+	return names[type];
+}
+
+BoundingBox*
+Accelerator::setActors(const Scene& scene)
+//[]---------------------------------------------------[]
+//|  Set the actors of a scene                          |
+//|  @return world bounds of the actors (to be deleted  |
+//|  by the caller), or null if there are none          |
+//[]---------------------------------------------------[]
+{
+	delete []actors;
+	actors = 0;
+	if ((numberOfActors = scene.getNumberOfActors()) == 0)
+		return 0;
+	actors = new Actor*[numberOfActors];
+
+	BoundingBox* bounds = new BoundingBox[numberOfActors];
+	int i = 0;
+
+	for (ActorIterator ait(scene.getActorIterator()); ait; i++)
+	{
+		actors[i] = ait++;
+		bounds[i] = actors[i]->getBoundingBox();
+	}
+	return bounds;
+}
+
+bool
+Accelerator::isBuiltFrom(const Scene& scene) const
+//[]---------------------------------------------------[]
+//|  Are the actors of a scene the ones built from?     |
+//[]---------------------------------------------------[]
+{
+	if (scene.getNumberOfActors() != numberOfActors)
+		return false;
+
+	int i = 0;
+
+	for (ActorIterator ait(scene.getActorIterator()); ait; i++)
+		if (ait++ != actors[i])
+			return false;
+	return true;
+}
+
+void
+Accelerator::setBuilt(double time, REAL cost, long memorySize)
+//[]---------------------------------------------------[]
+//|  Count a build in the statistics                    |
+//|  @param seconds spent                               |
+//|  @param SAH cost of the structure                   |
+//|  @param bytes taken by the structure                |
+//[]---------------------------------------------------[]
+{
+	statistics.lastUpdate = BVH::Rebuilt;
+	statistics.lastTime = time;
+	statistics.builds++;
+	statistics.buildTime += time;
+	statistics.cost = statistics.buildCost = cost;
+	statistics.memorySize = memorySize +
+		(long)numberOfActors * sizeof(Actor*);
+}
+
+void
+Accelerator::update(const Scene& scene, REAL)
+//[]---------------------------------------------------[]
+//|  Update the structure to a changed scene            |
+//|  @param the scene                                   |
+//|  @param ratio of the cost of the updated structure  |
+//|  to its cost when built beyond which it is rebuilt  |
+//[]---------------------------------------------------[]
+{
+	build(scene);
+}
+
+int
+Accelerator::intersect(const RayPacket& packet,
+	PacketHit& hit,
+	const Real4& maxDist) const
+//[]---------------------------------------------------[]
+//|  Closest packet/actor intersection                  |
+//|  @param the ray packet (input)                      |
+//|  @param information on intersections (output)       |
+//|  @param background distances                        |
+//|  @return mask of the active lanes which intersect   |
+//|  an actor                                           |
+//[]---------------------------------------------------[]
+{
+	int mask = 0;
+
+	hit.distance = maxDist;
+	for (int i = 0; i < RAY_PACKET_SIZE; i++)
+		if (!(packet.active & 1 << i) ||
+			!intersect(packet.rays[i], hit.info[i], maxDist[i]))
+			hit.info[i].object = 0;
+		else
+		{
+			hit.distance.set(i, hit.info[i].distance);
+			mask |= 1 << i;
+		}
+	return mask;
+}
+
+int
+Accelerator::occluded(const RayPacket& packet,
+	const Real4& maxDist,
+	Actor** occluder,
+	const Actor* skipped) const
+//[]---------------------------------------------------[]
+//|  Packet/actor occlusion query                       |
+//|  @param the ray packet                              |
+//|  @param distances beyond which hits do not count    |
+//|  @param the last actor hit, if any (optional output)|
+//|  @param actor not to be tested (optional)           |
+//|  @return mask of the active lanes which hit any     |
+//|  actor closer than maxDist                          |
+//[]---------------------------------------------------[]
+{
+	int mask = 0;
+
+	if (occluder != 0)
+		*occluder = 0;
+	for (int i = 0; i < RAY_PACKET_SIZE; i++)
+	{
+		Actor* actor;
+
+		if ((packet.active & 1 << i) &&
+			occluded(packet.rays[i], maxDist[i], &actor, skipped))
+		{
+			mask |= 1 << i;
+			if (occluder != 0)
+				*occluder = actor;
+		}
+	}
+	return mask;
+}
@@ -0,0 +1,301 @@
+#ifndef __Accelerator_h
+#define __Accelerator_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: Accelerator.h
+//  ========
+//  Class definition for scene actor accelerator.
+
+#ifndef __BVH_h
+#include "BVH.h"
+#endif
+#ifndef __Scene_h
+#include "Scene.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// Accelerator: scene actor accelerator class
+// ===========
+//
+// Base of the spatial structures over the actors of a scene which
+// find the actors hit by the rays of a RayTracer. An accelerator is
+// built from the world bounding boxes of the models of all actors of
+// a scene; the visibility of the actors is checked during traversal,
+// hence showing or hiding an actor does not require a rebuild. The
+// rays reaching an actor are tested against its model (see Actor).
+//
+// update() rebuilds the structure, unless a derived class knows
+// better. Packets are traced lane by lane, unless a derived class
+// traverses them as a whole.
+class Accelerator
+{
+public:
+	enum Type
+	{
+		Hierarchy, // bounding volume hierarchy (ActorBVH)
+		UniformGrid, // ActorGrid
+		KdTree, // ActorKdTree
+		NumberOfTypes
+	};
+
+	struct Statistics
+	{
+		BVH::Update lastUpdate;
+		double lastTime; // seconds spent by the last update
+		int builds; // full builds, including the ones by refit()
+		int refits; // refits, including the ones followed by a rebuild
+		int partialRebuilds;
+		double buildTime; // seconds spent by builds
+		double refitTime; // seconds spent by refits and rebuilds
+		REAL cost; // SAH cost of the structure
+		REAL buildCost; // SAH cost of the structure when built
+		long memorySize; // bytes taken by the structure
+
+		// Constructor
+		Statistics():
+			lastUpdate(BVH::Rebuilt),
+			lastTime(0),
+			builds(0),
+			refits(0),
+			partialRebuilds(0),
+			buildTime(0),
+			refitTime(0),
+			cost(0),
+			buildCost(0),
+			memorySize(0)
+		{
+			// do nothing
+		}
+
+	}; // Statistics
+
+	static Accelerator* create(Type);
+	static const char* getName(Type);
+
+	// Destructor
+	virtual ~Accelerator()
+	{
+		delete []actors;
+	}
+
+	virtual Type getType() const = 0;
+	virtual void build(const Scene&) = 0;
+	virtual void update(const Scene&, REAL);
+
+	int getNumberOfActors() const
+	{
+		return numberOfActors;
+	}
+
+	const Statistics& getStatistics() const
+	{
+		return statistics;
+	}
+
+	virtual bool intersect(const Ray&, IntersectInfo&, REAL) const = 0;
+	virtual int intersect(const RayPacket&, PacketHit&, const Real4&) const;
+	virtual bool occluded(const Ray&,
+		REAL,
+		Actor** = 0,
+		const Actor* = 0) const = 0;
+	virtual int occluded(const RayPacket&,
+		const Real4&,
+		Actor** = 0,
+		const Actor* = 0) const;
+
+protected:
+	class Intersector;
+	class PacketIntersector;
+	class OcclusionTester;
+	class PacketOcclusionTester;
+
+	Actor** actors;
+	int numberOfActors;
+	Statistics statistics;
+
+	// Constructor
+	Accelerator():
+		actors(0),
+		numberOfActors(0)
+	{
+		// do nothing
+	}
+
+	BoundingBox* setActors(const Scene&);
+	bool isBuiltFrom(const Scene&) const;
+	void setBuilt(double, REAL, long);
+
+private:
+	Accelerator(const Accelerator&);
+	Accelerator& operator =(const Accelerator&);
+
+}; // Accelerator
+
+
+//////////////////////////////////////////////////////////
+//
+// Accelerator::Intersector: actor intersector class
+// ========================
+//
+// Primitive intersectors of the traversals of the structures, where
+// a primitive is the index of an actor (see BVH).
+class Accelerator::Intersector
+{
+public:
+	// Constructor
+	Intersector(const Ray& aRay, Actor** anActors, IntersectInfo& aHit):
+		ray(aRay),
+		actors(anActors),
+		hit(aHit)
+	{
+		// do nothing
+	}
+
+	bool operator ()(int i, REAL& distance)
+	{
+		Actor* actor = actors[i];
+
+		if (!actor->isVisible)
+			return false;
+		if (!actor->intersect(ray, temp) ||
+			temp.distance >= distance)
+			return false;
+		hit = temp;
+		distance = temp.distance;
+		return true;
+	}
+
+private:
+	const Ray& ray;
+	Actor** actors;
+	IntersectInfo& hit;
+	IntersectInfo temp;
+
+}; // Accelerator::Intersector
+
+class Accelerator::PacketIntersector
+{
+public:
+	// Constructor
+	PacketIntersector(const RayPacket& aPacket,
+		Actor** anActors,
+		PacketHit& aHit):
+		packet(aPacket),
+		actors(anActors),
+		hit(aHit)
+	{
+		// do nothing
+	}
+
+	// distance is hit.distance, which is updated by the models
+	int operator ()(int i, int mask, Real4&)
+	{
+		Actor* actor = actors[i];
+
+		if (!actor->isVisible)
+			return 0;
+		return actor->intersect(packet, mask, hit);
+	}
+
+private:
+	const RayPacket& packet;
+	Actor** actors;
+	PacketHit& hit;
+
+}; // Accelerator::PacketIntersector
+
+class Accelerator::OcclusionTester
+{
+public:
+	// Constructor
+	OcclusionTester(const Ray& aRay, Actor** anActors, const Actor* aSkipped):
+		ray(aRay),
+		actors(anActors),
+		skipped(aSkipped),
+		occluder(0)
+	{
+		// do nothing
+	}
+
+	bool operator ()(int i, REAL& distance)
+	{
+		Actor* actor = actors[i];
+
+		if (!actor->isVisible || actor == skipped ||
+			!actor->occluded(ray, distance))
+			return false;
+		occluder = actor;
+		return true;
+	}
+
+	Actor* getOccluder() const
+	{
+		return occluder;
+	}
+
+private:
+	const Ray& ray;
+	Actor** actors;
+	const Actor* skipped;
+	Actor* occluder;
+
+}; // Accelerator::OcclusionTester
+
+class Accelerator::PacketOcclusionTester
+{
+public:
+	// Constructor
+	PacketOcclusionTester(const RayPacket& aPacket,
+		Actor** anActors,
+		const Actor* aSkipped):
+		packet(aPacket),
+		actors(anActors),
+		skipped(aSkipped),
+		occluder(0)
+	{
+		// do nothing
+	}
+
+	int operator ()(int i, int mask, Real4& distance)
+	{
+		Actor* actor = actors[i];
+
+		if (!actor->isVisible || actor == skipped)
+			return 0;
+		if ((mask = actor->occluded(packet, mask, distance)) != 0)
+			occluder = actor;
+		return mask;
+	}
+
+	// Get the last actor found blocking some lane
+	Actor* getOccluder() const
+	{
+		return occluder;
+	}
+
+private:
+	const RayPacket& packet;
+	Actor** actors;
+	const Actor* skipped;
+	Actor* occluder;
+
+}; // Accelerator::PacketOcclusionTester
+
+} // end namespace Graphics
+
+#endif // __Accelerator_h
@@ -12,12 +12,69 @@
 //  ========
 //  Source file for actor.
 
-#ifndef __Actor_h
-#include "Actor.h"
+#ifndef __Scene_h
+#include "Scene.h"
 #endif
 
 using namespace Graphics;
 
+//
+// Auxiliary functions
+//
+inline REAL
+objectRay(const Ray& ray, const Transf3& m, Ray& r)
+//[]---------------------------------------------------[]
+//|  Transform a ray into the space of a model          |
+//|  @param the ray                                     |
+//|  @param world to object transformation              |
+//|  @param the transformed ray, with unit direction    |
+//|  (output)                                           |
+//|  @return scale of the distances along the ray       |
+//[]---------------------------------------------------[]
+{
+	r = Ray(ray, m);
+
+	REAL s = r.direction.length();
+
+	r.direction *= Math::inverse(s);
+	return s;
+}
+
+inline Real4
+objectPacket(const RayPacket& packet, int mask, const Transf3& m, RayPacket& p)
+//[]---------------------------------------------------[]
+//|  Transform the rays of a packet into the space of a |
+//|  model                                              |
+//|  @param the ray packet                              |
+//|  @param mask of the lanes to be transformed         |
+//|  @param world to object transformation              |
+//|  @param the transformed packet (output)             |
+//|  @return scales of the distances along the rays     |
+//[]---------------------------------------------------[]
+{
+	Real4 s(1);
+	Ray r;
+
+	for (int i = 0; i < RAY_PACKET_SIZE; i++)
+		if (mask & 1 << i)
+		{
+			s.set(i, objectRay(packet.rays[i], m, r));
+			p.set(i, r);
+		}
+	p.pad();
+	return s;
+}
+
+inline bool
+isIdentity(const Transf3& m)
+{
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			if (m(i, j) != (i == j ? 1 : 0))
+				return false;
+	return true;
+}
+
 
 //////////////////////////////////////////////////////////
 //
@@ -34,6 +91,9 @@ Actor::Streamer::write(ObjectOutputStream& oos) const
 	writeBaseObject((SceneComponent*)getObject(), oos);
 	oos << getObject()->isVisible;
 	oos << getObject()->model;
+	oos << getObject()->transformed;
+	if (getObject()->transformed)
+		oos << getObject()->transform;
 }
 
 Serializable*
@@ -49,6 +109,17 @@ Actor::Streamer::read(ObjectInputStream& ois) const
 
 	ois >> model;
 	getObject()->model = model->makeUse();
+
+	bool transformed;
+
+	ois >> transformed;
+	if (transformed)
+	{
+		Transf3 t;
+
+		ois >> t;
+		getObject()->setTransform(t);
+	}
 	return getObject();
 }
 
@@ -59,3 +130,207 @@ Actor::~Actor()
 {
 	model->release();
 }
+
+BoundingBox
+Actor::getBoundingBox() const
+//[]----------------------------------------------------[]
+//|  Get the bounding box of the model in world space    |
+//[]----------------------------------------------------[]
+{
+	if (!transformed)
+		return model->getBoundingBox();
+	return BoundingBox(model->getBoundingBox(), transform);
+}
+
+bool
+Actor::intersect(const Ray& ray, IntersectInfo& hit) const
+//[]----------------------------------------------------[]
+//|  Intersect the model                                 |
+//|  @param the ray (in world space)                     |
+//|  @param information on intersection (output)         |
+//|  @return true if the ray intersects the model        |
+//[]----------------------------------------------------[]
+{
+	if (!transformed)
+	{
+		if (!model->intersect(ray, hit))
+			return false;
+		hit.instance = 0;
+		return true;
+	}
+
+	Ray r;
+	REAL s = objectRay(ray, inverse, r);
+
+	if (!model->intersect(r, hit))
+		return false;
+	hit.distance /= s;
+	hit.instance = this;
+	return true;
+}
+
+int
+Actor::intersect(const RayPacket& packet, int mask, PacketHit& hit) const
+//[]----------------------------------------------------[]
+//|  Intersect the model with a packet                   |
+//|  @param the ray packet (in world space)              |
+//|  @param mask of the lanes to be tested               |
+//|  @param closest hits of the lanes (input/output)     |
+//|  @return mask of the lanes whose hits were updated   |
+//[]----------------------------------------------------[]
+{
+	if (!transformed)
+	{
+		mask = model->intersect(packet, mask, hit);
+		for (int i = 0; i < RAY_PACKET_SIZE; i++)
+			if (mask & 1 << i)
+				hit.info[i].instance = 0;
+		return mask;
+	}
+
+	RayPacket p;
+	PacketHit temp;
+	Real4 s = objectPacket(packet, mask, inverse, p);
+
+	temp.distance = hit.distance * s;
+	if ((mask = model->intersect(p, mask, temp)) == 0)
+		return 0;
+	for (int i = 0; i < RAY_PACKET_SIZE; i++)
+		if (mask & 1 << i)
+		{
+			IntersectInfo& info = hit.info[i];
+
+			info = temp.info[i];
+			info.distance /= s[i];
+			info.instance = this;
+			hit.distance.set(i, info.distance);
+		}
+	return mask;
+}
+
+bool
+Actor::occluded(const Ray& ray, REAL maxDist) const
+//[]----------------------------------------------------[]
+//|  Occlusion query                                     |
+//|  @param the ray (in world space)                     |
+//|  @param distance beyond which hits do not count      |
+//|  @return true if the ray hits the model closer than  |
+//|  maxDist                                             |
+//[]----------------------------------------------------[]
+{
+	if (!transformed)
+		return model->occluded(ray, maxDist);
+
+	Ray r;
+	REAL s = objectRay(ray, inverse, r);
+
+	return model->occluded(r, maxDist * s);
+}
+
+int
+Actor::occluded(const RayPacket& packet,
+	int mask,
+	const Real4& maxDist) const
+//[]----------------------------------------------------[]
+//|  Packet occlusion query                              |
+//|  @param the ray packet (in world space)              |
+//|  @param mask of the lanes to be tested               |
+//|  @param distances beyond which hits do not count     |
+//|  @return mask of the lanes which hit the model       |
+//|  closer than maxDist                                 |
+//[]----------------------------------------------------[]
+{
+	if (!transformed)
+		return model->occluded(packet, mask, maxDist);
+
+	RayPacket p;
+	Real4 s = objectPacket(packet, mask, inverse, p);
+
+	return model->occluded(p, mask, maxDist * s);
+}
+
+Vec3
+Actor::normal(const IntersectInfo& hit) const
+//[]----------------------------------------------------[]
+//|  Normal at a hit of the actor in world space         |
+//[]----------------------------------------------------[]
+{
+	Vec3 N = model->normal(hit);
+
+	if (!transformed)
+		return N;
+
+	// normals are transformed by the transposed inverse
+	const Transf3& m = inverse;
+	REAL x = m(_X, _X) * N.x + m(_Y, _X) * N.y + m(_Z, _X) * N.z;
+	REAL y = m(_X, _Y) * N.x + m(_Y, _Y) * N.y + m(_Z, _Y) * N.z;
+	REAL z = m(_X, _Z) * N.x + m(_Y, _Z) * N.y + m(_Z, _Z) * N.z;
+
+	return Vec3(x, y, z).versor();
+}
+
+void
+Actor::setModel(Model& model)
+//[]----------------------------------------------------[]
+//|  Set the model of the actor                          |
+//[]----------------------------------------------------[]
+{
+	Model* old = this->model;
+	BoundingBox oldBox = getBoundingBox();
+
+	this->model = model.makeUse();
+	if (scene != 0)
+	{
+		BoundingBox box = getBoundingBox();
+
+		scene->addChange(old, oldBox, false);
+		scene->addChange(this->model, box, true);
+		scene->boundingBox.inflate(box);
+		scene->timestamp++;
+	}
+	old->release();
+}
+
+bool
+Actor::setTransform(const Transf3& t)
+//[]----------------------------------------------------[]
+//|  Set the object to world transformation of the model |
+//|  @param the transformation                           |
+//|  @return false if t is not invertible (the actor is  |
+//|  left as it is)                                      |
+//[]----------------------------------------------------[]
+{
+	Transf3 inverse;
+
+	if (!t.inverse(inverse))
+		return false;
+
+	BoundingBox oldBox = getBoundingBox();
+
+	transform = t;
+	this->inverse = inverse;
+	transformed = !isIdentity(t);
+	if (scene != 0)
+	{
+		BoundingBox box = getBoundingBox();
+
+		scene->addChange(model, oldBox, false);
+		scene->addChange(model, box, true);
+		scene->boundingBox.inflate(box);
+		scene->timestamp++;
+	}
+	return true;
+}
+
+void
+Actor::setVisible(bool visible)
+//[]----------------------------------------------------[]
+//|  Show or hide the actor                              |
+//[]----------------------------------------------------[]
+{
+	if (visible == isVisible)
+		return;
+	isVisible = visible;
+	if (scene != 0)
+		scene->addChange(model, getBoundingBox(), visible);
+}
@@ -36,16 +36,38 @@ namespace Graphics
 //
 // Actor: actor class
 // =====
+//
+// The changes of an actor in a scene must be made by its setters,
+// which notify the scene of them.
+//
+// An actor may place its model in the scene by an object to world
+// transformation, so that many actors (instances) share one model,
+// which is stored, and whose BVH is built, only once. The rays are
+// then transformed into the space of the model, with unit direction,
+// and the hits back into world space by the query methods below,
+// which should be used instead of the ones of the model.
 class Actor: public SceneComponent
 {
 public:
 	bool isVisible;
 
-	// Constructor
+	// Constructors
 	Actor(Model& model):
-		isVisible(true)
+		isVisible(true),
+		transformed(false)
+	{
+		this->model = model.makeUse();
+		transform.identity();
+		inverse.identity();
+	}
+	Actor(Model& model, const Transf3& t):
+		isVisible(true),
+		transformed(false)
 	{
 		this->model = model.makeUse();
+		transform.identity();
+		inverse.identity();
+		setTransform(t);
 	}
 
 	// Destructor
@@ -56,14 +78,35 @@ public:
 		return model;
 	}
 
-	void setModel(Model& model)
+	// Is the model placed by a transformation other than identity?
+	bool isTransformed() const
 	{
-		this->model->release();
-		this->model = model.makeUse();
+		return transformed;
+	}
+
+	// Get the object to world transformation of the model
+	const Transf3& getTransform() const
+	{
+		return transform;
 	}
 
+	BoundingBox getBoundingBox() const;
+
+	bool intersect(const Ray&, IntersectInfo&) const;
+	int intersect(const RayPacket&, int, PacketHit&) const;
+	bool occluded(const Ray&, REAL) const;
+	int occluded(const RayPacket&, int, const Real4&) const;
+	Vec3 normal(const IntersectInfo&) const;
+
+	void setModel(Model&);
+	bool setTransform(const Transf3&);
+	void setVisible(bool);
+
 protected:
 	Model* model;
+	Transf3 transform; // object to world
+	Transf3 inverse; // world to object
+	bool transformed;
 
 	DECLARE_DOUBLE_LIST_ELEMENT(Actor);
 	DECLARE_SERIALIZABLE(Actor);
@@ -75,6 +118,17 @@ protected:
 typedef DoubleListImp<Actor> Actors;
 typedef DoubleListIteratorImp<Actor> ActorIterator;
 
+//
+// Get the normal at a ray/object intersection in world space
+//
+inline Vec3
+getHitNormal(const IntersectInfo& hit)
+{
+	if (hit.instance != 0)
+		return hit.instance->normal(hit);
+	return hit.object->normal(hit);
+}
+
 } // end namespace Graphics
 
 #endif
@@ -0,0 +1,179 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: ActorBVH.cpp
+//  ========
+//  Source file for bounding volume hierarchy of scene actors.
+
+#ifndef __ActorBVH_h
+#include "ActorBVH.h"
+#endif
+#ifndef __Timer_h
+#include "Timer.h"
+#endif
+
+using namespace Graphics;
+
+
+//////////////////////////////////////////////////////////
+//
+// ActorBVH implementation
+// ========
+void
+ActorBVH::build(const Scene& scene)
+//[]---------------------------------------------------[]
+//|  Build                                              |
+//[]---------------------------------------------------[]
+{
+	System::Timer timer;
+	BoundingBox* bounds = setActors(scene);
+
+	if (bounds == 0)
+		bvh.clear();
+	else
+	{
+		bvh.build(bounds, numberOfActors, scene.getBVHOptions());
+		delete []bounds;
+	}
+	setBuilt(timer.getElapsedTime(), bvh.getBuildCost(), bvh.getMemorySize());
+}
+
+void
+ActorBVH::update(const Scene& scene, REAL maxCostRatio)
+//[]---------------------------------------------------[]
+//|  Update the BVH to a changed scene                  |
+//|  @param the scene                                   |
+//|  @param ratio of the SAH cost of a refitted BVH to  |
+//|  its cost when built beyond which it is rebuilt (no |
+//|  refits if not greater than 1)                      |
+//|                                                     |
+//|  The BVH is refitted if the scene has the same      |
+//|  actors, in the same order, and BVH options as when |
+//|  it was built, and rebuilt otherwise.               |
+//[]---------------------------------------------------[]
+{
+	if (maxCostRatio <= 1 ||
+		numberOfActors == 0 ||
+		!(bvh.getBuildOptions() == scene.getBVHOptions()) ||
+		!isBuiltFrom(scene))
+	{
+		build(scene);
+		return;
+	}
+
+	System::Timer timer;
+	BoundingBox* bounds = new BoundingBox[numberOfActors];
+
+	for (int i = 0; i < numberOfActors; i++)
+		bounds[i] = actors[i]->getBoundingBox();
+
+	BVH::Update update = bvh.refit(bounds, maxCostRatio);
+
+	delete []bounds;
+	statistics.lastUpdate = update;
+	statistics.lastTime = timer.getElapsedTime();
+	statistics.refits++;
+	if (update == BVH::Rebuilt)
+		statistics.builds++;
+	else if (update == BVH::PartiallyRebuilt)
+		statistics.partialRebuilds++;
+	statistics.refitTime += statistics.lastTime;
+	statistics.cost = bvh.getCost();
+	statistics.buildCost = bvh.getBuildCost();
+	statistics.memorySize = bvh.getMemorySize() +
+		(long)numberOfActors * sizeof(Actor*);
+}
+
+bool
+ActorBVH::intersect(const Ray& ray, IntersectInfo& hit, REAL maxDist) const
+//[]---------------------------------------------------[]
+//|  Closest ray/actor intersection                     |
+//|  @param the ray (input)                             |
+//|  @param information on intersection (output)        |
+//|  @param background distance                         |
+//|  @return true if the ray intersects an actor        |
+//[]---------------------------------------------------[]
+{
+	Intersector intersector(ray, actors, hit);
+
+	hit.distance = maxDist;
+	hit.object = 0;
+	bvh.intersect(ray, hit.distance, intersector);
+	return hit.object != 0;
+}
+
+int
+ActorBVH::intersect(const RayPacket& packet,
+	PacketHit& hit,
+	const Real4& maxDist) const
+//[]---------------------------------------------------[]
+//|  Closest packet/actor intersection                  |
+//|  @param the ray packet (input)                      |
+//|  @param information on intersections (output)       |
+//|  @param background distances                        |
+//|  @return mask of the active lanes which intersect   |
+//|  an actor                                           |
+//[]---------------------------------------------------[]
+{
+	PacketIntersector intersector(packet, actors, hit);
+
+	hit.distance = maxDist;
+	for (int i = 0; i < RAY_PACKET_SIZE; i++)
+		hit.info[i].object = 0;
+	bvh.intersect(packet, packet.active, hit.distance, intersector);
+	return hit.getMask() & packet.active;
+}
+
+bool
+ActorBVH::occluded(const Ray& ray,
+	REAL maxDist,
+	Actor** occluder,
+	const Actor* skipped) const
+//[]---------------------------------------------------[]
+//|  Ray/actor occlusion query                          |
+//|  @param the ray                                     |
+//|  @param distance beyond which hits do not count     |
+//|  @param the actor hit, if any (optional output)     |
+//|  @param actor not to be tested (optional)           |
+//|  @return true if the ray hits any actor closer than |
+//|  maxDist                                            |
+//[]---------------------------------------------------[]
+{
+	OcclusionTester tester(ray, actors, skipped);
+	bool hit = bvh.occluded(ray, maxDist, tester);
+
+	if (occluder != 0)
+		*occluder = tester.getOccluder();
+	return hit;
+}
+
+int
+ActorBVH::occluded(const RayPacket& packet,
+	const Real4& maxDist,
+	Actor** occluder,
+	const Actor* skipped) const
+//[]---------------------------------------------------[]
+//|  Packet/actor occlusion query                       |
+//|  @param the ray packet                              |
+//|  @param distances beyond which hits do not count    |
+//|  @param the last actor hit, if any (optional output)|
+//|  @param actor not to be tested (optional)           |
+//|  @return mask of the active lanes which hit any     |
+//|  actor closer than maxDist                          |
+//[]---------------------------------------------------[]
+{
+	PacketOcclusionTester tester(packet, actors, skipped);
+	int mask = bvh.occluded(packet, packet.active, maxDist, tester);
+
+	if (occluder != 0)
+		*occluder = tester.getOccluder();
+	return mask;
+}
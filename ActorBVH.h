@@ -0,0 +1,72 @@
+#ifndef __ActorBVH_h
+#define __ActorBVH_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: ActorBVH.h
+//  ========
+//  Class definition for bounding volume hierarchy of scene actors.
+
+#ifndef __Accelerator_h
+#include "Accelerator.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// ActorBVH: bounding volume hierarchy of scene actors class
+// ========
+//
+// Built with the BVH options of the scene. This is the top level of
+// a two level hierarchy: the rays reaching an actor are transformed
+// into the space of its model, if needed, and traverse the BVH of the
+// model (see MeshModel), which is shared by all instances of the
+// model. Packets traverse the BVH as a whole.
+//
+// When the actors of the scene are the same as when the BVH was
+// built, update() refits the BVH to their new bounds instead of
+// rebuilding it, unless its quality degrades too much.
+class ActorBVH: public Accelerator
+{
+public:
+	Type getType() const
+	{
+		return Hierarchy;
+	}
+
+	void build(const Scene&);
+	void update(const Scene&, REAL);
+
+	const BVH& getBVH() const
+	{
+		return bvh;
+	}
+
+	bool intersect(const Ray&, IntersectInfo&, REAL) const;
+	int intersect(const RayPacket&, PacketHit&, const Real4&) const;
+	bool occluded(const Ray&, REAL, Actor** = 0, const Actor* = 0) const;
+	int occluded(const RayPacket&,
+		const Real4&,
+		Actor** = 0,
+		const Actor* = 0) const;
+
+private:
+	BVH bvh;
+
+}; // ActorBVH
+
+} // end namespace Graphics
+
+#endif // __ActorBVH_h
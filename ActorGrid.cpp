@@ -0,0 +1,277 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: ActorGrid.cpp
+//  ========
+//  Source file for uniform grid of scene actors.
+
+#include <math.h>
+
+#ifndef __ActorGrid_h
+#include "ActorGrid.h"
+#endif
+#ifndef __Timer_h
+#include "Timer.h"
+#endif
+
+using namespace Graphics;
+
+//
+// Auxiliary function
+//
+inline bool
+isValid(const BoundingBox& box)
+{
+	// flat boxes are valid, inverted (empty) ones are not
+	const Vec3& p1 = box.getP1();
+	const Vec3& p2 = box.getP2();
+
+	return p1.x <= p2.x && p1.y <= p2.y && p1.z <= p2.z;
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// ActorGrid implementation
+// =========
+void
+ActorGrid::clear()
+//[]---------------------------------------------------[]
+//|  Clear                                              |
+//[]---------------------------------------------------[]
+{
+	delete []cells;
+	delete []items;
+	cells = items = 0;
+	numberOfCells = numberOfItems = 0;
+	resolution[0] = resolution[1] = resolution[2] = 0;
+	bounds.setEmpty();
+}
+
+void
+ActorGrid::build(const Scene& scene)
+//[]---------------------------------------------------[]
+//|  Build                                              |
+//[]---------------------------------------------------[]
+{
+	System::Timer timer;
+	BoundingBox* boxes = setActors(scene);
+
+	clear();
+	for (int i = 0; i < numberOfActors; i++)
+		if (isValid(boxes[i]))
+			bounds.inflate(boxes[i]);
+	if (isValid(bounds))
+	{
+		Vec3 size = bounds.getSize();
+		// flat axes are given some thickness to size the cells
+		REAL minSize = Math::max<REAL>(size.max() * 1e-3f, 1e-6f);
+		Vec3 s(Math::max<REAL>(size.x, minSize),
+			Math::max<REAL>(size.y, minSize),
+			Math::max<REAL>(size.z, minSize));
+		REAL cellsPerUnit = (REAL)pow(GRID_DENSITY * numberOfActors /
+			(s.x * s.y * s.z), 1.0 / 3);
+
+		numberOfCells = 1;
+		for (int k = 0; k < 3; k++)
+		{
+			int r = (int)(s[k] * cellsPerUnit);
+
+			resolution[k] = r < 1 ? 1 : r < GRID_MAX_RESOLUTION ?
+				r : GRID_MAX_RESOLUTION;
+			numberOfCells *= resolution[k];
+			cellSize[k] = size[k] / resolution[k];
+			invCellSize[k] = size[k] > 0 ? resolution[k] / size[k] : 0;
+		}
+		cells = new int[numberOfCells + 1];
+		for (int c = 0; c <= numberOfCells; c++)
+			cells[c] = 0;
+		// count the actors of each cell, then place them
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int i = 0; i < numberOfActors; i++)
+			{
+				if (!isValid(boxes[i]))
+					continue;
+
+				const Vec3& p1 = boxes[i].getP1();
+				const Vec3& p2 = boxes[i].getP2();
+				int x1 = getCell(0, p1.x), x2 = getCell(0, p2.x);
+				int y1 = getCell(1, p1.y), y2 = getCell(1, p2.y);
+				int z1 = getCell(2, p1.z), z2 = getCell(2, p2.z);
+
+				for (int z = z1; z <= z2; z++)
+					for (int y = y1; y <= y2; y++)
+						for (int x = x1; x <= x2; x++)
+						{
+							int c = (z * resolution[1] + y) * resolution[0] + x;
+
+							if (pass == 0)
+								cells[c]++;
+							else
+								items[--cells[c]] = i;
+						}
+			}
+			if (pass == 0)
+			{
+				// one past the last item of each cell
+				for (int c = 0; c < numberOfCells; c++)
+					cells[c + 1] += cells[c];
+				numberOfItems = cells[numberOfCells];
+				items = new int[numberOfItems];
+			}
+		}
+	}
+	delete []boxes;
+	setBuilt(timer.getElapsedTime(),
+		0,
+		(long)(numberOfCells + 1) * sizeof(int) +
+		(long)numberOfItems * sizeof(int));
+}
+
+template <typename Tester>
+bool
+ActorGrid::traverse(const Ray& ray,
+	REAL& distance,
+	Tester& tester,
+	bool anyHit) const
+//[]---------------------------------------------------[]
+//|  Walk the cells crossed by a ray (3D-DDA)           |
+//|  @param the ray                                     |
+//|  @param distance of the closest hit (input/output)  |
+//|  @param primitive intersector (as in BVH)           |
+//|  @param stop at the first hit?                      |
+//|  @return true if the ray intersects an actor        |
+//[]---------------------------------------------------[]
+{
+	Vec3 invDirection = ray.direction.inverse();
+	REAL tMin;
+	REAL tMax;
+
+	if (numberOfItems == 0 ||
+		!bounds.intersect(ray.origin, invDirection, tMin, tMax) ||
+		tMin > distance)
+		return false;
+
+	int cell[3];
+	int step[3];
+	int out[3];
+	REAL tNext[3];
+	REAL tDelta[3];
+
+	if (tMin < 0)
+		tMin = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		REAL o = ray.origin[k];
+		REAL p1 = bounds.getP1()[k];
+
+		cell[k] = getCell(k, o + ray.direction[k] * tMin);
+		if (ray.direction[k] > 0)
+		{
+			step[k] = 1;
+			out[k] = resolution[k];
+			tNext[k] = (p1 + (cell[k] + 1) * cellSize[k] - o) * invDirection[k];
+			tDelta[k] = cellSize[k] * invDirection[k];
+		}
+		else if (ray.direction[k] < 0)
+		{
+			step[k] = -1;
+			out[k] = -1;
+			tNext[k] = (p1 + cell[k] * cellSize[k] - o) * invDirection[k];
+			tDelta[k] = -cellSize[k] * invDirection[k];
+		}
+		else
+		{
+			step[k] = 0;
+			out[k] = -1;
+			tNext[k] = Math::infinity<REAL>();
+			tDelta[k] = 0;
+		}
+	}
+
+	int mailbox[GRID_MAILBOX_SIZE];
+	bool hit = false;
+
+	for (int i = 0; i < GRID_MAILBOX_SIZE; i++)
+		mailbox[i] = -1;
+	for (;;)
+	{
+		int c = (cell[2] * resolution[1] + cell[1]) * resolution[0] + cell[0];
+
+		for (int i = cells[c], e = cells[c + 1]; i < e; i++)
+		{
+			int a = items[i];
+			int& m = mailbox[a & (GRID_MAILBOX_SIZE - 1)];
+
+			if (m == a)
+				continue;
+			m = a;
+			if (tester(a, distance))
+			{
+				if (anyHit)
+					return true;
+				hit = true;
+			}
+		}
+
+		// axis of the cell exit
+		int k = tNext[0] < tNext[1] ?
+			(tNext[0] < tNext[2] ? 0 : 2) :
+			(tNext[1] < tNext[2] ? 1 : 2);
+
+		// hits beyond the cell are not closer than the one found
+		if (distance <= tNext[k] || (cell[k] += step[k]) == out[k])
+			return hit;
+		tNext[k] += tDelta[k];
+	}
+}
+
+bool
+ActorGrid::intersect(const Ray& ray, IntersectInfo& hit, REAL maxDist) const
+//[]---------------------------------------------------[]
+//|  Closest ray/actor intersection                     |
+//|  @param the ray (input)                             |
+//|  @param information on intersection (output)        |
+//|  @param background distance                         |
+//|  @return true if the ray intersects an actor        |
+//[]---------------------------------------------------[]
+{
+	Intersector intersector(ray, actors, hit);
+
+	hit.distance = maxDist;
+	hit.object = 0;
+	traverse(ray, hit.distance, intersector, false);
+	return hit.object != 0;
+}
+
+bool
+ActorGrid::occluded(const Ray& ray,
+	REAL maxDist,
+	Actor** occluder,
+	const Actor* skipped) const
+//[]---------------------------------------------------[]
+//|  Ray/actor occlusion query                          |
+//|  @param the ray                                     |
+//|  @param distance beyond which hits do not count     |
+//|  @param the actor hit, if any (optional output)     |
+//|  @param actor not to be tested (optional)           |
+//|  @return true if the ray hits any actor closer than |
+//|  maxDist                                            |
+//[]---------------------------------------------------[]
+{
+	OcclusionTester tester(ray, actors, skipped);
+	bool hit = traverse(ray, maxDist, tester, true);
+
+	if (occluder != 0)
+		*occluder = tester.getOccluder();
+	return hit;
+}
@@ -0,0 +1,102 @@
+#ifndef __ActorGrid_h
+#define __ActorGrid_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: ActorGrid.h
+//  ========
+//  Class definition for uniform grid of scene actors.
+
+#ifndef __Accelerator_h
+#include "Accelerator.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+#define GRID_DENSITY 4 // cells per actor
+#define GRID_MAX_RESOLUTION 128 // cells per axis
+#define GRID_MAILBOX_SIZE 16 // actors remembered by a traversal (power of 2)
+
+
+//////////////////////////////////////////////////////////
+//
+// ActorGrid: uniform grid of scene actors class
+// =========
+//
+// The bounds of the actors are split into cells of about the same
+// size along each axis, GRID_DENSITY times as many as the actors,
+// each cell listing the actors whose bounds overlap it. Rays walk
+// the cells they cross in order (3D-DDA), and stop at the first cell
+// holding a hit not farther than the cell exit. An actor overlapping
+// several cells is tested once per ray, as long as it is one of the
+// last few tested (see GRID_MAILBOX_SIZE). Best suited to actors of
+// about the same size, evenly spread.
+class ActorGrid: public Accelerator
+{
+public:
+	// Constructor
+	ActorGrid():
+		cells(0),
+		items(0),
+		numberOfCells(0),
+		numberOfItems(0)
+	{
+		resolution[0] = resolution[1] = resolution[2] = 0;
+	}
+
+	// Destructor
+	~ActorGrid()
+	{
+		clear();
+	}
+
+	Type getType() const
+	{
+		return UniformGrid;
+	}
+
+	void build(const Scene&);
+
+	using Accelerator::intersect;
+	using Accelerator::occluded;
+
+	bool intersect(const Ray&, IntersectInfo&, REAL) const;
+	bool occluded(const Ray&, REAL, Actor** = 0, const Actor* = 0) const;
+
+private:
+	BoundingBox bounds;
+	int resolution[3];
+	Vec3 cellSize;
+	Vec3 invCellSize;
+	int* cells; // first item of each cell, and one past the last
+	int* items; // actors overlapping the cells
+	int numberOfCells;
+	int numberOfItems;
+
+	void clear();
+
+	int getCell(int axis, REAL x) const
+	{
+		int c = (int)((x - bounds.getP1()[axis]) * invCellSize[axis]);
+
+		return c < 0 ? 0 : c < resolution[axis] ? c : resolution[axis] - 1;
+	}
+
+	template <typename Tester>
+	bool traverse(const Ray&, REAL&, Tester&, bool) const;
+
+}; // ActorGrid
+
+} // end namespace Graphics
+
+#endif // __ActorGrid_h
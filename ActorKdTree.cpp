@@ -0,0 +1,380 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: ActorKdTree.cpp
+//  ========
+//  Source file for kd-tree of scene actors.
+
+#include <math.h>
+#include <string.h>
+
+#ifndef __ActorKdTree_h
+#include "ActorKdTree.h"
+#endif
+#ifndef __Timer_h
+#include "Timer.h"
+#endif
+
+using namespace Graphics;
+
+
+//////////////////////////////////////////////////////////
+//
+// ActorKdTree implementation
+// ===========
+void
+ActorKdTree::clear()
+//[]---------------------------------------------------[]
+//|  Clear                                              |
+//[]---------------------------------------------------[]
+{
+	delete []nodes;
+	delete []items;
+	nodes = 0;
+	items = 0;
+	numberOfNodes = numberOfItems = 0;
+	nodeCapacity = itemCapacity = 0;
+	bounds.setEmpty();
+}
+
+int
+ActorKdTree::addNode()
+//[]---------------------------------------------------[]
+//|  Add a node                                         |
+//|  @return index of the node                          |
+//[]---------------------------------------------------[]
+{
+	if (numberOfNodes == nodeCapacity)
+	{
+		Node* temp = new Node[nodeCapacity = 2 * nodeCapacity + 64];
+
+		if (nodes != 0)
+			memcpy(temp, nodes, numberOfNodes * sizeof(Node));
+		delete []nodes;
+		nodes = temp;
+	}
+	return numberOfNodes++;
+}
+
+void
+ActorKdTree::build(const Scene& scene)
+//[]---------------------------------------------------[]
+//|  Build                                              |
+//[]---------------------------------------------------[]
+{
+	System::Timer timer;
+	BoundingBox* boxes = setActors(scene);
+	REAL cost = 0;
+
+	clear();
+	if (boxes != 0)
+	{
+		int* refs = new int[numberOfActors];
+		int n = 0;
+
+		// inverted (empty) boxes are left out
+		for (int i = 0; i < numberOfActors; i++)
+		{
+			const Vec3& p1 = boxes[i].getP1();
+			const Vec3& p2 = boxes[i].getP2();
+
+			if (p1.x <= p2.x && p1.y <= p2.y && p1.z <= p2.z)
+			{
+				bounds.inflate(boxes[i]);
+				refs[n++] = i;
+			}
+		}
+		if (n > 0)
+		{
+			// as suggested for kd-trees of triangles, 8 + 1.3 log2(n)
+			int maxDepth = 8 + (int)(1.3 * log((double)n) / log(2.0));
+
+			if (maxDepth > KD_TREE_MAX_DEPTH)
+				maxDepth = KD_TREE_MAX_DEPTH;
+			cost = build(boxes, refs, n, bounds, maxDepth);
+
+			REAL area = bounds.getArea();
+
+			cost = area > 0 ? cost / area : (REAL)n;
+		}
+		delete []refs;
+		delete []boxes;
+	}
+	setBuilt(timer.getElapsedTime(),
+		cost,
+		(long)nodeCapacity * sizeof(Node) + (long)itemCapacity * sizeof(int));
+}
+
+REAL
+ActorKdTree::build(const BoundingBox* boxes,
+	int* refs,
+	int n,
+	const BoundingBox& box,
+	int depth)
+//[]---------------------------------------------------[]
+//|  Build a subtree                                    |
+//|  @param bounds of the actors                        |
+//|  @param actors overlapping the subtree              |
+//|  @param number of actors                            |
+//|  @param bounds of the subtree                       |
+//|  @param levels the subtree may have below its root  |
+//|  @return SAH cost of the subtree times its area     |
+//[]---------------------------------------------------[]
+{
+	int index = addNode();
+	REAL area = box.getArea();
+	Vec3 size = box.getSize();
+	// the cost of a leaf, as testing an actor costs 1
+	REAL bestCost = (REAL)n;
+	int bestAxis = -1;
+	REAL bestSplit = 0;
+
+	if (n > 1 && depth > 0 && area > 0)
+		for (int k = 0; k < 3; k++)
+		{
+			if (size[k] <= 0)
+				continue;
+
+			int starts[KD_TREE_NUMBER_OF_BINS];
+			int ends[KD_TREE_NUMBER_OF_BINS];
+			REAL lo = box.getP1()[k];
+			REAL scale = KD_TREE_NUMBER_OF_BINS / size[k];
+
+			for (int b = 0; b < KD_TREE_NUMBER_OF_BINS; b++)
+				starts[b] = ends[b] = 0;
+			for (int i = 0; i < n; i++)
+			{
+				const BoundingBox& b = boxes[refs[i]];
+				int b1 = (int)((b.getP1()[k] - lo) * scale);
+				int b2 = (int)((b.getP2()[k] - lo) * scale);
+
+				starts[b1 < 0 ? 0 : b1 < KD_TREE_NUMBER_OF_BINS ?
+					b1 : KD_TREE_NUMBER_OF_BINS - 1]++;
+				ends[b2 < 0 ? 0 : b2 < KD_TREE_NUMBER_OF_BINS ?
+					b2 : KD_TREE_NUMBER_OF_BINS - 1]++;
+			}
+
+			// children areas are 2 * (side + length * perimeter)
+			REAL side = size[(k + 1) % 3] * size[(k + 2) % 3];
+			REAL perimeter = size[(k + 1) % 3] + size[(k + 2) % 3];
+			int left = 0;
+			int right = n;
+
+			for (int j = 1; j < KD_TREE_NUMBER_OF_BINS; j++)
+			{
+				left += starts[j - 1];
+				right -= ends[j - 1];
+
+				REAL l = size[k] * j / KD_TREE_NUMBER_OF_BINS;
+				REAL r = size[k] - l;
+				REAL cost = 2 * ((side + l * perimeter) * left +
+					(side + r * perimeter) * right) / area;
+
+				if (left == 0 || right == 0)
+					cost *= 1 - KD_TREE_EMPTY_BONUS;
+				cost += KD_TREE_TRAVERSAL_COST;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = k;
+					bestSplit = lo + l;
+				}
+			}
+		}
+	if (bestAxis < 0)
+	{
+		if (numberOfItems + n > itemCapacity)
+		{
+			int* temp = new int[itemCapacity = 2 * itemCapacity + n];
+
+			if (items != 0)
+				memcpy(temp, items, numberOfItems * sizeof(int));
+			delete []items;
+			items = temp;
+		}
+		nodes[index].axis = 3;
+		nodes[index].first = numberOfItems;
+		nodes[index].count = n;
+		memcpy(items + numberOfItems, refs, n * sizeof(int));
+		numberOfItems += n;
+		return area * n;
+	}
+
+	// the actors touching the plane from below go to the first child
+	int* left = new int[n];
+	int* right = new int[n];
+	int nl = 0;
+	int nr = 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		const BoundingBox& b = boxes[refs[i]];
+
+		if (b.getP1()[bestAxis] <= bestSplit)
+			left[nl++] = refs[i];
+		if (b.getP2()[bestAxis] > bestSplit)
+			right[nr++] = refs[i];
+	}
+	nodes[index].axis = bestAxis;
+	nodes[index].split = bestSplit;
+	nodes[index].count = 0;
+
+	Vec3 p1 = box.getP1();
+	Vec3 p2 = box.getP2();
+	REAL cost = area * KD_TREE_TRAVERSAL_COST;
+
+	p2[bestAxis] = bestSplit;
+	cost += build(boxes, left, nl, BoundingBox(box.getP1(), p2), depth - 1);
+	delete []left;
+	p1[bestAxis] = bestSplit;
+	// the nodes may have been moved by the first subtree
+	nodes[index].first = numberOfNodes;
+	cost += build(boxes, right, nr, BoundingBox(p1, box.getP2()), depth - 1);
+	delete []right;
+	return cost;
+}
+
+template <typename Tester>
+bool
+ActorKdTree::traverse(const Ray& ray,
+	REAL& distance,
+	Tester& tester,
+	bool anyHit) const
+//[]---------------------------------------------------[]
+//|  Front-to-back traversal                            |
+//|  @param the ray                                     |
+//|  @param distance of the closest hit (input/output)  |
+//|  @param primitive intersector (as in BVH)           |
+//|  @param stop at the first hit?                      |
+//|  @return true if the ray intersects an actor        |
+//|                                                     |
+//|  The far child of a node crossed by the ray is      |
+//|  pushed with the range of distances of the ray      |
+//|  inside it, and the near one visited.               |
+//[]---------------------------------------------------[]
+{
+	Vec3 invDirection = ray.direction.inverse();
+	REAL tMin;
+	REAL tMax;
+
+	if (numberOfItems == 0 ||
+		!bounds.intersect(ray.origin, invDirection, tMin, tMax) ||
+		tMin > distance)
+		return false;
+	if (tMin < 0)
+		tMin = 0;
+
+	int stack[KD_TREE_MAX_DEPTH];
+	REAL stackMin[KD_TREE_MAX_DEPTH];
+	REAL stackMax[KD_TREE_MAX_DEPTH];
+	int top = 0;
+	int current = 0;
+	int mailbox[KD_TREE_MAILBOX_SIZE];
+	bool hit = false;
+
+	for (int i = 0; i < KD_TREE_MAILBOX_SIZE; i++)
+		mailbox[i] = -1;
+	for (;;)
+	{
+		const Node& node = nodes[current];
+
+		if (!node.isLeaf())
+		{
+			int k = node.axis;
+			REAL o = ray.origin[k];
+			REAL t = (node.split - o) * invDirection[k];
+			bool below = o < node.split ||
+				(o == node.split && ray.direction[k] <= 0);
+			int nearChild = below ? current + 1 : node.first;
+			int farChild = below ? node.first : current + 1;
+
+			if (t > tMax || t <= 0)
+				current = nearChild;
+			else if (t < tMin)
+				current = farChild;
+			else
+			{
+				stack[top] = farChild;
+				stackMin[top] = t;
+				stackMax[top++] = tMax;
+				current = nearChild;
+				tMax = t;
+			}
+			continue;
+		}
+
+		const int* p = items + node.first;
+
+		for (int i = 0; i < node.count; i++)
+		{
+			int& m = mailbox[p[i] & (KD_TREE_MAILBOX_SIZE - 1)];
+
+			if (m == p[i])
+				continue;
+			m = p[i];
+			if (tester(p[i], distance))
+			{
+				if (anyHit)
+					return true;
+				hit = true;
+			}
+		}
+		// hits beyond the leaf are not closer than the one found
+		if (distance <= tMax || top == 0)
+			return hit;
+		current = stack[--top];
+		tMin = stackMin[top];
+		tMax = stackMax[top];
+		if (tMin > distance)
+			return hit;
+	}
+}
+
+bool
+ActorKdTree::intersect(const Ray& ray, IntersectInfo& hit, REAL maxDist) const
+//[]---------------------------------------------------[]
+//|  Closest ray/actor intersection                     |
+//|  @param the ray (input)                             |
+//|  @param information on intersection (output)        |
+//|  @param background distance                         |
+//|  @return true if the ray intersects an actor        |
+//[]---------------------------------------------------[]
+{
+	Intersector intersector(ray, actors, hit);
+
+	hit.distance = maxDist;
+	hit.object = 0;
+	traverse(ray, hit.distance, intersector, false);
+	return hit.object != 0;
+}
+
+bool
+ActorKdTree::occluded(const Ray& ray,
+	REAL maxDist,
+	Actor** occluder,
+	const Actor* skipped) const
+//[]---------------------------------------------------[]
+//|  Ray/actor occlusion query                          |
+//|  @param the ray                                     |
+//|  @param distance beyond which hits do not count     |
+//|  @param the actor hit, if any (optional output)     |
+//|  @param actor not to be tested (optional)           |
+//|  @return true if the ray hits any actor closer than |
+//|  maxDist                                            |
+//[]---------------------------------------------------[]
+{
+	OcclusionTester tester(ray, actors, skipped);
+	bool hit = traverse(ray, maxDist, tester, true);
+
+	if (occluder != 0)
+		*occluder = tester.getOccluder();
+	return hit;
+}
@@ -0,0 +1,116 @@
+#ifndef __ActorKdTree_h
+#define __ActorKdTree_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: ActorKdTree.h
+//  ========
+//  Class definition for kd-tree of scene actors.
+
+#ifndef __Accelerator_h
+#include "Accelerator.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+#define KD_TREE_NUMBER_OF_BINS 32
+#define KD_TREE_TRAVERSAL_COST 1 // relative to testing an actor
+#define KD_TREE_EMPTY_BONUS 0.2f // cost discount of empty children
+#define KD_TREE_MAX_DEPTH 40
+#define KD_TREE_MAILBOX_SIZE 16 // actors remembered by a traversal (power of 2)
+
+
+//////////////////////////////////////////////////////////
+//
+// ActorKdTree: kd-tree of scene actors class
+// ===========
+//
+// The bounds of the actors are split recursively by axis-aligned
+// planes, chosen among the bin boundaries of each axis as the ones of
+// least SAH cost, until splitting costs more than testing the actors
+// of a node. The actors overlapping both sides of a plane are listed
+// in both children. Unlike the nodes of a BVH, the nodes of a kd-tree
+// do not overlap, so rays visit them front to back and stop at the
+// first leaf holding a hit not farther than the leaf exit. An actor
+// listed in several leaves is tested once per ray, as long as it is
+// one of the last few tested (see KD_TREE_MAILBOX_SIZE). Nodes are
+// stored in depth-first order: the first child of a node follows it.
+class ActorKdTree: public Accelerator
+{
+public:
+	struct Node
+	{
+		REAL split; // position of the split plane (interior)
+		int axis; // split axis, or 3 (leaf)
+		int first; // second child (interior) or first item (leaf)
+		int count; // number of items (leaf)
+
+		bool isLeaf() const
+		{
+			return axis == 3;
+		}
+
+	}; // Node
+
+	// Constructor
+	ActorKdTree():
+		nodes(0),
+		items(0),
+		numberOfNodes(0),
+		numberOfItems(0),
+		nodeCapacity(0),
+		itemCapacity(0)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	~ActorKdTree()
+	{
+		clear();
+	}
+
+	Type getType() const
+	{
+		return KdTree;
+	}
+
+	void build(const Scene&);
+
+	using Accelerator::intersect;
+	using Accelerator::occluded;
+
+	bool intersect(const Ray&, IntersectInfo&, REAL) const;
+	bool occluded(const Ray&, REAL, Actor** = 0, const Actor* = 0) const;
+
+private:
+	BoundingBox bounds;
+	Node* nodes;
+	int* items; // actors of the leaves
+	int numberOfNodes;
+	int numberOfItems;
+	int nodeCapacity;
+	int itemCapacity;
+
+	void clear();
+	REAL build(const BoundingBox*, int*, int, const BoundingBox&, int);
+	int addNode();
+
+	template <typename Tester>
+	bool traverse(const Ray&, REAL&, Tester&, bool) const;
+
+}; // ActorKdTree
+
+} // end namespace Graphics
+
+#endif // __ActorKdTree_h
@@ -0,0 +1,890 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: BVH.cpp
+//  ========
+//  Source file for bounding volume hierarchy.
+
+#ifndef __BVH_h
+#include "BVH.h"
+#endif
+#ifndef __Thread_h
+#include "Thread.h"
+#endif
+#ifndef __Timer_h
+#include "Timer.h"
+#endif
+
+using namespace Graphics;
+using namespace System;
+
+
+//////////////////////////////////////////////////////////
+//
+// BVH::Builder: parallel BVH builder class
+// ============
+//
+// Builds the tree of a range of primitives into the reserved slots of
+// the node array of a BVH: the first child of a node of n primitives
+// is the next node, and the second child, if the first one has l
+// primitives, is 2l nodes after it. Subtrees of BVH_TASK_SIZE or more
+// primitives are queued as tasks, which are run by a pool of workers
+// until the queue is empty and no task is running.
+class BVH::Builder
+{
+public:
+	// Constructor
+	Builder(BVH&, BuildPrimitive*, int);
+
+	// Destructor
+	~Builder()
+	{
+		delete []codes;
+		delete []tasks;
+	}
+
+	void run(int, int);
+
+private:
+	struct Task
+	{
+		int first; // first primitive
+		int n; // number of primitives
+		int depth;
+		int index; // node slot
+
+	}; // Task
+
+	class Worker;
+
+	BVH& bvh;
+	BuildPrimitive* p;
+	int n;
+	uint* codes; // Morton codes of the primitive centers
+	Mutex lock;
+	Condition ready;
+	Task* tasks;
+	int numberOfTasks;
+	int pending; // tasks queued or running
+
+	void build(Task);
+	int mortonSplit(int, int) const;
+	void sortByCodes();
+	void push(const Task&);
+	bool pop(Task&);
+	void done();
+	void work();
+
+}; // BVH::Builder
+
+
+//////////////////////////////////////////////////////////
+//
+// BVH::Builder::Worker: BVH build worker class
+// ====================
+class BVH::Builder::Worker: public Thread
+{
+public:
+	Builder* builder;
+
+	// Constructor
+	Worker():
+		builder(0)
+	{
+		// do nothing
+	}
+
+	void run()
+	{
+		builder->work();
+	}
+
+}; // BVH::Builder::Worker
+
+//
+// Auxiliary functions
+//
+inline uint
+expandBits(uint v)
+{
+	// spread the 10 lower bits of v three bits apart
+	v = (v * 0x00010001u) & 0xff0000ffu;
+	v = (v * 0x00000101u) & 0x0f00f00fu;
+	v = (v * 0x00000011u) & 0xc30c30c3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+inline uint
+mortonCode(const Vec3& c, const Vec3& min, const Vec3& scale)
+{
+	uint code = 0;
+
+	for (int axis = _X; axis <= _Z; axis++)
+	{
+		int x = (int)((c[axis] - min[axis]) * scale[axis]);
+
+		x = x < 0 ? 0 : x < 1023 ? x : 1023;
+		code |= expandBits((uint)x) << (2 - axis);
+	}
+	return code;
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// BVH::Builder implementation
+// ============
+BVH::Builder::Builder(BVH& aBVH, BuildPrimitive* p, int n):
+	bvh(aBVH),
+	codes(0),
+	tasks(0),
+	numberOfTasks(0),
+	pending(0)
+//[]---------------------------------------------------[]
+//|  Constructor                                        |
+//|  @param the BVH                                     |
+//|  @param primitives to be built                      |
+//|  @param number of primitives                        |
+//[]---------------------------------------------------[]
+{
+	this->p = p;
+	this->n = n;
+	if (bvh.options.method != Morton)
+		return;
+
+	BoundingBox centers;
+
+	for (int i = 0; i < n; i++)
+		centers.inflate(p[i].center);
+
+	Vec3 min = centers.getP1();
+	Vec3 scale = centers.getSize();
+
+	for (int axis = _X; axis <= _Z; axis++)
+		scale[axis] = Math::isZero(scale[axis]) ? 0 : 1024 / scale[axis];
+	codes = new uint[n];
+	for (int i = 0; i < n; i++)
+		codes[i] = mortonCode(p[i].center, min, scale);
+	sortByCodes();
+}
+
+void
+BVH::Builder::sortByCodes()
+//[]---------------------------------------------------[]
+//|  Sort the primitives by their Morton codes          |
+//|                                                     |
+//|  The 30 bit codes are radix sorted, 10 bits a pass. |
+//[]---------------------------------------------------[]
+{
+	const int nb = 1024;
+	uint* sortedCodes = new uint[n];
+	int* order = new int[n];
+	int* sortedOrder = new int[n];
+	int* counts = new int[nb];
+
+	for (int i = 0; i < n; i++)
+		order[i] = i;
+	for (int shift = 0; shift < 30; shift += 10)
+	{
+		for (int b = 0; b < nb; b++)
+			counts[b] = 0;
+		for (int i = 0; i < n; i++)
+			counts[codes[i] >> shift & (nb - 1)]++;
+		for (int b = 0, first = 0; b < nb; b++)
+		{
+			int count = counts[b];
+
+			counts[b] = first;
+			first += count;
+		}
+		for (int i = 0; i < n; i++)
+		{
+			int k = counts[codes[i] >> shift & (nb - 1)]++;
+
+			sortedCodes[k] = codes[i];
+			sortedOrder[k] = order[i];
+		}
+		swap(codes, sortedCodes);
+		swap(order, sortedOrder);
+	}
+
+	BuildPrimitive* sorted = new BuildPrimitive[n];
+
+	for (int i = 0; i < n; i++)
+		sorted[i] = p[order[i]];
+	for (int i = 0; i < n; i++)
+		p[i] = sorted[i];
+	delete []sorted;
+	delete []counts;
+	delete []sortedOrder;
+	delete []order;
+	delete []sortedCodes;
+}
+
+void
+BVH::Builder::run(int depth, int numberOfThreads)
+//[]---------------------------------------------------[]
+//|  Build the tree                                     |
+//|  @param depth of the root                           |
+//|  @param number of threads (workers)                 |
+//[]---------------------------------------------------[]
+{
+	Task root = {0, n, depth, 0};
+
+	numberOfThreads = Math::min(numberOfThreads, n / BVH_TASK_SIZE);
+	if (numberOfThreads <= 1)
+	{
+		build(root);
+		return;
+	}
+	// the queued tasks are disjoint subtrees of BVH_TASK_SIZE or more
+	// primitives
+	tasks = new Task[n / BVH_TASK_SIZE + 1];
+	push(root);
+
+	Worker* workers = new Worker[numberOfThreads];
+
+	// worker 0 runs on the calling thread
+	for (int i = 0; i < numberOfThreads; i++)
+		workers[i].builder = this;
+	for (int i = 1; i < numberOfThreads; i++)
+		if (!workers[i].start())
+			break;
+	workers[0].run();
+	for (int i = 1; i < numberOfThreads; i++)
+		workers[i].join();
+	delete []workers;
+}
+
+void
+BVH::Builder::work()
+//[]---------------------------------------------------[]
+//|  Run the queued tasks until the tree is built       |
+//[]---------------------------------------------------[]
+{
+	Task task;
+
+	while (pop(task))
+	{
+		build(task);
+		done();
+	}
+}
+
+void
+BVH::Builder::push(const Task& task)
+//[]---------------------------------------------------[]
+//|  Queue a task                                       |
+//[]---------------------------------------------------[]
+{
+	ScopedLock guard(lock);
+
+	tasks[numberOfTasks++] = task;
+	pending++;
+	ready.signal();
+}
+
+bool
+BVH::Builder::pop(Task& task)
+//[]---------------------------------------------------[]
+//|  Wait for a task                                    |
+//|  @return false if all tasks are done                |
+//[]---------------------------------------------------[]
+{
+	ScopedLock guard(lock);
+
+	while (numberOfTasks == 0 && pending > 0)
+		ready.wait(lock);
+	if (numberOfTasks == 0)
+		return false;
+	task = tasks[--numberOfTasks];
+	return true;
+}
+
+void
+BVH::Builder::done()
+//[]---------------------------------------------------[]
+//|  Finish a task                                      |
+//[]---------------------------------------------------[]
+{
+	ScopedLock guard(lock);
+
+	if (--pending == 0)
+		ready.broadcast();
+}
+
+void
+BVH::Builder::build(Task task)
+//[]---------------------------------------------------[]
+//|  Build the subtree of a task                        |
+//|                                                     |
+//|  The second child of a node is built (or queued)    |
+//|  first, and then the loop goes on with the first.   |
+//[]---------------------------------------------------[]
+{
+	for (;;)
+	{
+		Node& node = bvh.nodes[task.index];
+		// the traversal stack bounds the tree depth
+		bool deep = task.depth >= BVH_STACK_SIZE - 1;
+		int left;
+
+		if (codes != 0)
+			// the bounds are fitted once the tree is built
+			left = task.n > BVH_MAX_LEAF_SIZE && !deep ?
+				mortonSplit(task.first, task.n) :
+				0;
+		else
+		{
+			BoundingBox centers;
+
+			for (int i = task.first, e = task.first + task.n; i < e; i++)
+			{
+				node.bounds.inflate(p[i].bounds);
+				centers.inflate(p[i].center);
+			}
+			left = task.n > 1 && !deep ?
+				bvh.split(p + task.first, task.n, node.bounds, centers) :
+				0;
+		}
+		if (left == 0)
+		{
+			node.first = task.first;
+			node.count = task.n;
+			return;
+		}
+		node.count = 0;
+		node.first = task.index + 2 * left;
+
+		Task right = {task.first + left, task.n - left, task.depth + 1, node.first};
+
+		if (tasks != 0 && right.n >= BVH_TASK_SIZE)
+			push(right);
+		else
+			build(right);
+		task.n = left;
+		task.depth++;
+		task.index++;
+	}
+}
+
+int
+BVH::Builder::mortonSplit(int first, int n) const
+//[]---------------------------------------------------[]
+//|  Split at the highest bit in which the Morton codes |
+//|  of the primitives [first, first + n) differ        |
+//|  @return number of primitives on the left side      |
+//[]---------------------------------------------------[]
+{
+	uint c1 = codes[first];
+	uint c2 = codes[first + n - 1];
+
+	if (c1 == c2)
+		return n >> 1;
+
+	uint bit = 1u << 29;
+
+	while ((bit & (c1 ^ c2)) == 0)
+		bit >>= 1;
+
+	// the codes share the bits above, hence the ones with the bit set
+	// are the last ones
+	int i = first;
+	int j = first + n - 1;
+
+	while (j - i > 1)
+	{
+		int m = (i + j) >> 1;
+
+		if (codes[m] & bit)
+			j = m;
+		else
+			i = m;
+	}
+	return j - first;
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// BVH implementation
+// ===
+void
+BVH::clear()
+//[]---------------------------------------------------[]
+//|  Clear                                              |
+//[]---------------------------------------------------[]
+{
+	delete []nodes;
+	delete []primitives;
+	delete []costs;
+	delete []areas;
+	nodes = 0;
+	primitives = 0;
+	costs = areas = 0;
+	numberOfNodes = numberOfPrimitives = 0;
+	buildCost = 0;
+}
+
+void
+BVH::build(const BoundingBox* bounds, int n, const BuildOptions& options)
+//[]---------------------------------------------------[]
+//|  Build                                              |
+//|  @param bounding boxes of the primitives            |
+//|  @param number of primitives                        |
+//|  @param build method and number of threads          |
+//[]---------------------------------------------------[]
+{
+	Timer timer;
+
+	clear();
+	this->options = options;
+	if (n <= 0)
+	{
+		buildTime = timer.getElapsedTime();
+		return;
+	}
+
+	BuildPrimitive* p = new BuildPrimitive[n];
+
+	for (int i = 0; i < n; i++)
+	{
+		p[i].bounds = bounds[i];
+		p[i].center = bounds[i].getCenter();
+		p[i].index = i;
+	}
+	primitives = new int[numberOfPrimitives = n];
+	build(p, n, 0);
+	for (int i = 0; i < n; i++)
+		primitives[i] = p[i].index;
+	delete []p;
+	buildCost = getCost();
+	buildTime = timer.getElapsedTime();
+}
+
+BVH::Quality
+BVH::getQuality() const
+//[]---------------------------------------------------[]
+//|  Get the tree quality metrics                       |
+//[]---------------------------------------------------[]
+{
+	Quality q;
+
+	if (numberOfNodes == 0)
+		return q;
+
+	int* depths = new int[numberOfNodes];
+
+	depths[0] = 0;
+	// children are stored after their parents
+	for (int i = 0; i < numberOfNodes; i++)
+	{
+		const Node& node = nodes[i];
+
+		if (node.isLeaf())
+		{
+			q.numberOfLeaves++;
+			q.maxDepth = Math::max(q.maxDepth, depths[i]);
+		}
+		else
+			depths[i + 1] = depths[node.first] = depths[i] + 1;
+	}
+	delete []depths;
+	q.numberOfNodes = numberOfNodes;
+	q.averageLeafSize = (REAL)numberOfPrimitives / q.numberOfLeaves;
+	q.cost = getCost();
+	return q;
+}
+
+REAL
+BVH::getCost() const
+//[]---------------------------------------------------[]
+//|  Get the SAH cost of the tree                       |
+//|                                                     |
+//|  The cost is the expected number of nodes traversed |
+//|  and primitives tested by a ray hitting the root    |
+//|  (weighted by BVH_TRAVERSAL_COST and 1).            |
+//[]---------------------------------------------------[]
+{
+	if (numberOfNodes == 0)
+		return 0;
+
+	REAL area = nodes[0].bounds.getArea();
+
+	if (Math::isZero(area))
+		return 0;
+
+	REAL cost = 0;
+
+	for (int i = 0; i < numberOfNodes; i++)
+	{
+		const Node& node = nodes[i];
+
+		cost += node.bounds.getArea() *
+			(node.isLeaf() ? node.count : BVH_TRAVERSAL_COST);
+	}
+	return cost / area;
+}
+
+void
+BVH::saveCosts()
+//[]---------------------------------------------------[]
+//|  Save the costs of the subtrees and the areas of    |
+//|  the nodes as they are now                          |
+//[]---------------------------------------------------[]
+{
+	delete []costs;
+	delete []areas;
+	costs = new REAL[numberOfNodes];
+	areas = new REAL[numberOfNodes];
+	// children are stored after their parents
+	for (int i = numberOfNodes - 1; i >= 0; i--)
+	{
+		const Node& node = nodes[i];
+
+		areas[i] = node.bounds.getArea();
+		costs[i] = node.isLeaf() ?
+			areas[i] * node.count :
+			areas[i] * BVH_TRAVERSAL_COST + costs[i + 1] + costs[node.first];
+	}
+}
+
+BVH::Update
+BVH::refit(const BoundingBox* bounds, REAL maxCostRatio)
+//[]---------------------------------------------------[]
+//|  Refit the node bounds to moved primitives          |
+//|  @param new bounding boxes of the primitives (as    |
+//|  many and in the same order as when built)          |
+//|  @param ratio of the SAH cost to the cost when      |
+//|  built beyond which the tree is rebuilt             |
+//|  @return how the tree was updated                   |
+//|                                                     |
+//|  Following the path of the subtrees whose costs     |
+//|  grew the most since they were built, the subtree   |
+//|  rebuilt is the one of the first node whose child   |
+//|  in the path grew by more than maxCostRatio in area |
+//|  (then it holds both where the primitives of the    |
+//|  child were and where they are now). The whole tree |
+//|  is rebuilt if no such node is found, or if the     |
+//|  cost is still too high.                            |
+//[]---------------------------------------------------[]
+{
+	if (numberOfNodes == 0)
+		return Refitted;
+	if (costs == 0)
+		saveCosts();
+
+	REAL* current = new REAL[numberOfNodes];
+
+	for (int i = numberOfNodes - 1; i >= 0; i--)
+	{
+		Node& node = nodes[i];
+
+		node.bounds.setEmpty();
+		if (node.isLeaf())
+		{
+			for (int k = 0; k < node.count; k++)
+				node.bounds.inflate(bounds[primitives[node.first + k]]);
+			current[i] = node.bounds.getArea() * node.count;
+		}
+		else
+		{
+			node.bounds.inflate(nodes[i + 1].bounds);
+			node.bounds.inflate(nodes[node.first].bounds);
+			current[i] = node.bounds.getArea() * BVH_TRAVERSAL_COST +
+				current[i + 1] +
+				current[node.first];
+		}
+	}
+
+	REAL maxCost = maxCostRatio * buildCost;
+	Update update = Refitted;
+
+	if (getCost() > maxCost)
+	{
+		int i = 0;
+		int depth = 0;
+
+		while (!nodes[i].isLeaf())
+		{
+			int c1 = i + 1;
+			int c2 = nodes[i].first;
+			int c = current[c1] - costs[c1] >= current[c2] - costs[c2] ? c1 : c2;
+
+			if (nodes[c].bounds.getArea() > maxCostRatio * areas[c])
+				break;
+			i = c;
+			depth++;
+		}
+		if (i > 0 && !nodes[i].isLeaf())
+		{
+			rebuild(bounds, i, depth);
+			saveCosts();
+			update = PartiallyRebuilt;
+		}
+		if (update == Refitted || getCost() > maxCost)
+		{
+			// with the options the tree was built with
+			build(bounds, numberOfPrimitives, options);
+			update = Rebuilt;
+		}
+	}
+	delete []current;
+	return update;
+}
+
+void
+BVH::rebuild(const BoundingBox* bounds, int root, int depth)
+//[]---------------------------------------------------[]
+//|  Rebuild a subtree                                  |
+//|  @param bounding boxes of the primitives            |
+//|  @param root of the subtree                         |
+//|  @param depth of the root                           |
+//|                                                     |
+//|  The subtree is built apart and then spliced into   |
+//|  the node array, shifting the nodes after it.       |
+//[]---------------------------------------------------[]
+{
+	// the nodes of the subtree are [root, end), and its primitives
+	// are [first, first + n)
+	int end = root;
+
+	while (!nodes[end].isLeaf())
+		end = nodes[end].first;
+	end++;
+
+	int first = root;
+
+	while (!nodes[first].isLeaf())
+		first++;
+	first = nodes[first].first;
+
+	int n = 0;
+
+	for (int i = root; i < end; i++)
+		n += nodes[i].count;
+
+	BuildPrimitive* p = new BuildPrimitive[n];
+
+	for (int i = 0; i < n; i++)
+	{
+		int index = primitives[first + i];
+
+		p[i].bounds = bounds[index];
+		p[i].center = bounds[index].getCenter();
+		p[i].index = index;
+	}
+
+	Node* old = nodes;
+	int oldCount = numberOfNodes;
+
+	build(p, n, depth);
+
+	Node* subtree = nodes;
+	int count = numberOfNodes;
+	int shift = count - (end - root);
+
+	nodes = new Node[numberOfNodes = oldCount + shift];
+	for (int i = 0; i < root; i++)
+	{
+		nodes[i] = old[i];
+		if (!nodes[i].isLeaf() && nodes[i].first >= end)
+			nodes[i].first += shift;
+	}
+	for (int i = 0; i < count; i++)
+	{
+		Node& node = nodes[root + i] = subtree[i];
+
+		node.first += node.isLeaf() ? first : root;
+	}
+	for (int i = end; i < oldCount; i++)
+	{
+		Node& node = nodes[i + shift] = old[i];
+
+		if (!node.isLeaf())
+			node.first += shift;
+	}
+	for (int i = 0; i < n; i++)
+		primitives[first + i] = p[i].index;
+	delete []old;
+	delete []subtree;
+	delete []p;
+}
+
+//
+// Auxiliary function
+//
+inline int
+binIndex(const Vec3& c, int axis, REAL min, REAL scale)
+{
+	int b = (int)((c[axis] - min) * scale);
+	return b < BVH_NUMBER_OF_BINS ? b : BVH_NUMBER_OF_BINS - 1;
+}
+
+int
+BVH::split(BuildPrimitive* p,
+	int n,
+	const BoundingBox& bounds,
+	const BoundingBox& centers) const
+//[]---------------------------------------------------[]
+//|  Binned SAH split                                   |
+//|  @param primitives to be split                      |
+//|  @param number of primitives                        |
+//|  @param bounds of the primitives                    |
+//|  @param bounds of the primitive centers             |
+//|  @return number of primitives on the left side, or  |
+//|  zero if making a leaf is cheaper                   |
+//[]---------------------------------------------------[]
+{
+	const int nb = BVH_NUMBER_OF_BINS;
+	Vec3 min = centers.getP1();
+	Vec3 size = centers.getSize();
+	REAL bestCost = Math::infinity<REAL>();
+	int bestAxis = -1;
+	int bestSplit = 0;
+
+	for (int axis = _X; axis <= _Z; axis++)
+	{
+		if (Math::isZero(size[axis]))
+			continue;
+
+		BoundingBox binBounds[nb];
+		int binCount[nb];
+		REAL scale = nb / size[axis];
+
+		for (int b = 0; b < nb; b++)
+			binCount[b] = 0;
+		for (int i = 0; i < n; i++)
+		{
+			int b = binIndex(p[i].center, axis, min[axis], scale);
+
+			binCount[b]++;
+			binBounds[b].inflate(p[i].bounds);
+		}
+
+		// sweep from the right, then from the left (inflating a box by
+		// an empty one would make it infinite)
+		REAL rightArea[nb];
+		int rightCount[nb];
+		BoundingBox box;
+		int count = 0;
+
+		for (int b = nb - 1; b > 0; b--)
+		{
+			if (binCount[b] > 0)
+				box.inflate(binBounds[b]);
+			rightArea[b] = box.getArea();
+			rightCount[b] = count += binCount[b];
+		}
+		box.setEmpty();
+		count = 0;
+		for (int b = 1; b < nb; b++)
+		{
+			if (binCount[b - 1] > 0)
+				box.inflate(binBounds[b - 1]);
+			count += binCount[b - 1];
+			if (count == 0 || rightCount[b] == 0)
+				continue;
+
+			REAL cost = box.getArea() * count + rightArea[b] * rightCount[b];
+
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+	if (bestAxis < 0)
+		// all centers are coincident
+		return n > BVH_MAX_LEAF_SIZE ? n >> 1 : 0;
+
+	REAL area = bounds.getArea();
+
+	if (n <= BVH_MAX_LEAF_SIZE &&
+		n * area <= BVH_TRAVERSAL_COST * area + bestCost)
+		return 0;
+
+	REAL scale = nb / size[bestAxis];
+	int i = 0;
+	int j = n - 1;
+
+	while (i <= j)
+		if (binIndex(p[i].center, bestAxis, min[bestAxis], scale) < bestSplit)
+			i++;
+		else
+			System::swap(p[i], p[j--]);
+	return i;
+}
+
+void
+BVH::build(BuildPrimitive* p, int n, int depth)
+//[]---------------------------------------------------[]
+//|  Build the nodes of a tree                          |
+//|  @param primitives (reordered by the build)         |
+//|  @param number of primitives                        |
+//|  @param depth of the root                           |
+//|                                                     |
+//|  The nodes are built into 2n - 1 reserved slots and |
+//|  then compacted, keeping their order.               |
+//[]---------------------------------------------------[]
+{
+	int slots = 2 * n - 1;
+	Node* reserved = new Node[slots];
+
+	// unused slots are marked by a negative count
+	for (int i = 0; i < slots; i++)
+		reserved[i].count = -1;
+	nodes = reserved;
+	{
+		Builder builder(*this, p, n);
+
+		builder.run(depth, options.numberOfThreads > 0 ?
+			options.numberOfThreads :
+			Thread::getNumberOfProcessors());
+	}
+
+	int* index = new int[slots];
+
+	numberOfNodes = 0;
+	for (int i = 0; i < slots; i++)
+		if (reserved[i].count >= 0)
+			index[i] = numberOfNodes++;
+	nodes = new Node[numberOfNodes];
+	for (int i = 0; i < slots; i++)
+		if (reserved[i].count >= 0)
+		{
+			Node& node = nodes[index[i]] = reserved[i];
+
+			if (!node.isLeaf())
+				node.first = index[node.first];
+		}
+	delete []index;
+	delete []reserved;
+	if (options.method != Morton)
+		return;
+	// fit the bounds of the Morton tree bottom-up
+	for (int i = numberOfNodes - 1; i >= 0; i--)
+	{
+		Node& node = nodes[i];
+
+		if (node.isLeaf())
+			for (int k = 0; k < node.count; k++)
+				node.bounds.inflate(p[node.first + k].bounds);
+		else
+		{
+			node.bounds.inflate(nodes[i + 1].bounds);
+			node.bounds.inflate(nodes[node.first].bounds);
+		}
+	}
+}
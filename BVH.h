@@ -0,0 +1,616 @@
+#ifndef __BVH_h
+#define __BVH_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: BVH.h
+//  ========
+//  Class definition for bounding volume hierarchy.
+
+#ifndef __BoundingBox_h
+#include "BoundingBox.h"
+#endif
+#ifndef __RayPacket_h
+#include "RayPacket.h"
+#endif
+#ifndef __RenderStatistics_h
+#include "RenderStatistics.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+#define BVH_MAX_LEAF_SIZE 4
+#define BVH_NUMBER_OF_BINS 16
+#define BVH_TRAVERSAL_COST 1
+#define BVH_STACK_SIZE 64
+// minimum number of primitives of a subtree built by another thread
+#define BVH_TASK_SIZE 4096
+
+
+//////////////////////////////////////////////////////////
+//
+// BVH: bounding volume hierarchy class
+// ===
+//
+// The hierarchy is built over a set of primitives given by their
+// bounding boxes and knows nothing about the primitives themselves:
+// leaves refer to ranges of the primitive index array, and the
+// intersection of a ray with a primitive is left to an intersector
+// functor passed to the traversal methods. The occlusion queries stop
+// at the first primitive hit by a ray, no matter whether it is the
+// closest one or not. Nodes are stored in depth-first order: the
+// first child of an interior node is the node next to it. Splits are
+// chosen by the surface area heuristic (SAH) evaluated on
+// BVH_NUMBER_OF_BINS bins of primitive centers, or, for a faster
+// build of a lower quality tree, by the Morton codes of the centers
+// (LBVH). Subtrees of at least BVH_TASK_SIZE primitives are built as
+// tasks shared by a pool of threads; a node reserves the slots of all
+// nodes its subtree may have, so that the tasks fill the node array
+// independently, which is then compacted. The tree is the same
+// whatever the number of threads.
+//
+// When the primitives move, refit() recomputes the node bounds
+// bottom-up, keeping the tree, whose quality then degrades. Once its
+// SAH cost grows by more than a given ratio, the subtree over the
+// primitives which moved is rebuilt or, failing that, the whole tree.
+class BVH
+{
+public:
+	struct Node
+	{
+		BoundingBox bounds;
+		int first; // first primitive (leaf) or second child (interior)
+		int count; // number of primitives (zero for interior nodes)
+
+		bool isLeaf() const
+		{
+			return count > 0;
+		}
+
+	}; // Node
+
+	// How the hierarchy is built
+	enum Method
+	{
+		BinnedSAH,
+		Morton // linear BVH
+	};
+
+	struct BuildOptions
+	{
+		Method method;
+		int numberOfThreads; // 0 = one per processor
+
+		// Constructor
+		BuildOptions(Method m = BinnedSAH, int n = 0):
+			method(m),
+			numberOfThreads(n)
+		{
+			// do nothing
+		}
+
+		bool operator ==(const BuildOptions& o) const
+		{
+			return method == o.method && numberOfThreads == o.numberOfThreads;
+		}
+
+		static const char* getName(Method);
+
+	}; // BuildOptions
+
+	// Tree quality metrics
+	struct Quality
+	{
+		int numberOfNodes;
+		int numberOfLeaves;
+		int maxDepth;
+		REAL averageLeafSize; // primitives per leaf
+		REAL cost; // SAH cost
+
+		// Constructor
+		Quality():
+			numberOfNodes(0),
+			numberOfLeaves(0),
+			maxDepth(0),
+			averageLeafSize(0),
+			cost(0)
+		{
+			// do nothing
+		}
+
+	}; // Quality
+
+	// How refit() updated the hierarchy
+	enum Update
+	{
+		Refitted, // node bounds only
+		PartiallyRebuilt, // node bounds and a subtree
+		Rebuilt // whole tree
+	};
+
+	// Constructor
+	BVH():
+		nodes(0),
+		numberOfNodes(0),
+		primitives(0),
+		numberOfPrimitives(0),
+		costs(0),
+		areas(0),
+		buildCost(0),
+		buildTime(0)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	~BVH()
+	{
+		clear();
+	}
+
+	void build(const BoundingBox*, int, const BuildOptions& = BuildOptions());
+	Update refit(const BoundingBox*, REAL);
+	void clear();
+
+	bool isEmpty() const
+	{
+		return numberOfNodes == 0;
+	}
+
+	int getNumberOfNodes() const
+	{
+		return numberOfNodes;
+	}
+
+	const Node* getNodes() const
+	{
+		return nodes;
+	}
+
+	int getNumberOfPrimitives() const
+	{
+		return numberOfPrimitives;
+	}
+
+	const int* getPrimitives() const
+	{
+		return primitives;
+	}
+
+	BoundingBox getBounds() const
+	{
+		return numberOfNodes > 0 ? nodes[0].bounds : BoundingBox();
+	}
+
+	REAL getCost() const;
+	Quality getQuality() const;
+
+	// Get the bytes taken by the nodes, primitive indices and costs
+	long getMemorySize() const
+	{
+		long size = (long)numberOfNodes * sizeof(Node) +
+			(long)numberOfPrimitives * sizeof(int);
+
+		return costs != 0 ? size + (long)numberOfNodes * 2 * sizeof(REAL) : size;
+	}
+
+	const BuildOptions& getBuildOptions() const
+	{
+		return options;
+	}
+
+	// Get the time spent by the last build, in seconds
+	double getBuildTime() const
+	{
+		return buildTime;
+	}
+
+	// Get the SAH cost of the tree when last built as a whole
+	REAL getBuildCost() const
+	{
+		return buildCost;
+	}
+
+	template <typename Intersector>
+	bool intersect(const Ray&, REAL&, Intersector&) const;
+	template <typename PacketIntersector>
+	int intersect(const RayPacket&, int, Real4&, PacketIntersector&) const;
+	template <typename Intersector>
+	bool occluded(const Ray&, REAL, Intersector&) const;
+	template <typename PacketIntersector>
+	int occluded(const RayPacket&, int, const Real4&, PacketIntersector&) const;
+
+private:
+	Node* nodes;
+	int numberOfNodes;
+	int* primitives;
+	int numberOfPrimitives;
+	// Costs of the subtrees and areas of the nodes when built, kept
+	// once refitted
+	REAL* costs;
+	REAL* areas;
+	REAL buildCost;
+	BuildOptions options;
+	double buildTime;
+
+	struct BuildPrimitive
+	{
+		BoundingBox bounds;
+		Vec3 center;
+		int index;
+
+	}; // BuildPrimitive
+
+	class Builder;
+
+	int split(BuildPrimitive*, int, const BoundingBox&, const BoundingBox&) const;
+	static int intersect(const BoundingBox&,
+		const RayPacket&,
+		int,
+		const Real4&,
+		Real4&);
+	void build(BuildPrimitive*, int, int);
+	void rebuild(const BoundingBox*, int, int);
+	void saveCosts();
+
+	BVH(const BVH&);
+	BVH& operator =(const BVH&);
+
+}; // BVH
+
+
+//////////////////////////////////////////////////////////
+//
+// BVH inline implementation
+// ===
+inline const char*
+BVH::BuildOptions::getName(Method method)
+{
+	static const char* names[] = {"sah", "morton"};
+
+	return names[method];
+}
+
+template <typename Intersector>
+bool
+BVH::intersect(const Ray& ray, REAL& distance, Intersector& intersector) const
+//[]---------------------------------------------------[]
+//|  Front-to-back closest hit traversal                |
+//|  @param the ray (input)                             |
+//|  @param distance of the closest hit (input/output)  |
+//|  @param primitive intersector                       |
+//|  @return true if the ray intersects a primitive     |
+//|                                                     |
+//|  intersector(i, distance) must test the primitive i |
+//|  and, if it is hit closer than distance, update     |
+//|  distance and return true.                          |
+//[]---------------------------------------------------[]
+{
+	if (numberOfNodes == 0)
+		return false;
+
+	Vec3 invDirection = ray.direction.inverse();
+	REAL tMin;
+	REAL tMax;
+
+	if (!nodes[0].bounds.intersect(ray.origin, invDirection, tMin, tMax) ||
+		tMin > distance)
+		return false;
+
+	int stack[BVH_STACK_SIZE];
+	REAL stackDistance[BVH_STACK_SIZE];
+	int top = 0;
+	int current = 0;
+	bool hit = false;
+
+	for (;;)
+	{
+		const Node& node = nodes[current];
+
+		COUNT_STATISTIC(NodeVisits, 1);
+		if (node.isLeaf())
+		{
+			const int* p = primitives + node.first;
+
+			for (int i = 0; i < node.count; i++)
+				if (intersector(p[i], distance))
+					hit = true;
+		}
+		else
+		{
+			int c1 = current + 1;
+			int c2 = node.first;
+			REAL t1, t2;
+			bool hit1 = nodes[c1].bounds.intersect(ray.origin,
+				invDirection,
+				t1,
+				tMax) && t1 <= distance;
+			bool hit2 = nodes[c2].bounds.intersect(ray.origin,
+				invDirection,
+				t2,
+				tMax) && t2 <= distance;
+
+			if (hit1 && hit2)
+			{
+				// visit the nearest child first
+				if (t2 < t1)
+				{
+					int c = c1;
+
+					c1 = c2;
+					c2 = c;
+				}
+				stackDistance[top] = Math::max(t1, t2);
+				stack[top++] = c2;
+				current = c1;
+				continue;
+			}
+			if (hit1 || hit2)
+			{
+				current = hit1 ? c1 : c2;
+				continue;
+			}
+		}
+		// pop the next node not farther than the closest hit
+		do
+		{
+			if (top == 0)
+				return hit;
+			current = stack[--top];
+		} while (stackDistance[top] > distance);
+	}
+}
+
+inline int
+BVH::intersect(const BoundingBox& box,
+	const RayPacket& packet,
+	int mask,
+	const Real4& distance,
+	Real4& tMin)
+//[]---------------------------------------------------[]
+//|  Packet/box slab test                               |
+//|  @return mask of the lanes of mask which hit the    |
+//|  box not farther than distance                      |
+//[]---------------------------------------------------[]
+{
+	const Vec3& p1 = box.getP1();
+	const Vec3& p2 = box.getP2();
+	Real4 t1 = (Real4(p1.x) - packet.origin[0]) * packet.invDirection[0];
+	Real4 t2 = (Real4(p2.x) - packet.origin[0]) * packet.invDirection[0];
+	Real4 tMax;
+
+	tMin = min(t1, t2);
+	tMax = max(t1, t2);
+	for (int k = 1; k < 3; k++)
+	{
+		t1 = (Real4(p1[k]) - packet.origin[k]) * packet.invDirection[k];
+		t2 = (Real4(p2[k]) - packet.origin[k]) * packet.invDirection[k];
+		tMin = max(tMin, min(t1, t2));
+		tMax = min(tMax, max(t1, t2));
+	}
+	return mask &
+		((tMin <= tMax) & (tMax >= Real4(0)) & (tMin <= distance)).getMask();
+}
+
+template <typename PacketIntersector>
+int
+BVH::intersect(const RayPacket& packet,
+	int mask,
+	Real4& distance,
+	PacketIntersector& intersector) const
+//[]---------------------------------------------------[]
+//|  Front-to-back closest hit packet traversal         |
+//|  @param the ray packet (input)                      |
+//|  @param mask of the lanes to be traced              |
+//|  @param distances of the closest hits (input/output)|
+//|  @param primitive packet intersector                |
+//|  @return mask of the lanes which hit a primitive    |
+//|                                                     |
+//|  intersector(i, mask, distance) must test the lanes |
+//|  of mask against the primitive i, update distance   |
+//|  of the lanes hit closer and return their mask. A   |
+//|  node is visited if any lane hits its bounds.       |
+//[]---------------------------------------------------[]
+{
+	Real4 tMin;
+
+	if (numberOfNodes == 0 ||
+		(mask = intersect(nodes[0].bounds, packet, mask, distance, tMin)) == 0)
+		return 0;
+
+	int stack[BVH_STACK_SIZE];
+	int stackMask[BVH_STACK_SIZE];
+	Real4 stackDistance[BVH_STACK_SIZE];
+	int top = 0;
+	int current = 0;
+	int hit = 0;
+
+	for (;;)
+	{
+		const Node& node = nodes[current];
+
+		COUNT_STATISTIC(PacketNodeVisits, 1);
+		if (node.isLeaf())
+		{
+			const int* p = primitives + node.first;
+
+			for (int i = 0; i < node.count; i++)
+				hit |= intersector(p[i], mask, distance);
+		}
+		else
+		{
+			int c1 = current + 1;
+			int c2 = node.first;
+			Real4 t1, t2;
+			int m1 = intersect(nodes[c1].bounds, packet, mask, distance, t1);
+			int m2 = intersect(nodes[c2].bounds, packet, mask, distance, t2);
+
+			if (m1 != 0 && m2 != 0)
+			{
+				// visit first the child nearest to most lanes
+				int both = m1 & m2;
+				int nearer2 = (t2 < t1).getMask() & both;
+
+				if (countLanes(nearer2) > countLanes(both & ~nearer2))
+				{
+					int c = c1;
+					int m = m1;
+					Real4 t = t1;
+
+					c1 = c2, m1 = m2, t1 = t2;
+					c2 = c, m2 = m, t2 = t;
+				}
+				stackDistance[top] = t2;
+				stackMask[top] = m2;
+				stack[top++] = c2;
+				current = c1;
+				mask = m1;
+				continue;
+			}
+			if ((m1 | m2) != 0)
+			{
+				current = m1 != 0 ? c1 : c2;
+				mask = m1 | m2;
+				continue;
+			}
+		}
+		// pop the next node not farther than the closest hits
+		do
+		{
+			if (top == 0)
+				return hit;
+			--top;
+			current = stack[top];
+			mask = stackMask[top] & (stackDistance[top] <= distance).getMask();
+		} while (mask == 0);
+	}
+}
+
+template <typename Intersector>
+bool
+BVH::occluded(const Ray& ray, REAL maxDist, Intersector& intersector) const
+//[]---------------------------------------------------[]
+//|  Any hit traversal                                  |
+//|  @param the ray                                     |
+//|  @param distance beyond which hits do not count     |
+//|  @param primitive intersector (as in intersect())   |
+//|  @return true if the ray hits any primitive closer  |
+//|  than maxDist                                       |
+//[]---------------------------------------------------[]
+{
+	if (numberOfNodes == 0)
+		return false;
+
+	Vec3 invDirection = ray.direction.inverse();
+	int stack[BVH_STACK_SIZE];
+	int top = 0;
+	int current = 0;
+
+	for (;;)
+	{
+		const Node& node = nodes[current];
+		REAL tMin;
+		REAL tMax;
+
+		COUNT_STATISTIC(NodeVisits, 1);
+		if (node.bounds.intersect(ray.origin, invDirection, tMin, tMax) &&
+			tMin <= maxDist)
+		{
+			if (!node.isLeaf())
+			{
+				stack[top++] = node.first;
+				current++;
+				continue;
+			}
+
+			const int* p = primitives + node.first;
+
+			for (int i = 0; i < node.count; i++)
+			{
+				REAL distance = maxDist;
+
+				if (intersector(p[i], distance))
+					return true;
+			}
+		}
+		if (top == 0)
+			return false;
+		current = stack[--top];
+	}
+}
+
+template <typename PacketIntersector>
+int
+BVH::occluded(const RayPacket& packet,
+	int mask,
+	const Real4& maxDist,
+	PacketIntersector& intersector) const
+//[]---------------------------------------------------[]
+//|  Any hit packet traversal                           |
+//|  @param the ray packet                              |
+//|  @param mask of the lanes to be traced              |
+//|  @param distances beyond which hits do not count    |
+//|  @param primitive packet intersector (as in         |
+//|  intersect())                                       |
+//|  @return mask of the lanes which hit any primitive  |
+//|  closer than maxDist                                |
+//|                                                     |
+//|  Lanes are retired as soon as they are occluded.    |
+//[]---------------------------------------------------[]
+{
+	if (numberOfNodes == 0 || mask == 0)
+		return 0;
+
+	int stack[BVH_STACK_SIZE];
+	int top = 0;
+	int current = 0;
+	int occluded = 0;
+
+	for (;;)
+	{
+		const Node& node = nodes[current];
+		Real4 tMin;
+		int live = intersect(node.bounds, packet, mask & ~occluded, maxDist, tMin);
+
+		COUNT_STATISTIC(PacketNodeVisits, 1);
+		if (live != 0)
+		{
+			if (!node.isLeaf())
+			{
+				stack[top++] = node.first;
+				current++;
+				continue;
+			}
+
+			const int* p = primitives + node.first;
+
+			for (int i = 0; i < node.count && live != 0; i++)
+			{
+				Real4 distance = maxDist;
+				int hit = intersector(p[i], live, distance);
+
+				occluded |= hit;
+				live &= ~hit;
+			}
+			if ((mask & ~occluded) == 0)
+				return occluded;
+		}
+		if (top == 0)
+			return occluded;
+		current = stack[--top];
+	}
+}
+
+} // end namespace Graphics
+
+#endif // __BVH_h
@@ -21,6 +21,9 @@
 #ifndef __Color_h
 #include "Color.h"
 #endif
+#ifndef __Transform3_h
+#include "Transform3.h"
+#endif
 
 using namespace System;
 
@@ -58,4 +61,23 @@ operator >>(ObjectInputStream& ois, Color& c)
 	return ois;
 }
 
+//
+// 3D transformation serialization ops
+//
+inline ObjectOutputStream&
+operator <<(ObjectOutputStream& oos, const Transf3& m)
+{
+	for (int i = 0; i < 4; i++)
+		oos << m(i, _X) << m(i, _Y) << m(i, _Z) << m(i, _W);
+	return oos;
+}
+
+inline ObjectInputStream&
+operator >>(ObjectInputStream& ois, Transf3& m)
+{
+	for (int i = 0; i < 4; i++)
+		ois >> m(i, _X) >> m(i, _Y) >> m(i, _Z) >> m(i, _W);
+	return ois;
+}
+
 #endif // __BaseTypes_h
@@ -0,0 +1,320 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __MemoryImage_h
+#include "MemoryImage.h"
+#endif
+#ifndef __RayTracer_h
+#include "RayTracer.h"
+#endif
+#ifndef __Sphere_h
+#include "Sphere.h"
+#endif
+#ifndef __Timer_h
+#include "Timer.h"
+#endif
+
+using namespace Graphics;
+
+// Options
+int w = 640;
+int h = 480;
+int numberOfThreads = 0;
+int tileSize = 16;
+int numberOfRuns = 1;
+int numberOfViews = 1;
+bool packetTracing = true;
+bool wavefrontTracing = false;
+bool occluderCaching = true;
+int maxSamples = 1;
+REAL contrastThreshold = 0.1f;
+ToneMap toneMap;
+const char* fileName = "image.ppm";
+
+inline void
+printUsage()
+{
+	printf("\n"
+		"Usage: Batch [options]\n"
+		"----------------------\n"
+		"-o <file>    output image, PPM or PNG by extension (image.ppm)\n"
+		"-w <width>   image width (640)\n"
+		"-h <height>  image height (480)\n"
+		"-t <threads> number of threads, 0 = one per processor (0)\n"
+		"-s <size>    tile size (16)\n"
+		"-r <runs>    number of timed renders (1)\n"
+		"-v <views>   render views around the scene concurrently, written\n"
+		"             to files numbered after the output one (1)\n"
+		"-a <samples> antialias with up to samples rays per pixel (1)\n"
+		"-c <level>   antialiasing contrast threshold, 0-1 (0.1)\n"
+		"-e <scale>   exposure (1)\n"
+		"-g <gamma>   gamma (1)\n"
+		"-reinhard    compress highlights instead of clamping them\n"
+		"-dither      dither the 8-bit output\n"
+		"-nopackets   trace single rays only\n"
+		"-wavefront   trace the rays of each tile in waves\n"
+		"-nocache     do not cache shadow occluders\n\n");
+}
+
+bool
+parseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* option = argv[i];
+
+		if (!strcmp(option, "-nopackets"))
+			packetTracing = false;
+		else if (!strcmp(option, "-wavefront"))
+			wavefrontTracing = true;
+		else if (!strcmp(option, "-nocache"))
+			occluderCaching = false;
+		else if (!strcmp(option, "-reinhard"))
+			toneMap.op = ToneMap::Reinhard;
+		else if (!strcmp(option, "-dither"))
+			toneMap.dithering = true;
+		else if (i + 1 >= argc)
+			return false;
+		else if (!strcmp(option, "-o"))
+			fileName = argv[++i];
+		else if (!strcmp(option, "-w"))
+			w = atoi(argv[++i]);
+		else if (!strcmp(option, "-h"))
+			h = atoi(argv[++i]);
+		else if (!strcmp(option, "-t"))
+			numberOfThreads = atoi(argv[++i]);
+		else if (!strcmp(option, "-s"))
+			tileSize = atoi(argv[++i]);
+		else if (!strcmp(option, "-r"))
+			numberOfRuns = atoi(argv[++i]);
+		else if (!strcmp(option, "-v"))
+			numberOfViews = atoi(argv[++i]);
+		else if (!strcmp(option, "-a"))
+			maxSamples = atoi(argv[++i]);
+		else if (!strcmp(option, "-c"))
+			contrastThreshold = (REAL)atof(argv[++i]);
+		else if (!strcmp(option, "-e"))
+			toneMap.exposure = (REAL)atof(argv[++i]);
+		else if (!strcmp(option, "-g"))
+			toneMap.gamma = (REAL)atof(argv[++i]);
+		else
+			return false;
+	}
+	return w > 0 &&
+		h > 0 &&
+		numberOfRuns > 0 &&
+		numberOfViews > 0 &&
+		toneMap.gamma > 0;
+}
+
+bool
+hasExtension(const char* fileName, const char* ext)
+{
+	size_t n = strlen(fileName);
+	size_t m = strlen(ext);
+
+	if (n < m)
+		return false;
+	for (fileName += n - m; *ext != 0; fileName++, ext++)
+		if (tolower(*fileName) != tolower(*ext))
+			return false;
+	return true;
+}
+
+void
+makeViewFileName(int view, char* name, size_t size)
+{
+	// image.ppm -> image-<view>.ppm
+	const char* ext = strrchr(fileName, '.');
+	int n = ext != 0 ? (int)(ext - fileName) : (int)strlen(fileName);
+
+	snprintf(name, size, "%.*s-%d%s", n, fileName, view + 1, ext ? ext : "");
+}
+
+bool
+writeImage(const MemoryImage& image, const char* fileName)
+{
+	bool ok = hasExtension(fileName, ".png") ?
+		image.writePNG(fileName) :
+		image.writePPM(fileName);
+
+	if (!ok)
+	{
+		printf("Unable to write %s\n", fileName);
+		return false;
+	}
+	printf("Image written to %s\n", fileName);
+	return true;
+}
+
+//
+// View renderer thread of a multi-view batch
+//
+class ViewThread: public Thread
+{
+public:
+	RayTracer* rayTracer;
+	Camera* camera;
+	MemoryImage* image;
+	double time;
+
+protected:
+	void run()
+	{
+		System::Timer timer;
+
+		rayTracer->renderImage(*image, *camera);
+		time = timer.getElapsedTime();
+	}
+
+}; // ViewThread
+
+Material*
+createMaterial(const String& name, const Color& c)
+{
+	Material* material = MaterialFactory::New(name);
+
+	material->surface.ambient = c * 0.2;
+	material->surface.diffuse = c * 0.5;
+	material->surface.spot = c * 0.9;
+	material->surface.shine = 5;
+	return material;
+}
+
+Scene*
+createScene(const String& name)
+{
+	Scene* scene = new Scene(name);
+	Primitive* model;
+
+	model = new Sphere(Vec3(0, 0 , 0), 1.0f);
+	model->setMaterial(createMaterial(L"yellow", Color::yellow));
+	scene->addActor(new Actor(*model));
+	scene->addLight(new Light(Vec3(2, 2, 2)));
+	scene->backgroundColor = Color::blue;
+	return scene;
+}
+
+Camera*
+createCamera()
+{
+	Camera* camera = new Camera();
+
+	camera->setPosition(Vec3(0, 0, 2));
+	camera->setAspectRatio((REAL)w / h);
+	return camera;
+}
+
+int
+renderViews(RayTracer& rayTracer, const Camera& camera)
+{
+	// the views orbit the scene, each one rendered by its own thread
+	// with the ray tracer shared by all of them
+	ViewThread* views = new ViewThread[numberOfViews];
+	double best = 0;
+	double total = 0;
+
+	for (int v = 0; v < numberOfViews; v++)
+	{
+		Camera* c = new Camera(camera);
+
+		c->azimuth((REAL)360 * v / numberOfViews);
+		c->updateView();
+		views[v].rayTracer = &rayTracer;
+		views[v].camera = c;
+		views[v].image = new MemoryImage(w, h);
+	}
+	for (int i = 0; i < numberOfRuns; i++)
+	{
+		System::Timer timer;
+
+		for (int v = 0; v < numberOfViews; v++)
+			views[v].start();
+		for (int v = 0; v < numberOfViews; v++)
+			views[v].join();
+
+		double time = timer.getElapsedTime();
+
+		printf("Run %d: %.3f s (views:", i + 1, time);
+		for (int v = 0; v < numberOfViews; v++)
+			printf(" %.3f", views[v].time);
+		printf(")\n");
+		if (i == 0 || time < best)
+			best = time;
+		total += time;
+	}
+	printf("Image: %dx%d, %d view(s), %d run(s)\n",
+		w,
+		h,
+		numberOfViews,
+		numberOfRuns);
+	printf("Time: best %.3f s, average %.3f s\n", best, total / numberOfRuns);
+	printf("Views/s: %.2f\n", numberOfViews / best);
+
+	int result = 0;
+
+	for (int v = 0; v < numberOfViews; v++)
+	{
+		char name[256];
+
+		makeViewFileName(v, name, sizeof(name));
+		if (!writeImage(*views[v].image, name))
+			result = 1;
+		delete views[v].image;
+		delete views[v].camera;
+	}
+	delete []views;
+	return result;
+}
+
+int
+main(int argc, char** argv)
+{
+	if (!parseOptions(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+
+	Scene* scene = createScene(L"scene1");
+	Camera* camera = createCamera();
+	RayTracer rayTracer(*scene, camera);
+	MemoryImage image(w, h);
+	double best = 0;
+	double total = 0;
+
+	camera->updateView();
+	rayTracer.setNumberOfThreads(numberOfThreads);
+	rayTracer.setTileSize(tileSize);
+	rayTracer.setPacketTracing(packetTracing);
+	rayTracer.setWavefrontTracing(wavefrontTracing);
+	rayTracer.setOccluderCaching(occluderCaching);
+	rayTracer.setMaxSamples(maxSamples);
+	rayTracer.setContrastThreshold(contrastThreshold);
+	rayTracer.setToneMap(toneMap);
+	if (numberOfViews > 1)
+		return renderViews(rayTracer, *camera);
+	for (int i = 0; i < numberOfRuns; i++)
+	{
+		System::Timer timer;
+
+		rayTracer.renderImage(image);
+
+		double time = timer.getElapsedTime();
+
+		printf("Run %d: %.3f s\n", i + 1, time);
+		if (i == 0 || time < best)
+			best = time;
+		total += time;
+	}
+
+	double rays = (double)rayTracer.getRayCounts().primary;
+
+	printf("Image: %dx%d, %d run(s)\n", w, h, numberOfRuns);
+	printf("Time: best %.3f s, average %.3f s\n", best, total / numberOfRuns);
+	printf("Primary rays/s: %.0f\n", rays / best);
+	rayTracer.printStatistics();
+	return writeImage(image, fileName) ? 0 : 1;
+}
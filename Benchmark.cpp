@@ -0,0 +1,514 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __MemoryImage_h
+#include "MemoryImage.h"
+#endif
+#ifndef __MeshModel_h
+#include "MeshModel.h"
+#endif
+#ifndef __RayTracer_h
+#include "RayTracer.h"
+#endif
+#ifndef __SceneGenerator_h
+#include "SceneGenerator.h"
+#endif
+#ifndef __Timer_h
+#include "Timer.h"
+#endif
+
+using namespace Graphics;
+
+//
+// Benchmark scene
+//
+struct Benchmark
+{
+	const char* name;
+	const char* description;
+	int numberOfSpheres;
+	int numberOfMeshSpheres;
+	int numberOfCylinders;
+	int sphereSegments;
+	int numberOfInstances;
+	int numberOfLights;
+	REAL reflectivity;
+	int maxRecursionLevel;
+};
+
+Benchmark benchmarks[] =
+{
+	{"spheres", "random analytic spheres", 1000, 0, 0, 16, 0, 1, 0, 10},
+	{"meshes", "tessellated spheres and cylinders", 0, 250, 250, 16, 0, 1, 0, 10},
+	{"bigmesh", "one sphere of two million triangles", 0, 1, 0, 724, 0, 1, 0, 10},
+	{"instances", "instances of a sphere and a cylinder", 0, 0, 0, 16, 500, 1, 0, 10},
+	{"lights", "random spheres lit by many lights", 200, 0, 0, 16, 0, 16, 0, 10},
+	{"reflections", "mirror spheres, deep reflections", 200, 0, 0, 16, 0, 2, 0.9f, 16}
+};
+
+const int numberOfBenchmarks = sizeof(benchmarks) / sizeof(Benchmark);
+
+// Options
+int w = 640;
+int h = 480;
+int numberOfThreads = 0;
+int tileSize = 16;
+int numberOfRuns = 3;
+int scale = 1;
+bool packetTracing = true;
+bool wavefrontTracing = false;
+bool animate = false;
+Accelerator::Type acceleratorType = Accelerator::Hierarchy;
+bool allAccelerators = false; // run each benchmark with each accelerator
+REAL rebuildThreshold = 1.5f;
+BVH::BuildOptions bvhOptions;
+bool occluderCaching = true;
+int maxSamples = 1;
+REAL contrastThreshold = 0.1f;
+const char* benchmarkName = 0;
+const char* fileName = 0;
+
+//
+// Benchmark result
+//
+struct Result
+{
+	int numberOfActors;
+	int numberOfTriangles; // triangles of the actors
+	int numberOfMeshTriangles; // triangles stored (instances share them)
+	double sceneTime; // time to make the scene, including the mesh BVHs
+	double meshBVHTime; // time to build the BVHs of the stored meshes
+	BVH::Quality meshBVH; // node counts of all, max depth and cost of the largest
+	long meshBVHMemory; // bytes taken by the compressed BVHs
+	double firstTime; // time of the first render, including the scene BVH
+	double bestTime;
+	double averageTime;
+	RayTracer::RayCounts rays; // rays of one render
+	OccluderCache::Statistics cache; // cache statistics of one render
+	Wavefront::Statistics wavefront; // stage timing of one render
+	Accelerator::Statistics accelerator; // scene accelerator updates of all renders
+};
+
+inline bool
+isSelected(int type)
+{
+	return allAccelerators || type == acceleratorType;
+}
+
+inline void
+printUsage()
+{
+	printf("\n"
+		"Usage: Benchmark [options]\n"
+		"--------------------------\n"
+		"-b <name>    run only the named benchmark\n"
+		"-o <file>    write the JSON report to a file (stdout)\n"
+		"-w <width>   image width (640)\n"
+		"-h <height>  image height (480)\n"
+		"-t <threads> number of threads, 0 = one per processor (0)\n"
+		"-s <size>    tile size (16)\n"
+		"-r <runs>    number of timed renders per benchmark (3)\n"
+		"-x <scale>   multiply the number of models by scale (1)\n"
+		"-a <samples> antialias with up to samples rays per pixel (1)\n"
+		"-c <level>   antialiasing contrast threshold, 0-1 (0.1)\n"
+		"-nopackets   trace single rays only\n"
+		"-wavefront   trace the rays of each tile in waves\n"
+		"-nocache     do not cache shadow occluders\n"
+		"-animate     move the actors before each timed render\n"
+		"-accel <name> accelerator, bvh, grid, kdtree or all (bvh)\n"
+		"-u <ratio>   BVH cost ratio beyond which it is rebuilt (1.5)\n"
+		"-bvh <name>  BVH builder, sah or morton (sah)\n"
+		"-bt <n>      BVH build threads, 0 = one per processor (0)\n"
+		"\nBenchmarks:\n");
+	for (int i = 0; i < numberOfBenchmarks; i++)
+		printf("%-12s %s\n", benchmarks[i].name, benchmarks[i].description);
+	printf("\n");
+}
+
+bool
+parseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* option = argv[i];
+
+		if (!strcmp(option, "-nopackets"))
+			packetTracing = false;
+		else if (!strcmp(option, "-wavefront"))
+			wavefrontTracing = true;
+		else if (!strcmp(option, "-nocache"))
+			occluderCaching = false;
+		else if (!strcmp(option, "-animate"))
+			animate = true;
+		else if (i + 1 >= argc)
+			return false;
+		else if (!strcmp(option, "-b"))
+			benchmarkName = argv[++i];
+		else if (!strcmp(option, "-o"))
+			fileName = argv[++i];
+		else if (!strcmp(option, "-w"))
+			w = atoi(argv[++i]);
+		else if (!strcmp(option, "-h"))
+			h = atoi(argv[++i]);
+		else if (!strcmp(option, "-t"))
+			numberOfThreads = atoi(argv[++i]);
+		else if (!strcmp(option, "-s"))
+			tileSize = atoi(argv[++i]);
+		else if (!strcmp(option, "-r"))
+			numberOfRuns = atoi(argv[++i]);
+		else if (!strcmp(option, "-x"))
+			scale = atoi(argv[++i]);
+		else if (!strcmp(option, "-a"))
+			maxSamples = atoi(argv[++i]);
+		else if (!strcmp(option, "-c"))
+			contrastThreshold = (REAL)atof(argv[++i]);
+		else if (!strcmp(option, "-u"))
+			rebuildThreshold = (REAL)atof(argv[++i]);
+		else if (!strcmp(option, "-accel"))
+		{
+			const char* name = argv[++i];
+			int t = 0;
+
+			if ((allAccelerators = !strcmp(name, "all")))
+				continue;
+			while (t < Accelerator::NumberOfTypes &&
+				strcmp(name, Accelerator::getName((Accelerator::Type)t)))
+				t++;
+			if (t == Accelerator::NumberOfTypes)
+				return false;
+			acceleratorType = (Accelerator::Type)t;
+		}
+		else if (!strcmp(option, "-bvh"))
+		{
+			const char* name = argv[++i];
+
+			if (!strcmp(name, BVH::BuildOptions::getName(BVH::BinnedSAH)))
+				bvhOptions.method = BVH::BinnedSAH;
+			else if (!strcmp(name, BVH::BuildOptions::getName(BVH::Morton)))
+				bvhOptions.method = BVH::Morton;
+			else
+				return false;
+		}
+		else if (!strcmp(option, "-bt"))
+			bvhOptions.numberOfThreads = atoi(argv[++i]);
+		else
+			return false;
+	}
+	if (benchmarkName != 0)
+	{
+		int i = 0;
+
+		while (i < numberOfBenchmarks && strcmp(benchmarkName, benchmarks[i].name))
+			i++;
+		if (i == numberOfBenchmarks)
+			return false;
+	}
+	return w > 0 && h > 0 && numberOfRuns > 0 && scale > 0;
+}
+
+void
+countTriangles(Scene& scene, Result& result)
+{
+	MeshModel** models = new MeshModel*[scene.getNumberOfActors()];
+	int numberOfModels = 0;
+	int n = 0;
+	int stored = 0;
+	int largest = 0;
+
+	result.meshBVHTime = 0;
+	result.meshBVH = BVH::Quality();
+	result.meshBVHMemory = 0;
+	for (ActorIterator ait(scene.getActorIterator()); ait; ++ait)
+	{
+		MeshModel* model = dynamic_cast<MeshModel*>(ait.current()->getModel());
+
+		if (model == 0)
+			continue;
+
+		int t = model->getMesh()->getData().numberOfTriangles;
+		int i = 0;
+
+		n += t;
+		// the models of the instances are counted once
+		while (i < numberOfModels && models[i] != model)
+			i++;
+		if (i == numberOfModels)
+		{
+			const WideBVH& bvh = model->getBVH();
+			BVH::Quality q = bvh.getQuality();
+
+			models[numberOfModels++] = model;
+			stored += t;
+			result.meshBVHTime += bvh.getBuildTime();
+			result.meshBVHMemory += bvh.getMemorySize();
+			result.meshBVH.numberOfNodes += q.numberOfNodes;
+			result.meshBVH.numberOfLeaves += q.numberOfLeaves;
+			if (t > largest)
+			{
+				largest = t;
+				result.meshBVH.maxDepth = q.maxDepth;
+				result.meshBVH.cost = q.cost;
+			}
+		}
+	}
+	delete []models;
+	result.numberOfTriangles = n;
+	result.numberOfMeshTriangles = stored;
+	if (result.meshBVH.numberOfLeaves > 0)
+		result.meshBVH.averageLeafSize =
+			(REAL)stored / result.meshBVH.numberOfLeaves;
+}
+
+void
+moveActors(Scene& scene, SceneGenerator& generator)
+{
+	Transf3 m;
+
+	for (ActorIterator ait(scene.getActorIterator()); ait; ++ait)
+	{
+		Actor* actor = ait.current();
+		Transf3 t = actor->getTransform();
+		REAL x = generator.random(-0.2f, 0.2f);
+		REAL y = generator.random(-0.2f, 0.2f);
+		REAL z = generator.random(-0.2f, 0.2f);
+
+		t.compose(m.translation(Vec3(x, y, z)));
+		actor->setTransform(t);
+	}
+}
+
+void
+run(const Benchmark& b, Accelerator::Type type, Result& result)
+{
+	SceneGenerator::Parameters p;
+
+	p.numberOfSpheres = b.numberOfSpheres * scale;
+	p.numberOfMeshSpheres = b.numberOfMeshSpheres * scale;
+	p.numberOfCylinders = b.numberOfCylinders * scale;
+	p.sphereSegments = b.sphereSegments;
+	p.numberOfInstances = b.numberOfInstances * scale;
+	p.numberOfLights = b.numberOfLights;
+	p.reflectivity = b.reflectivity;
+	p.bvhOptions = bvhOptions;
+
+	SceneGenerator generator;
+	System::Timer timer;
+	Scene* scene = generator.makeScene(b.name, p);
+
+	result.sceneTime = timer.getElapsedTime();
+	result.numberOfActors = scene->getNumberOfActors();
+	countTriangles(*scene, result);
+
+	Camera* camera = generator.makeCamera((REAL)w / h);
+	MemoryImage image(w, h);
+
+	{
+		RayTracer rayTracer(*scene, camera);
+
+		rayTracer.setAcceleratorType(type);
+		rayTracer.setNumberOfThreads(numberOfThreads);
+		rayTracer.setTileSize(tileSize);
+		rayTracer.setPacketTracing(packetTracing);
+		rayTracer.setWavefrontTracing(wavefrontTracing);
+		rayTracer.setOccluderCaching(occluderCaching);
+		rayTracer.setMaxSamples(maxSamples);
+		rayTracer.setContrastThreshold(contrastThreshold);
+		rayTracer.setMaxRecursionLevel(b.maxRecursionLevel);
+		rayTracer.setRebuildThreshold(rebuildThreshold);
+		// the first render also builds the scene accelerator
+		timer.start();
+		rayTracer.renderImage(image);
+		result.firstTime = timer.getElapsedTime();
+
+		double total = 0;
+
+		for (int i = 0; i < numberOfRuns; i++)
+		{
+			if (animate)
+				moveActors(*scene, generator);
+			// the render also updates the scene accelerator
+			timer.start();
+			rayTracer.renderImage(image);
+
+			double time = timer.getElapsedTime();
+
+			if (i == 0 || time < result.bestTime)
+				result.bestTime = time;
+			total += time;
+		}
+		result.averageTime = total / numberOfRuns;
+		result.rays = rayTracer.getRayCounts();
+		result.cache = rayTracer.getOccluderCacheStatistics();
+		result.wavefront = rayTracer.getWavefrontStatistics();
+		result.accelerator = rayTracer.getAcceleratorStatistics();
+	}
+	// the ray tracer has released the scene
+	delete camera;
+}
+
+void
+writeReport(FILE* file, const Result* results)
+{
+	fprintf(file, "{\n");
+	fprintf(file, "  \"width\": %d,\n", w);
+	fprintf(file, "  \"height\": %d,\n", h);
+	fprintf(file, "  \"threads\": %d,\n", numberOfThreads > 0 ?
+		numberOfThreads :
+		Thread::getNumberOfProcessors());
+	fprintf(file, "  \"tileSize\": %d,\n", tileSize);
+	fprintf(file, "  \"runs\": %d,\n", numberOfRuns);
+	fprintf(file, "  \"scale\": %d,\n", scale);
+	fprintf(file, "  \"packetTracing\": %s,\n", packetTracing ? "true" : "false");
+	fprintf(file,
+		"  \"wavefrontTracing\": %s,\n",
+		wavefrontTracing ? "true" : "false");
+	fprintf(file, "  \"occluderCaching\": %s,\n", occluderCaching ? "true" : "false");
+	fprintf(file, "  \"maxSamples\": %d,\n", maxSamples);
+	fprintf(file, "  \"contrastThreshold\": %.3f,\n", contrastThreshold);
+	fprintf(file, "  \"animate\": %s,\n", animate ? "true" : "false");
+	fprintf(file,
+		"  \"accelerator\": \"%s\",\n",
+		allAccelerators ? "all" : Accelerator::getName(acceleratorType));
+	fprintf(file, "  \"rebuildThreshold\": %.3f,\n", rebuildThreshold);
+	fprintf(file,
+		"  \"bvhBuilder\": \"%s\",\n",
+		BVH::BuildOptions::getName(bvhOptions.method));
+	fprintf(file, "  \"bvhThreads\": %d,\n", bvhOptions.numberOfThreads);
+	fprintf(file, "  \"benchmarks\": [");
+
+	bool first = true;
+
+	for (int i = 0; i < numberOfBenchmarks * Accelerator::NumberOfTypes; i++)
+	{
+		const Benchmark& b = benchmarks[i / Accelerator::NumberOfTypes];
+		int type = i % Accelerator::NumberOfTypes;
+
+		if ((benchmarkName != 0 && strcmp(benchmarkName, b.name)) ||
+			!isSelected(type))
+			continue;
+
+		const Result& r = results[i];
+		const Accelerator::Statistics& a = r.accelerator;
+		double mrays = r.rays.getTotal() / r.bestTime * 1e-6;
+
+		fprintf(file, "%s\n    {\n", first ? "" : ",");
+		fprintf(file, "      \"name\": \"%s\",\n", b.name);
+		fprintf(file,
+			"      \"accelerator\": \"%s\",\n",
+			Accelerator::getName((Accelerator::Type)type));
+		fprintf(file, "      \"actors\": %d,\n", r.numberOfActors);
+		fprintf(file, "      \"triangles\": %d,\n", r.numberOfTriangles);
+		fprintf(file, "      \"meshTriangles\": %d,\n", r.numberOfMeshTriangles);
+		fprintf(file, "      \"lights\": %d,\n", b.numberOfLights);
+		fprintf(file, "      \"maxRecursionLevel\": %d,\n", b.maxRecursionLevel);
+		fprintf(file, "      \"sceneTime\": %.6f,\n", r.sceneTime);
+		fprintf(file, "      \"meshBVHTime\": %.6f,\n", r.meshBVHTime);
+		fprintf(file, "      \"meshBVHNodes\": %d,\n", r.meshBVH.numberOfNodes);
+		fprintf(file,
+			"      \"meshBVHLeafSize\": %.3f,\n",
+			r.meshBVH.averageLeafSize);
+		fprintf(file, "      \"meshBVHMaxDepth\": %d,\n", r.meshBVH.maxDepth);
+		fprintf(file, "      \"meshBVHCost\": %.3f,\n", r.meshBVH.cost);
+		fprintf(file, "      \"meshBVHMemory\": %ld,\n", r.meshBVHMemory);
+		fprintf(file, "      \"firstRenderTime\": %.6f,\n", r.firstTime);
+		fprintf(file, "      \"bestTime\": %.6f,\n", r.bestTime);
+		fprintf(file, "      \"averageTime\": %.6f,\n", r.averageTime);
+		fprintf(file, "      \"primaryRays\": %ld,\n", r.rays.primary);
+		fprintf(file, "      \"secondaryRays\": %ld,\n", r.rays.secondary);
+		fprintf(file, "      \"shadowRays\": %ld,\n", r.rays.shadow);
+		fprintf(file, "      \"totalRays\": %ld,\n", r.rays.getTotal());
+		fprintf(file, "      \"mraysPerSecond\": %.3f,\n", mrays);
+		// scene accelerator updates of all renders
+		fprintf(file, "      \"acceleratorBuilds\": %d,\n", a.builds);
+		fprintf(file, "      \"acceleratorBuildTime\": %.6f,\n", a.buildTime);
+		fprintf(file, "      \"acceleratorMemory\": %ld,\n", a.memorySize);
+		fprintf(file, "      \"acceleratorCost\": %.3f,\n", a.cost);
+		if (type == Accelerator::Hierarchy)
+		{
+			// kept under their former names
+			fprintf(file, "      \"bvhBuilds\": %d,\n", a.builds);
+			fprintf(file, "      \"bvhRefits\": %d,\n", a.refits);
+			fprintf(file, "      \"bvhPartialRebuilds\": %d,\n", a.partialRebuilds);
+			fprintf(file, "      \"bvhBuildTime\": %.6f,\n", a.buildTime);
+			fprintf(file, "      \"bvhRefitTime\": %.6f,\n", a.refitTime);
+			fprintf(file, "      \"bvhCost\": %.3f,\n", a.cost);
+			fprintf(file, "      \"bvhBuildCost\": %.3f,\n", a.buildCost);
+		}
+		fprintf(file,
+			"      \"occluderCacheHitRate\": %.4f%s\n",
+			r.cache.getHitRate(),
+			wavefrontTracing ? "," : "");
+		if (wavefrontTracing)
+		{
+			// stage times of one render, summed over the threads
+			fprintf(file, "      \"waves\": %ld,\n", r.wavefront.waves);
+			fprintf(file, "      \"stageTimes\": {");
+			for (int s = 0; s < Wavefront::NumberOfStages; s++)
+				fprintf(file,
+					"%s\"%s\": %.6f",
+					s > 0 ? ", " : "",
+					Wavefront::Statistics::getName((Wavefront::Stage)s),
+					r.wavefront.times[s]);
+			fprintf(file, "}\n");
+		}
+		fprintf(file, "    }");
+		first = false;
+	}
+	fprintf(file, "\n  ]\n}\n");
+}
+
+int
+main(int argc, char** argv)
+{
+	if (!parseOptions(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+
+	// one result per benchmark and accelerator
+	Result results[numberOfBenchmarks * Accelerator::NumberOfTypes];
+
+	for (int i = 0; i < numberOfBenchmarks * Accelerator::NumberOfTypes; i++)
+	{
+		const Benchmark& b = benchmarks[i / Accelerator::NumberOfTypes];
+		Accelerator::Type type = (Accelerator::Type)(i % Accelerator::NumberOfTypes);
+
+		if ((benchmarkName != 0 && strcmp(benchmarkName, b.name)) ||
+			!isSelected(type))
+			continue;
+		fprintf(stderr, "Running %s (%s)...\n", b.name, Accelerator::getName(type));
+		run(b, type, results[i]);
+
+		const Result& r = results[i];
+
+		fprintf(stderr,
+			"  %.3f s, %ld primary, %ld secondary, %ld shadow rays, %.2f Mrays/s\n",
+			r.bestTime,
+			r.rays.primary,
+			r.rays.secondary,
+			r.rays.shadow,
+			r.rays.getTotal() / r.bestTime * 1e-6);
+		fprintf(stderr,
+			"  %s built in %.2f ms, %.1f KB\n",
+			Accelerator::getName(type),
+			r.accelerator.buildTime * 1e3,
+			r.accelerator.memorySize / 1024.0);
+	}
+
+	FILE* file = fileName != 0 ? fopen(fileName, "w") : stdout;
+
+	if (file == 0)
+	{
+		fprintf(stderr, "Unable to write %s\n", fileName);
+		return 1;
+	}
+	writeReport(file, results);
+	if (file != stdout)
+	{
+		fclose(file);
+		fprintf(stderr, "Report written to %s\n", fileName);
+	}
+	return 0;
+}
@@ -139,6 +139,32 @@ public:
 
 	void transform(const Transf3&);
 
+	bool intersect(const Vec3& origin,
+		const Vec3& invDirection,
+		REAL& tMin,
+		REAL& tMax) const
+	{
+		REAL t1 = (p1.x - origin.x) * invDirection.x;
+		REAL t2 = (p2.x - origin.x) * invDirection.x;
+
+		tMin = Math::min<REAL>(t1, t2);
+		tMax = Math::max<REAL>(t1, t2);
+		t1 = (p1.y - origin.y) * invDirection.y;
+		t2 = (p2.y - origin.y) * invDirection.y;
+		tMin = Math::max<REAL>(tMin, Math::min<REAL>(t1, t2));
+		tMax = Math::min<REAL>(tMax, Math::max<REAL>(t1, t2));
+		t1 = (p1.z - origin.z) * invDirection.z;
+		t2 = (p2.z - origin.z) * invDirection.z;
+		tMin = Math::max<REAL>(tMin, Math::min<REAL>(t1, t2));
+		tMax = Math::min<REAL>(tMax, Math::max<REAL>(t1, t2));
+		return tMin <= tMax && tMax >= 0;
+	}
+
+	bool intersect(const Ray& ray, REAL& tMin, REAL& tMax) const
+	{
+		return intersect(ray.origin, ray.direction.inverse(), tMin, tMax);
+	}
+
 protected:
 	Vec3 p1;
 	Vec3 p2;
@@ -0,0 +1,282 @@
+#ifndef __DirtyRegion_h
+#define __DirtyRegion_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: DirtyRegion.h
+//  ========
+//  Class definition for dirty region of a frame.
+
+#include <string.h>
+
+#ifndef __Model_h
+#include "Model.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// DirtyRegion: dirty region of a frame class
+// ===========
+//
+// Keeps, for each pixel of the last complete frame, a summary of
+// the ray tree of the pixel: the point hit by its primary ray, and a
+// mask of the models hit by its reflected rays or blocking its shadow
+// rays, hashed to 32 bits. When the scene changes and the view does
+// not, only the pixels marked dirty by the changes need to be traced
+// again; the trees of the other ones are still valid. Distinct pixels
+// may be recorded by distinct threads with no locking. The models are
+// not referenced.
+class DirtyRegion
+{
+public:
+	enum
+	{
+		Hit = 1, // the primary ray hits a model
+		Reflected = 2, // the tree has reflected rays
+		Unknown = 4 // the pixel was not traced
+	};
+
+	struct Tree
+	{
+		Vec3 point; // primary hit point
+		uint touched; // hashes of the models touched by the tree
+		int flags;
+
+		// Constructor
+		Tree():
+			touched(0),
+			flags(0)
+		{
+			// do nothing
+		}
+
+		void touch(const Model* model)
+		{
+			touched |= hash(model);
+		}
+
+	}; // Tree
+
+	struct Statistics
+	{
+		long pixels; // number of pixels of the last frame
+		long dirty; // number of pixels traced
+
+		// Constructor
+		Statistics():
+			pixels(0),
+			dirty(0)
+		{
+			// do nothing
+		}
+
+		REAL getDirtyRate() const
+		{
+			return pixels > 0 ? (REAL)dirty / pixels : 0;
+		}
+
+	}; // Statistics
+
+	// Constructor
+	DirtyRegion():
+		W(0),
+		H(0),
+		trees(0),
+		dirty(0),
+		valid(false),
+		version(0),
+		cameraTimestamp(0)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	~DirtyRegion()
+	{
+		delete []trees;
+		delete []dirty;
+	}
+
+	// Hash a model to a bit of a mask
+	static uint hash(const Model* model)
+	{
+		uint k = (uint)((size_t)model >> 4) * 2654435761u;
+
+		return 1u << (k >> 27);
+	}
+
+	void begin(int, int, bool);
+
+	// End a complete frame of a scene version seen by a camera
+	void end(uint version, uint cameraTimestamp)
+	{
+		this->version = version;
+		this->cameraTimestamp = cameraTimestamp;
+		valid = true;
+	}
+
+	void invalidate()
+	{
+		valid = false;
+	}
+
+	// Can the last frame be reused as a w x h frame seen by a camera
+	// with a given timestamp?
+	bool isValid(int w, int h, uint cameraTimestamp) const
+	{
+		return valid && w == W && h == H &&
+			cameraTimestamp == this->cameraTimestamp;
+	}
+
+	// Get the scene version of the last frame
+	uint getVersion() const
+	{
+		return version;
+	}
+
+	const Tree& getTree(int i, int j) const
+	{
+		return trees[j * W + i];
+	}
+
+	void set(int i, int j, const Tree& tree)
+	{
+		trees[j * W + i] = tree;
+	}
+
+	bool isDirty(int i, int j) const
+	{
+		return dirty[j * W + i] != 0;
+	}
+
+	void setDirty(int i, int j)
+	{
+		uint8& d = dirty[j * W + i];
+
+		statistics.dirty += 1 - d;
+		d = 1;
+	}
+
+	void setDirty(int, int, int, int);
+	void dilate();
+
+	const Statistics& getStatistics() const
+	{
+		return statistics;
+	}
+
+private:
+	int W;
+	int H;
+	Tree* trees;
+	uint8* dirty;
+	bool valid;
+	uint version;
+	uint cameraTimestamp;
+	Statistics statistics;
+
+	DirtyRegion(const DirtyRegion&);
+	DirtyRegion& operator =(const DirtyRegion&);
+
+}; // DirtyRegion
+
+
+//////////////////////////////////////////////////////////
+//
+// DirtyRegion inline implementation
+// ===========
+inline void
+DirtyRegion::begin(int w, int h, bool reuse)
+//[]---------------------------------------------------[]
+//|  Begin a frame                                      |
+//|  @param frame width                                 |
+//|  @param frame height                                |
+//|  @param is the last frame reused?                   |
+//|                                                     |
+//|  If the last frame is reused, no pixel is dirty (to |
+//|  be marked by setDirty()); otherwise, all pixels    |
+//|  are dirty and their trees unknown until traced.    |
+//[]---------------------------------------------------[]
+{
+	if (w != W || h != H)
+	{
+		delete []trees;
+		delete []dirty;
+		trees = new Tree[w * h];
+		dirty = new uint8[w * h];
+		W = w;
+		H = h;
+		reuse = false;
+	}
+	valid = false;
+	statistics.pixels = w * h;
+	if (reuse)
+	{
+		memset(dirty, 0, w * h);
+		statistics.dirty = 0;
+		return;
+	}
+	memset(dirty, 1, w * h);
+	statistics.dirty = w * h;
+
+	Tree unknown;
+
+	unknown.flags = Unknown;
+	for (int k = 0, n = w * h; k < n; k++)
+		trees[k] = unknown;
+}
+
+inline void
+DirtyRegion::setDirty(int x1, int y1, int x2, int y2)
+//[]---------------------------------------------------[]
+//|  Mark a rectangle of pixels dirty                   |
+//|  @param first column                                |
+//|  @param first row                                   |
+//|  @param last column                                 |
+//|  @param last row                                    |
+//[]---------------------------------------------------[]
+{
+	for (int j = y1; j <= y2; j++)
+		for (int i = x1; i <= x2; i++)
+			setDirty(i, j);
+}
+
+inline void
+DirtyRegion::dilate()
+//[]---------------------------------------------------[]
+//|  Mark the 4-neighbors of the dirty pixels dirty     |
+//[]---------------------------------------------------[]
+{
+	// the neighbors are marked 2 first, so that they are not dilated
+	for (int j = 0; j < H; j++)
+		for (int i = 0, k = j * W; i < W; i++, k++)
+			if (dirty[k] == 0 &&
+				((i > 0 && dirty[k - 1] == 1) ||
+				(i < W - 1 && dirty[k + 1] == 1) ||
+				(j > 0 && dirty[k - W] == 1) ||
+				(j < H - 1 && dirty[k + W] == 1)))
+			{
+				dirty[k] = 2;
+				statistics.dirty++;
+			}
+	for (int k = 0, n = W * H; k < n; k++)
+		if (dirty[k] == 2)
+			dirty[k] = 1;
+}
+
+} // end namespace Graphics
+
+#endif // __DirtyRegion_h
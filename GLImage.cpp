@@ -26,12 +26,20 @@ using namespace Graphics;
 // GLImage implementation
 // =======
 GLImage::GLImage(int w, int h):
-	ImageBuffer(w, h)
+	ImageBuffer(w, h),
+	texture(0)
 //[]----------------------------------------------------[]
 //|  Constructor                                         |
 //[]----------------------------------------------------[]
 {
 	buffer = new Pixel[w * h];
+	// black, as Pixel() leaves the channels undefined
+	for (int i = 0; i < w * h; i++)
+		buffer[i].set(0, 0, 0);
+	tilesW = (w + GL_IMAGE_TILE_SIZE - 1) / GL_IMAGE_TILE_SIZE;
+	tilesH = (h + GL_IMAGE_TILE_SIZE - 1) / GL_IMAGE_TILE_SIZE;
+	dirty = new uint8[tilesW * tilesH];
+	memset(dirty, 1, tilesW * tilesH);
 }
 
 GLImage::~GLImage()
@@ -39,9 +47,26 @@ GLImage::~GLImage()
 //|  Destructor                                          |
 //[]----------------------------------------------------[]
 {
+	if (texture != 0)
+		glDeleteTextures(1, &texture);
+	delete []dirty;
 	delete []buffer;
 }
 
+void
+GLImage::setDirty(int x, int y, int w, int h)
+//[]----------------------------------------------------[]
+//|  Flag the tiles overlapping a rectangle as dirty     |
+//[]----------------------------------------------------[]
+{
+	int ie = (x + w - 1) / GL_IMAGE_TILE_SIZE;
+	int je = (y + h - 1) / GL_IMAGE_TILE_SIZE;
+
+	for (int j = y / GL_IMAGE_TILE_SIZE; j <= je; j++)
+		for (int i = x / GL_IMAGE_TILE_SIZE; i <= ie; i++)
+			dirty[j * tilesW + i] = 1;
+}
+
 void
 GLImage::write(int i, Pixel pixels[])
 //[]----------------------------------------------------[]
@@ -49,6 +74,68 @@ GLImage::write(int i, Pixel pixels[])
 //[]----------------------------------------------------[]
 {
 	memcpy(buffer + i * W, pixels, W * sizeof(Pixel));
+	setDirty(0, i, W, 1);
+}
+
+void
+GLImage::writeTile(int x, int y, int w, int h, const Pixel pixels[])
+//[]----------------------------------------------------[]
+//|  Write tile                                          |
+//[]----------------------------------------------------[]
+{
+	if (w <= 0 || h <= 0)
+		return;
+	copyTile(buffer, W, x, y, w, h, pixels);
+	setDirty(x, y, w, h);
+}
+
+void
+GLImage::upload() const
+//[]----------------------------------------------------[]
+//|  Upload the dirty tiles to the texture               |
+//[]----------------------------------------------------[]
+{
+	if (texture == 0)
+		texture = createTexture(W, H);
+	else
+		glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, W);
+	for (int j = 0; j < tilesH; j++)
+	{
+		int y = j * GL_IMAGE_TILE_SIZE;
+		int h = Math::min<int>(GL_IMAGE_TILE_SIZE, H - y);
+
+		// upload each run of dirty tiles of a row at once
+		for (int i = 0; i < tilesW;)
+		{
+			if (!dirty[j * tilesW + i])
+			{
+				i++;
+				continue;
+			}
+
+			int k = i;
+
+			while (k < tilesW && dirty[j * tilesW + k])
+				dirty[j * tilesW + k++] = 0;
+
+			int x = i * GL_IMAGE_TILE_SIZE;
+			int w = Math::min<int>(k * GL_IMAGE_TILE_SIZE, W) - x;
+
+			glTexSubImage2D(GL_TEXTURE_2D,
+				0,
+				x,
+				y,
+				w,
+				h,
+				GL_RGB,
+				GL_UNSIGNED_BYTE,
+				buffer + y * W + x);
+			i = k;
+		}
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 }
 
 void
@@ -57,15 +144,46 @@ GLImage::draw() const
 //|  Draw                                                |
 //[]----------------------------------------------------[]
 {
-	drawPixels(W, H, buffer);
+	GLint viewport[4];
+
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+	upload();
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_TEXTURE_2D);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	// draw the pixels 1:1 at the bottom left corner of the viewport
+	gluOrtho2D(0, viewport[2], 0, viewport[3]);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glBegin(GL_QUADS);
+	glTexCoord2f(0, 0);
+	glVertex2i(0, 0);
+	glTexCoord2f(1, 0);
+	glVertex2i(W, 0);
+	glTexCoord2f(1, 1);
+	glVertex2i(W, H);
+	glTexCoord2f(0, 1);
+	glVertex2i(0, H);
+	glEnd();
+	glPopMatrix();
+	glPopAttrib();
+	glFlush();
 }
 
 Pixel*
-GLImage::map(LockMode)
+GLImage::map(LockMode mode)
 //[]----------------------------------------------------[]
 //|  Map                                                 |
 //[]----------------------------------------------------[]
 {
+	// any pixel may be written through the buffer
+	if (mode == Write)
+		memset(dirty, 1, tilesW * tilesH);
 	return buffer;
 }
 
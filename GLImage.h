@@ -25,6 +25,8 @@
 #include "Image.h"
 #endif
 
+#define GL_IMAGE_TILE_SIZE 32 // pixels of a side of a dirty tile
+
 namespace Graphics
 { // begin namespace Graphics
 
@@ -33,6 +35,12 @@ namespace Graphics
 //
 // GLImage: GL image class
 // =======
+//
+// The pixels are drawn as a texture. The image is split into tiles of
+// GL_IMAGE_TILE_SIZE x GL_IMAGE_TILE_SIZE pixels, each one flagged as
+// dirty when any of its pixels is written; draw() uploads only the
+// dirty tiles. A flag is one byte, so that the writers of disjoint
+// tiles need no locking (writers of tiles sharing a flag both set it).
 class GLImage: public ImageBuffer
 {
 public:
@@ -44,6 +52,7 @@ public:
 
 	// Write pixels
 	void write(int, Pixel[]);
+	void writeTile(int, int, int, int, const Pixel[]);
 
 	// Draw
 	void draw() const;
@@ -54,6 +63,13 @@ protected:
 
 private:
 	Pixel* buffer;
+	int tilesW;
+	int tilesH;
+	mutable uint8* dirty;
+	mutable GLuint texture; // 0 until the first draw
+
+	void setDirty(int, int, int, int);
+	void upload() const;
 
 }; // GLImage
 
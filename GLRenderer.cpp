@@ -295,6 +295,33 @@ GLRenderer::endRender()
 	glFlush();
 }
 
+//
+// Auxiliary functions
+//
+inline void
+pushTransform(const Actor& actor)
+{
+	if (!actor.isTransformed())
+		return;
+
+	const Transf3& t = actor.getTransform();
+	GLfloat m[16];
+
+	// GL matrices are stored column by column
+	for (int j = 0; j < 4; j++)
+		for (int i = 0; i < 4; i++)
+			m[j * 4 + i] = (GLfloat)t(i, j);
+	glPushMatrix();
+	glMultMatrixf(m);
+}
+
+inline void
+popTransform(const Actor& actor)
+{
+	if (actor.isTransformed())
+		glPopMatrix();
+}
+
 void
 GLRenderer::renderWireframe()
 {
@@ -388,6 +415,7 @@ GLRenderer::renderWireframe()
 		Vec3* vertices = meshData.vertices;
 		TriangleMesh::Triangle* triangles = meshData.triangles;
 
+		pushTransform(*ait.current());
 		glBegin(GL_TRIANGLES);
 		for (int i = 0, n = meshData.numberOfTriangles; i < n; i++)
 			for (int d = 0; d < 3; d++)
@@ -396,6 +424,7 @@ GLRenderer::renderWireframe()
 				glVertex3f((float)p.x, (float)p.y, (float)p.z);
 			}
 		glEnd();
+		popTransform(*ait.current());
 	}
 }
 
@@ -415,6 +444,8 @@ GLRenderer::renderPoly()
 	 */
 	glShadeModel(renderMode == Flat ? GL_FLAT : GL_SMOOTH);
 	glEnable(GL_DEPTH_TEST);
+	// instances may be scaled
+	glEnable(GL_NORMALIZE);
 	renderLights();
 	for (ActorIterator ait(scene->getActorIterator()); ait; ++ait)
 	{
@@ -431,6 +462,7 @@ GLRenderer::renderPoly()
 		TriangleMesh::Triangle* triangles = meshData.triangles;
 		Vec3* normals = meshData.normals;
 
+		pushTransform(*ait.current());
 		for (int i = 0, n = meshData.numberOfTriangles; i < n; i++)
 		{
 			renderMaterial(*MaterialFactory::get(triangles[i].materialIndex));
@@ -450,7 +482,9 @@ GLRenderer::renderPoly()
 			}
 			glEnd();
 		}
+		popTransform(*ait.current());
 	}
+	glDisable(GL_NORMALIZE);
 	glDisable(GL_DEPTH_TEST);
 	for (int lid = GL_LIGHT0; lid <= GL_LIGHT7; ++lid)
 		glDisable(lid);
@@ -0,0 +1,231 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: HDRImage.cpp
+//  ========
+//  Source file for HDR accumulation image.
+
+#include <math.h>
+
+#ifndef __HDRImage_h
+#include "HDRImage.h"
+#endif
+
+using namespace Graphics;
+
+//
+// Ordered dithering thresholds (4x4 Bayer matrix)
+//
+static const REAL bayer[4][4] =
+{
+	{ 0.5f / 16,  8.5f / 16,  2.5f / 16, 10.5f / 16},
+	{12.5f / 16,  4.5f / 16, 14.5f / 16,  6.5f / 16},
+	{ 3.5f / 16, 11.5f / 16,  1.5f / 16,  9.5f / 16},
+	{15.5f / 16,  7.5f / 16, 13.5f / 16,  5.5f / 16}
+};
+
+//
+// Auxiliary function
+//
+inline REAL
+encode(const REAL* table, REAL e, REAL c)
+{
+	// c^e, interpolated in a table of GAMMA_TABLE_SIZE + 1 entries;
+	// the curve is too steep near 0 for the first step to be linear
+	REAL k = c * GAMMA_TABLE_SIZE;
+
+	if (k < 1)
+		return (REAL)pow(c, e);
+
+	int i = Math::min((int)k, GAMMA_TABLE_SIZE - 1);
+
+	return table[i] + (k - i) * (table[i + 1] - table[i]);
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// HDRImage implementation
+// ========
+HDRImage::HDRImage(int w, int h):
+	W(w),
+	H(h),
+	gammaTable(0)
+//[]---------------------------------------------------[]
+//|  Constructor                                        |
+//[]---------------------------------------------------[]
+{
+	pixels = new Real4[w * h];
+	clear();
+}
+
+HDRImage::~HDRImage()
+//[]---------------------------------------------------[]
+//|  Destructor                                         |
+//[]---------------------------------------------------[]
+{
+	delete []pixels;
+	delete []gammaTable;
+}
+
+void
+HDRImage::write(int j, Pixel pixels[])
+//[]---------------------------------------------------[]
+//|  Write                                              |
+//[]---------------------------------------------------[]
+{
+	Real4* p = this->pixels + j * W;
+	REAL s = Math::inverse((REAL)255);
+
+	for (int i = 0; i < W; i++)
+		p[i] = Real4(pixels[i].r * s, pixels[i].g * s, pixels[i].b * s, 1);
+}
+
+void
+HDRImage::writeTile(int x, int y, int w, int h, const Pixel pixels[])
+//[]---------------------------------------------------[]
+//|  Write tile                                         |
+//[]---------------------------------------------------[]
+{
+	REAL s = Math::inverse((REAL)255);
+
+	for (int j = 0; j < h; j++)
+	{
+		Real4* p = this->pixels + (y + j) * W + x;
+
+		for (int i = 0; i < w; i++, pixels++)
+			p[i] = Real4(pixels->r * s, pixels->g * s, pixels->b * s, 1);
+	}
+}
+
+void
+HDRImage::clear()
+//[]---------------------------------------------------[]
+//|  Clear                                              |
+//[]---------------------------------------------------[]
+{
+	for (int i = 0, n = W * H; i < n; i++)
+		pixels[i] = Real4(0);
+}
+
+Color
+HDRImage::getColor(int i, int j) const
+//[]---------------------------------------------------[]
+//|  Mean color of the samples of a pixel               |
+//[]---------------------------------------------------[]
+{
+	const Real4& p = pixels[j * W + i];
+
+	if (p[3] == 0)
+		return Color::black;
+
+	REAL s = Math::inverse(p[3]);
+
+	return Color(p[0] * s, p[1] * s, p[2] * s);
+}
+
+void
+HDRImage::setToneMap(const ToneMap& toneMap)
+//[]---------------------------------------------------[]
+//|  Set the tone mapping parameters                    |
+//[]---------------------------------------------------[]
+{
+	this->toneMap = toneMap;
+	delete []gammaTable;
+	gammaTable = 0;
+	if (toneMap.gamma == 1)
+		return;
+	// encoded values of GAMMA_TABLE_SIZE + 1 points in [0, 1]
+	gammaTable = new REAL[GAMMA_TABLE_SIZE + 1];
+
+	REAL e = Math::inverse(toneMap.gamma);
+
+	for (int i = 0; i <= GAMMA_TABLE_SIZE; i++)
+		gammaTable[i] = (REAL)pow((REAL)i / GAMMA_TABLE_SIZE, e);
+}
+
+void
+HDRImage::resolve(int x, int y, int w, Pixel out[]) const
+//[]---------------------------------------------------[]
+//|  Tone map a run of pixels of a row                  |
+//|  @param first column of the run                     |
+//|  @param row                                         |
+//|  @param number of pixels of the run                 |
+//|  @param resolved pixels (output)                    |
+//[]---------------------------------------------------[]
+{
+	const Real4* p = pixels + y * W + x;
+	const REAL* d = bayer[y & 3];
+	Real4 zero(0);
+	Real4 one(1);
+	Real4 full(255);
+	REAL e = Math::inverse(toneMap.gamma);
+	bool reinhard = toneMap.op == ToneMap::Reinhard;
+
+	for (int i = 0; i < w; i++)
+	{
+		REAL n = p[i][3];
+		Real4 c = n > 0 ?
+			p[i] * Real4(toneMap.exposure * Math::inverse(n)) :
+			zero;
+
+		if (reinhard)
+			c = c / (one + c);
+		c = min(max(c, zero), one);
+		if (gammaTable != 0)
+			c = Real4(encode(gammaTable, e, c[0]),
+				encode(gammaTable, e, c[1]),
+				encode(gammaTable, e, c[2]),
+				0);
+		c = c * full;
+		if (toneMap.dithering)
+			c = min(c + Real4(d[(x + i) & 3]), full);
+		out[i].set((uint8)(int)c[0], (uint8)(int)c[1], (uint8)(int)c[2]);
+	}
+}
+
+void
+HDRImage::resolve(Pixel out[]) const
+//[]---------------------------------------------------[]
+//|  Tone map the whole image into a W x H frame        |
+//[]---------------------------------------------------[]
+{
+	for (int j = 0; j < H; j++)
+		resolve(0, j, W, out + j * W);
+}
+
+void
+HDRImage::resolve(Image& image) const
+//[]---------------------------------------------------[]
+//|  Tone map the whole image into another image        |
+//[]---------------------------------------------------[]
+{
+	resolve(image, 0, H);
+}
+
+void
+HDRImage::resolve(Image& image, int y, int h) const
+//[]---------------------------------------------------[]
+//|  Tone map a band of rows into another image         |
+//|  @param the image (of the same size)                |
+//|  @param first row of the band                       |
+//|  @param number of rows of the band                  |
+//[]---------------------------------------------------[]
+{
+	Pixel* row = new Pixel[W];
+
+	for (int j = y; j < y + h; j++)
+	{
+		resolve(0, j, W, row);
+		image.write(j, row);
+	}
+	delete []row;
+}
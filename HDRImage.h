@@ -0,0 +1,154 @@
+#ifndef __HDRImage_h
+#define __HDRImage_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: HDRImage.h
+//  ========
+//  Class definition for HDR accumulation image.
+
+#ifndef __Image_h
+#include "Image.h"
+#endif
+#ifndef __Real4_h
+#include "Real4.h"
+#endif
+
+#define GAMMA_TABLE_SIZE 4096
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// ToneMap: HDR to pixel mapping parameters
+// =======
+//
+// A resolved color is the mean of the samples of its pixel scaled
+// by exposure, compressed by the operator (Clamp: none; Reinhard:
+// c / (1 + c)), clamped to [0, 1], raised to 1 / gamma and quantized,
+// optionally with ordered dithering. The defaults map a single sample
+// exactly as Pixel(const Color&) maps a color clamped to 1.
+struct ToneMap
+{
+	enum Operator
+	{
+		Clamp,
+		Reinhard
+	};
+
+	Operator op;
+	REAL exposure;
+	REAL gamma;
+	bool dithering;
+
+	// Constructor
+	ToneMap():
+		op(Clamp),
+		exposure(1),
+		gamma(1),
+		dithering(false)
+	{
+		// do nothing
+	}
+
+}; // ToneMap
+
+
+//////////////////////////////////////////////////////////
+//
+// HDRImage: HDR accumulation image class
+// ========
+//
+// Image of float colors with per-pixel sample counts. Samples are
+// added to (or set into) pixels without any clamping; resolve()
+// tone maps the mean color of each pixel to 8-bit pixels. Each pixel
+// is kept as a Real4 holding the sum of its samples (lanes 0-2) and
+// their number (lane 3), so that a sample is added by one SIMD add
+// and a pixel is resolved by a handful of SIMD operations. Distinct
+// pixels may be written by distinct threads with no locking.
+class HDRImage: public Image
+{
+public:
+	// Constructor
+	HDRImage(int, int);
+
+	// Destructor
+	~HDRImage();
+
+	void getSize(int& w, int& h) const
+	{
+		w = W;
+		h = H;
+	}
+
+	// Write pixels (as the single samples of a row or tile)
+	void write(int, Pixel[]);
+	void writeTile(int, int, int, int, const Pixel[]);
+
+	bool canWriteTiles() const
+	{
+		return true;
+	}
+
+	// Remove all samples
+	void clear();
+
+	// Replace the samples of a pixel by a color
+	void set(int i, int j, const Color& c)
+	{
+		pixels[j * W + i] = Real4(c.r, c.g, c.b, 1);
+	}
+
+	// Add a sample to a pixel
+	void add(int i, int j, const Color& c)
+	{
+		Real4& p = pixels[j * W + i];
+
+		p = p + Real4(c.r, c.g, c.b, 1);
+	}
+
+	int getNumberOfSamples(int i, int j) const
+	{
+		return (int)pixels[j * W + i][3];
+	}
+
+	Color getColor(int, int) const;
+
+	const ToneMap& getToneMap() const
+	{
+		return toneMap;
+	}
+
+	void setToneMap(const ToneMap&);
+
+	void resolve(int, int, int, Pixel[]) const;
+	void resolve(Pixel[]) const;
+	void resolve(Image&) const;
+	void resolve(Image&, int, int) const;
+
+private:
+	int W;
+	int H;
+	Real4* pixels;
+	ToneMap toneMap;
+	REAL* gammaTable; // null if gamma is 1
+
+	HDRImage(const HDRImage&);
+	HDRImage& operator =(const HDRImage&);
+
+}; // HDRImage
+
+} // end namespace Graphics
+
+#endif // __HDRImage_h
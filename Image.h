@@ -15,6 +15,8 @@
 //  ========
 //  Class definition for image.
 
+#include <string.h>
+
 #ifndef __Color_h
 #include "Color.h"
 #endif
@@ -96,6 +98,17 @@ struct Pixel
 #pragma pack(pop)
 #endif
 
+//
+// Auxiliary function
+//
+inline void
+copyTile(Pixel* buffer, int W, int x, int y, int w, int h, const Pixel* tile)
+{
+	// copy a w x h tile into a buffer W pixels wide, row by row
+	for (Pixel* p = buffer + y * W + x; h-- > 0; p += W, tile += w)
+		memcpy(p, tile, w * sizeof(Pixel));
+}
+
 namespace Graphics
 { // begin namespace Graphics
 
@@ -116,6 +129,21 @@ public:
 	virtual void getSize(int&, int&) const = 0;
 	virtual void write(int, Pixel[]) = 0;
 
+	// Can tiles be written by writeTile()?
+	virtual bool canWriteTiles() const
+	{
+		return false;
+	}
+
+	// Write a w x h tile of pixels (stored row by row) at (x, y).
+	// Disjoint tiles may be written by distinct threads at the same
+	// time with no locking; an image must not be written by rows and
+	// by tiles at the same time. Images writing rows only ignore it.
+	virtual void writeTile(int, int, int, int, const Pixel[])
+	{
+		// do nothing
+	}
+
 }; // Image
 
 
@@ -174,6 +202,12 @@ public:
 		buffer[i * W + j] = pixel;
 	}
 
+	// Image buffers write tiles
+	bool canWriteTiles() const
+	{
+		return true;
+	}
+
 	// Draw image
 	virtual void draw() const = 0;
 
@@ -12,8 +12,8 @@
 //  ========
 //  Source file for light.
 
-#ifndef __Light_h
-#include "Light.h"
+#ifndef __Scene_h
+#include "Scene.h"
 #endif
 
 using namespace Graphics;
@@ -65,6 +65,19 @@ Light::Light(const Vec3& p, const Color& c):
 	// do nothing
 }
 
+void
+Light::setOn(bool on)
+//[]----------------------------------------------------[]
+//|  Turn the light on or off                            |
+//[]----------------------------------------------------[]
+{
+	if (on == isOn)
+		return;
+	isOn = on;
+	if (scene != 0)
+		scene->setModified(this);
+}
+
 Color
 Light::getScaledColor(REAL t) const
 //[]----------------------------------------------------[]
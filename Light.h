@@ -55,6 +55,8 @@ public:
 	// Constructor
 	Light(const Vec3&, const Color& = Color::white);
 
+	void setOn(bool);
+
 	virtual Color getScaledColor(REAL) const;
 	virtual void getVector(const Vec3&, Vec3&, REAL&) const;
 
@@ -4,8 +4,8 @@
 #ifndef __GLRenderer_h
 #include "GLRenderer.h"
 #endif
-#ifndef __RayTracer_h
-#include "RayTracer.h"
+#ifndef __RenderThread_h
+#include "RenderThread.h"
 #endif
 #ifndef __Sphere_h
 #include "Sphere.h"
@@ -25,15 +25,21 @@ const float ZOOM_SCALE = 1.01f;
 int mx = 0;
 int my = 0;
 
+// Presentation globals
+const int REFRESH_TIME = 40; // milliseconds between uploads of rendered rows
+bool refreshPending;
+bool rendering;
+
 // Globals
 Scene* scene;
 GLRenderer* renderer;
-RayTracer* rayTracer;
+RenderThread* renderThread;
 Camera* camera;
 int w = 640;
 int h = 480;
 GLImage* frame;
 uint timestamp;
+uint version;
 bool traceRays;
 
 inline void
@@ -48,7 +54,10 @@ printControls()
 		"(+) zoom in     (-) zoom out\n\n"
 		"Projection type:\n"
 		"----------------\n"
-		"(p) perspective (o) ortographic\n\n");
+		"(p) perspective (o) ortographic\n\n"
+		"Scene controls:\n"
+		"---------------\n"
+		"(h) hide/show   (l) light on/off\n\n");
 }
 
 void
@@ -110,10 +119,43 @@ processKeys()
 			case 't':
 				traceRays ^= true;
 				break;
+
+			// Scene controls (the scene is changed while the render
+			// thread is paused)
+			case 'h':
+			{
+				Actor* actor = scene->getActorIterator().current();
+
+				renderThread->pause();
+				actor->setVisible(!actor->isVisible);
+				keys[i] = false;
+				break;
+			}
+
+			case 'l':
+			{
+				Light* light = scene->getLightIterator().current();
+
+				renderThread->pause();
+				light->setOn(!light->isOn);
+				keys[i] = false;
+				break;
+			}
 		}
 	}
 }
 
+/**
+ * Callback function responsible for presenting the rows rendered
+ * by the render thread.
+ */
+void
+refreshCallback(int /*value*/)
+{
+	refreshPending = false;
+	glutPostRedisplay();
+}
+
 /**
  * Callback function responsible for rendering the scene.
  */
@@ -132,14 +174,30 @@ renderCallback()
 
 		uint cameraTimestamp = camera->updateView();
 
-		if (timestamp != cameraTimestamp)
+		if (timestamp != cameraTimestamp || version != scene->getVersion())
 		{
-			frame->lock(ImageBuffer::Write);
-			rayTracer->renderImage(*frame);
-			frame->unlock();
+			// abort the frame in flight and render the new view
+			renderThread->postView(*camera,
+				frame->getWidth(),
+				frame->getHeight());
 			timestamp = cameraTimestamp;
+			version = scene->getVersion();
 		}
+
+		// rows rendered after this test are presented by the next refresh
+		bool wasRendering = rendering;
+
+		rendering = renderThread->isRendering();
+		// only the tiles of the rows presented are uploaded by draw()
+		renderThread->present(*frame);
 		frame->draw();
+		if (rendering && !refreshPending)
+		{
+			refreshPending = true;
+			glutTimerFunc(REFRESH_TIME, refreshCallback, 0);
+		}
+		else if (wasRendering && !rendering)
+			renderThread->getRayTracer().printStatistics();
 	}
 	// Swap buffers
 	glutSwapBuffers();
@@ -553,7 +611,13 @@ main(int argc, char** argv)
 	scene = createScene(L"scene1");
 	camera = createCamera();
 	renderer = new GLRenderer(*scene, camera);
-	rayTracer = new RayTracer(*scene, camera);
+	renderThread = new RenderThread(*scene);
+	renderThread->getRayTracer().setNumberOfThreads(0);
+	// camera moves reuse the samples of the previous frame
+	renderThread->getRayTracer().setReprojection(true);
+	// scene changes trace only the pixels they may have changed
+	renderThread->getRayTracer().setDirtyRegions(true);
+	renderThread->start();
 /**
  * Lets tell GLUT that we're ready to get in the application event
  * processing loop. GLUT provides a function that gets the application
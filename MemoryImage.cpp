@@ -0,0 +1,261 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: MemoryImage.cpp
+//  ========
+//  Source file for memory image.
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef __MemoryImage_h
+#include "MemoryImage.h"
+#endif
+
+using namespace Graphics;
+
+//
+// Auxiliary PNG writer
+//
+class PNGWriter
+{
+public:
+	// Constructor
+	PNGWriter(FILE* aFile):
+		file(aFile)
+	{
+		for (uint32 n = 0; n < 256; n++)
+		{
+			uint32 c = n;
+
+			for (int k = 0; k < 8; k++)
+				c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			crcTable[n] = c;
+		}
+	}
+
+	void beginChunk(const char* type, uint32 length)
+	{
+		writeInt(length);
+		crc = 0xffffffff;
+		write(type, 4);
+	}
+
+	void endChunk()
+	{
+		writeInt(crc ^ 0xffffffff);
+	}
+
+	void write(const void* data, uint32 length)
+	{
+		const uint8* p = (const uint8*)data;
+
+		for (uint32 i = 0; i < length; i++)
+			crc = crcTable[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+		fwrite(data, 1, length, file);
+	}
+
+	void writeInt(uint32 x)
+	{
+		uint8 b[4] = {(uint8)(x >> 24), (uint8)(x >> 16), (uint8)(x >> 8), (uint8)x};
+
+		write(b, 4);
+	}
+
+private:
+	FILE* file;
+	uint32 crc;
+	uint32 crcTable[256];
+
+}; // PNGWriter
+
+
+//////////////////////////////////////////////////////////
+//
+// MemoryImage implementation
+// ===========
+MemoryImage::MemoryImage(int w, int h):
+	ImageBuffer(w, h)
+//[]----------------------------------------------------[]
+//|  Constructor                                         |
+//[]----------------------------------------------------[]
+{
+	pixels = new Pixel[w * h];
+	// black, as Pixel() leaves the channels undefined
+	for (int i = 0; i < w * h; i++)
+		pixels[i].set(0, 0, 0);
+}
+
+MemoryImage::~MemoryImage()
+//[]----------------------------------------------------[]
+//|  Destructor                                          |
+//[]----------------------------------------------------[]
+{
+	delete []pixels;
+}
+
+void
+MemoryImage::write(int i, Pixel p[])
+//[]----------------------------------------------------[]
+//|  Write                                               |
+//[]----------------------------------------------------[]
+{
+	memcpy(pixels + i * W, p, W * sizeof(Pixel));
+}
+
+void
+MemoryImage::writeTile(int x, int y, int w, int h, const Pixel p[])
+//[]----------------------------------------------------[]
+//|  Write tile                                          |
+//[]----------------------------------------------------[]
+{
+	copyTile(pixels, W, x, y, w, h, p);
+}
+
+void
+MemoryImage::draw() const
+//[]----------------------------------------------------[]
+//|  Draw                                                |
+//[]----------------------------------------------------[]
+{
+	// do nothing
+}
+
+Pixel*
+MemoryImage::map(LockMode)
+//[]----------------------------------------------------[]
+//|  Map                                                 |
+//[]----------------------------------------------------[]
+{
+	return pixels;
+}
+
+void
+MemoryImage::unmap()
+//[]----------------------------------------------------[]
+//|  Unmap                                               |
+//[]----------------------------------------------------[]
+{
+	// do nothing
+}
+
+bool
+MemoryImage::writePPM(const char* fileName) const
+//[]----------------------------------------------------[]
+//|  Write binary PPM file                               |
+//|  @param file name                                    |
+//|  @return true if the file was written                |
+//[]----------------------------------------------------[]
+{
+	FILE* file = fopen(fileName, "wb");
+
+	if (file == 0)
+		return false;
+	fprintf(file, "P6\n%d %d\n255\n", W, H);
+	// top row first
+	for (int j = H - 1; j >= 0; j--)
+		fwrite(pixels + j * W, sizeof(Pixel), W, file);
+	return fclose(file) == 0;
+}
+
+bool
+MemoryImage::writePNG(const char* fileName) const
+//[]----------------------------------------------------[]
+//|  Write PNG file                                      |
+//|  @param file name                                    |
+//|  @return true if the file was written                |
+//[]----------------------------------------------------[]
+{
+	FILE* file = fopen(fileName, "wb");
+
+	if (file == 0)
+		return false;
+
+	static const uint8 signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+	static const uint8 header[5] = {8, 2, 0, 0, 0}; // 8-bit RGB
+	PNGWriter png(file);
+
+	fwrite(signature, 1, 8, file);
+	png.beginChunk("IHDR", 13);
+	png.writeInt(W);
+	png.writeInt(H);
+	png.write(header, 5);
+	png.endChunk();
+
+	// zlib stream of stored deflate blocks; each row of the raw data
+	// is a filter type byte (none) followed by the pixels
+	const uint32 blockSize = 65535;
+	uint32 rowSize = W * sizeof(Pixel) + 1;
+	uint32 size = rowSize * H;
+	uint32 numberOfBlocks = size > 0 ? (size + blockSize - 1) / blockSize : 1;
+	uint32 a = 1;
+	uint32 b = 0;
+
+	png.beginChunk("IDAT", 2 + numberOfBlocks * 5 + size + 4);
+
+	static const uint8 zlibHeader[2] = {0x78, 0x01};
+
+	png.write(zlibHeader, 2);
+
+	uint8* row = new uint8[rowSize];
+	uint32 left = 0; // bytes left in the current block
+	uint32 written = 0;
+
+	row[0] = 0;
+	for (int j = H - 1; j >= 0; j--)
+	{
+		memcpy(row + 1, pixels + j * W, rowSize - 1);
+		for (uint32 i = 0; i < rowSize; i++)
+		{
+			a = (a + row[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		for (uint32 i = 0; i < rowSize;)
+		{
+			if (left == 0)
+			{
+				uint32 n = size - written;
+
+				left = n < blockSize ? n : blockSize;
+
+				uint8 block[5] =
+				{
+					left == n, // final block?
+					(uint8)left,
+					(uint8)(left >> 8),
+					(uint8)~left,
+					(uint8)(~left >> 8)
+				};
+
+				png.write(block, 5);
+			}
+
+			uint32 n = rowSize - i < left ? rowSize - i : left;
+
+			png.write(row + i, n);
+			i += n;
+			left -= n;
+			written += n;
+		}
+	}
+	delete []row;
+	if (size == 0)
+	{
+		static const uint8 empty[5] = {1, 0, 0, 0xff, 0xff};
+
+		png.write(empty, 5);
+	}
+	png.writeInt(b << 16 | a);
+	png.endChunk();
+	png.beginChunk("IEND", 0);
+	png.endChunk();
+	return fclose(file) == 0;
+}
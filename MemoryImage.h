@@ -0,0 +1,74 @@
+#ifndef __MemoryImage_h
+#define __MemoryImage_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: MemoryImage.h
+//  ========
+//  Class definition for memory image.
+
+#ifndef __Image_h
+#include "Image.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// MemoryImage: memory image class
+// ===========
+//
+// Image buffer kept in main memory only, for rendering without a
+// display. Rows are stored bottom-up, as written by the renderers.
+// The image can be saved as a binary PPM or as a PNG file (the
+// latter with uncompressed deflate blocks, so no zlib is needed).
+class MemoryImage: public ImageBuffer
+{
+public:
+	// Constructor
+	MemoryImage(int, int);
+
+	// Destructor
+	~MemoryImage();
+
+	// Write pixels
+	void write(int, Pixel[]);
+	void writeTile(int, int, int, int, const Pixel[]);
+
+	// Draw (no display: do nothing)
+	void draw() const;
+
+	const Pixel* getPixels() const
+	{
+		return pixels;
+	}
+
+	bool writePPM(const char*) const;
+	bool writePNG(const char*) const;
+
+protected:
+	Pixel* map(LockMode);
+	void unmap();
+
+private:
+	Pixel* pixels;
+
+	MemoryImage(const MemoryImage&);
+	MemoryImage& operator =(const MemoryImage&);
+
+}; // MemoryImage
+
+} // end namespace Graphics
+
+#endif // __MemoryImage_h
@@ -0,0 +1,354 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Library                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: MeshModel.cpp
+//  ========
+//  Source file for triangle mesh model.
+
+#ifndef __MeshModel_h
+#include "MeshModel.h"
+#endif
+
+using namespace Graphics;
+
+//
+// Auxiliary intersector
+//
+class TriangleIntersector
+{
+public:
+	// Constructor
+	TriangleIntersector(const TriangleMesh::Data& aData,
+		const Ray& aRay,
+		IntersectInfo& aHit):
+		data(aData),
+		ray(aRay),
+		hit(aHit)
+	{
+		// do nothing
+	}
+
+	bool operator ()(int i, REAL& distance)
+	{
+		Vec3 p;
+		REAL t;
+
+		COUNT_STATISTIC(TriangleTests, 1);
+		if (!data.intersect(i, ray, p, t) || t >= distance)
+			return false;
+		distance = t;
+		hit.triangleIndex = i;
+		hit.barycentric = p;
+		return true;
+	}
+
+private:
+	const TriangleMesh::Data& data;
+	const Ray& ray;
+	IntersectInfo& hit;
+
+}; // TriangleIntersector
+
+//
+// Auxiliary packet intersector
+//
+class TrianglePacketIntersector
+{
+public:
+	// Constructor
+	TrianglePacketIntersector(const TriangleMesh::Data& aData,
+		const RayPacket& aPacket,
+		PacketHit& aHit):
+		data(aData),
+		packet(aPacket),
+		hit(aHit)
+	{
+		// do nothing
+	}
+
+	int operator ()(int i, int mask, Real4& distance)
+	{
+		COUNT_STATISTIC(TriangleTests, countLanes(mask));
+		if (data.records == 0)
+			return intersectLanes(i, mask, distance);
+
+		// Moller-Trumbore test of the intersect record, four lanes at a time
+		const TriangleMesh::IntersectRecord& r = data.records[i];
+		const Real4* d = packet.direction;
+		Real4 e1[3] = {r.e1.x, r.e1.y, r.e1.z};
+		Real4 e2[3] = {r.e2.x, r.e2.y, r.e2.z};
+		Real4 q[3];
+
+		cross(d, e2, q);
+
+		Real4 det = e1[0] * q[0] + e1[1] * q[1] + e1[2] * q[2];
+		Real4 zero(0);
+		Real4 one(1);
+
+		if ((mask &= (det != zero).getMask()) == 0)
+			return 0;
+		det = one / det;
+
+		Real4 s[3] =
+		{
+			packet.origin[0] - Real4(r.v0.x),
+			packet.origin[1] - Real4(r.v0.y),
+			packet.origin[2] - Real4(r.v0.z)
+		};
+		Real4 u = (s[0] * q[0] + s[1] * q[1] + s[2] * q[2]) * det;
+
+		if ((mask &= ((u >= zero) & (u <= one)).getMask()) == 0)
+			return 0;
+
+		Real4 c[3];
+
+		cross(s, e1, c);
+
+		Real4 v = (d[0] * c[0] + d[1] * c[1] + d[2] * c[2]) * det;
+		Real4 t = (e2[0] * c[0] + e2[1] * c[1] + e2[2] * c[2]) * det;
+
+		mask &= ((v >= zero) &
+			(u + v <= one) &
+			(t > Real4(Math::zero<REAL>())) &
+			(t < distance)).getMask();
+		if (mask == 0)
+			return 0;
+		distance = select(Real4::fromMask(mask), t, distance);
+		for (int k = 0; k < RAY_PACKET_SIZE; k++)
+			if (mask & 1 << k)
+			{
+				IntersectInfo& info = hit.info[k];
+
+				info.triangleIndex = i;
+				info.barycentric.set(1 - (u[k] + v[k]), u[k], v[k]);
+			}
+		return mask;
+	}
+
+private:
+	const TriangleMesh::Data& data;
+	const RayPacket& packet;
+	PacketHit& hit;
+
+	static void cross(const Real4* a, const Real4* b, Real4* c)
+	{
+		c[0] = a[1] * b[2] - a[2] * b[1];
+		c[1] = a[2] * b[0] - a[0] * b[2];
+		c[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	int intersectLanes(int i, int mask, Real4& distance)
+	{
+		int updated = 0;
+
+		for (int k = 0; k < RAY_PACKET_SIZE; k++)
+		{
+			Vec3 p;
+			REAL t;
+
+			if ((mask & 1 << k) == 0 ||
+				!data.intersect(i, packet.rays[k], p, t) ||
+				t >= distance[k])
+				continue;
+			distance.set(k, t);
+			hit.info[k].triangleIndex = i;
+			hit.info[k].barycentric = p;
+			updated |= 1 << k;
+		}
+		return updated;
+	}
+
+}; // TrianglePacketIntersector
+
+
+//////////////////////////////////////////////////////////
+//
+// MeshModel implementation
+// =========
+MeshModel::MeshModel(TriangleMesh* mesh, const BVH::BuildOptions& options)
+//[]---------------------------------------------------[]
+//|  Constructor                                        |
+//|  @param the mesh (owned by the model)               |
+//|  @param how the BVH of the mesh is built            |
+//[]---------------------------------------------------[]
+{
+	this->mesh = mesh;
+	mesh->buildIntersectCache();
+	buildBVH(options);
+}
+
+MeshModel::~MeshModel()
+//[]---------------------------------------------------[]
+//|  Destructor                                         |
+//[]---------------------------------------------------[]
+{
+	delete mesh;
+}
+
+void
+MeshModel::buildBVH(const BVH::BuildOptions& options)
+//[]---------------------------------------------------[]
+//|  Build the BVH of the mesh triangles                |
+//[]---------------------------------------------------[]
+{
+	const TriangleMesh::Data& data = mesh->getData();
+	int n = data.numberOfTriangles;
+	BoundingBox* bounds = new BoundingBox[n];
+
+	for (int i = 0; i < n; i++)
+	{
+		const int* v = data.triangles[i].v;
+
+		bounds[i].inflate(data.vertices[v[0]]);
+		bounds[i].inflate(data.vertices[v[1]]);
+		bounds[i].inflate(data.vertices[v[2]]);
+	}
+
+	BVH tree;
+
+	tree.build(bounds, n, options);
+	delete []bounds;
+	bvh.build(tree);
+}
+
+bool
+MeshModel::intersect(const Ray& ray, IntersectInfo& hit) const
+//[]---------------------------------------------------[]
+//|  Intersect                                          |
+//[]---------------------------------------------------[]
+{
+	TriangleIntersector intersector(mesh->getData(), ray, hit);
+
+	hit.distance = Math::infinity<REAL>();
+	if (!bvh.intersect(ray, hit.distance, intersector))
+		return false;
+	hit.object = (Model*)this;
+	hit.p = makeRayPoint(ray, hit.distance);
+	return true;
+}
+
+int
+MeshModel::intersect(const RayPacket& packet, int mask, PacketHit& hit) const
+//[]---------------------------------------------------[]
+//|  Intersect packet                                   |
+//[]---------------------------------------------------[]
+{
+	TrianglePacketIntersector intersector(mesh->getData(), packet, hit);
+
+	if ((mask = bvh.intersect(packet, mask, hit.distance, intersector)) == 0)
+		return 0;
+	for (int i = 0; i < RAY_PACKET_SIZE; i++)
+		if (mask & 1 << i)
+		{
+			IntersectInfo& info = hit.info[i];
+
+			info.distance = hit.distance[i];
+			info.object = (Model*)this;
+			info.p = makeRayPoint(packet.rays[i], info.distance);
+		}
+	return mask;
+}
+
+bool
+MeshModel::occluded(const Ray& ray, REAL maxDist) const
+//[]---------------------------------------------------[]
+//|  Occlusion query                                    |
+//[]---------------------------------------------------[]
+{
+	IntersectInfo temp;
+	TriangleIntersector intersector(mesh->getData(), ray, temp);
+
+	return bvh.occluded(ray, maxDist, intersector);
+}
+
+int
+MeshModel::occluded(const RayPacket& packet,
+	int mask,
+	const Real4& maxDist) const
+//[]---------------------------------------------------[]
+//|  Packet occlusion query                             |
+//[]---------------------------------------------------[]
+{
+	PacketHit temp;
+	TrianglePacketIntersector intersector(mesh->getData(), packet, temp);
+
+	return bvh.occluded(packet, mask, maxDist, intersector);
+}
+
+Vec3
+MeshModel::normal(const IntersectInfo& hit) const
+//[]---------------------------------------------------[]
+//|  Normal                                             |
+//[]---------------------------------------------------[]
+{
+	const TriangleMesh::Data& data = mesh->getData();
+	const TriangleMesh::Triangle& t = data.triangles[hit.triangleIndex];
+
+	if (data.normals == 0)
+		return triangleNormal(data.vertices, t.v[0], t.v[1], t.v[2]);
+
+	Vec3* N = data.normals;
+
+	return Triangle::interpolate(hit.barycentric,
+		N[t.n[0]],
+		N[t.n[1]],
+		N[t.n[2]]).versor();
+}
+
+BoundingBox
+MeshModel::getBoundingBox() const
+//[]---------------------------------------------------[]
+//|  Get bounding box                                   |
+//[]---------------------------------------------------[]
+{
+	return bvh.getBounds();
+}
+
+TriangleMesh*
+MeshModel::getMesh()
+//[]---------------------------------------------------[]
+//|  Get mesh                                           |
+//[]---------------------------------------------------[]
+{
+	return mesh;
+}
+
+void
+MeshModel::transform(const Transf3& t)
+//[]---------------------------------------------------[]
+//|  Transform                                          |
+//[]---------------------------------------------------[]
+{
+	mesh->transform(t);
+	mesh->buildIntersectCache();
+	buildBVH(bvh.getBuildOptions());
+}
+
+void
+MeshModel::setMaterial(Material* material)
+//[]---------------------------------------------------[]
+//|  Set material                                       |
+//[]---------------------------------------------------[]
+{
+	Primitive::setMaterial(material);
+	if (material != 0)
+		mesh->setMaterial(*material);
+}
+
+void
+MeshModel::setBVHOptions(const BVH::BuildOptions& options)
+//[]---------------------------------------------------[]
+//|  Rebuild the BVH with other options                 |
+//[]---------------------------------------------------[]
+{
+	if (!(options == bvh.getBuildOptions()))
+		buildBVH(options);
+}
@@ -0,0 +1,79 @@
+#ifndef __MeshModel_h
+#define __MeshModel_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Library                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: MeshModel.h
+//  ========
+//  Class definition for triangle mesh model.
+
+#ifndef __Model_h
+#include "Model.h"
+#endif
+#ifndef __TriangleMesh_h
+#include "TriangleMesh.h"
+#endif
+#ifndef __WideBVH_h
+#include "WideBVH.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// MeshModel: triangle mesh model class
+// =========
+//
+// Ray traceable wrapper of a triangle mesh. Closest hits are found
+// by traversing a BVH built over the triangles of the mesh and then
+// collapsed into a compressed 4-wide one. Both the BVH and the
+// intersection cache of the mesh are rebuilt whenever the mesh is
+// transformed, the BVH with the options it was built with.
+class MeshModel: public Primitive
+{
+public:
+	// Constructor
+	MeshModel(TriangleMesh*, const BVH::BuildOptions& = BVH::BuildOptions());
+
+	// Destructor
+	~MeshModel();
+
+	bool intersect(const Ray&, IntersectInfo&) const;
+	int intersect(const RayPacket&, int, PacketHit&) const;
+	bool occluded(const Ray&, REAL) const;
+	int occluded(const RayPacket&, int, const Real4&) const;
+	Vec3 normal(const IntersectInfo&) const;
+	BoundingBox getBoundingBox() const;
+
+	TriangleMesh* getMesh();
+	void transform(const Transf3&);
+	void setMaterial(Material*);
+	void setBVHOptions(const BVH::BuildOptions&);
+
+	const WideBVH& getBVH() const
+	{
+		return bvh;
+	}
+
+protected:
+	TriangleMesh* mesh;
+	WideBVH bvh;
+
+	void buildBVH(const BVH::BuildOptions&);
+
+}; // MeshModel
+
+} // end namespace Graphics
+
+#endif // __MeshModel_h
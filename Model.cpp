@@ -52,6 +52,69 @@ Model::~Model()
 	// do nothing
 }
 
+int
+Model::intersect(const RayPacket& packet, int mask, PacketHit& hit) const
+//[]----------------------------------------------------[]
+//|  Intersect packet                                    |
+//|  @param the ray packet                               |
+//|  @param mask of the lanes to be tested               |
+//|  @param closest hits of the lanes (input/output)     |
+//|  @return mask of the lanes whose hits were updated   |
+//|                                                      |
+//|  The default implementation tests one lane at a time |
+//|  with the single ray intersect().                    |
+//[]----------------------------------------------------[]
+{
+	IntersectInfo temp;
+	int updated = 0;
+
+	for (int i = 0; i < RAY_PACKET_SIZE; i++)
+		if (mask & 1 << i &&
+			intersect(packet.rays[i], temp) &&
+			temp.distance < hit.distance[i])
+		{
+			hit.info[i] = temp;
+			hit.distance.set(i, temp.distance);
+			updated |= 1 << i;
+		}
+	return updated;
+}
+
+bool
+Model::occluded(const Ray& ray, REAL maxDist) const
+//[]----------------------------------------------------[]
+//|  Occlusion query                                     |
+//|  @param the ray                                      |
+//|  @param distance beyond which hits do not count      |
+//|  @return true if the ray hits the model closer than  |
+//|  maxDist                                             |
+//|                                                      |
+//|  Models made of many parts should override it in     |
+//|  order to stop at the first part hit.                |
+//[]----------------------------------------------------[]
+{
+	IntersectInfo temp;
+
+	return intersect(ray, temp) && temp.distance < maxDist;
+}
+
+int
+Model::occluded(const RayPacket& packet, int mask, const Real4& maxDist) const
+//[]----------------------------------------------------[]
+//|  Packet occlusion query                              |
+//|  @param the ray packet                               |
+//|  @param mask of the lanes to be tested               |
+//|  @param distances beyond which hits do not count     |
+//|  @return mask of the lanes which hit the model       |
+//|  closer than maxDist                                 |
+//[]----------------------------------------------------[]
+{
+	PacketHit temp;
+
+	temp.distance = maxDist;
+	return intersect(packet, mask, temp);
+}
+
 TriangleMesh*
 Model::getMesh()
 //[]----------------------------------------------------[]
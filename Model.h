@@ -21,6 +21,12 @@
 #ifndef __Material_h
 #include "Material.h"
 #endif
+#ifndef __RayPacket_h
+#include "RayPacket.h"
+#endif
+#ifndef __RenderStatistics_h
+#include "RenderStatistics.h"
+#endif
 
 namespace Graphics
 { // begin namespace Graphics
@@ -42,6 +48,9 @@ public:
 	virtual ~Model();
 
 	virtual bool intersect(const Ray&, IntersectInfo&) const = 0;
+	virtual int intersect(const RayPacket&, int, PacketHit&) const;
+	virtual bool occluded(const Ray&, REAL) const;
+	virtual int occluded(const RayPacket&, int, const Real4&) const;
 	virtual Vec3 normal(const IntersectInfo&) const = 0;
 	virtual Material* getMaterial() const = 0;
 	virtual BoundingBox getBoundingBox() const = 0;
@@ -0,0 +1,194 @@
+#ifndef __OccluderCache_h
+#define __OccluderCache_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: OccluderCache.h
+//  ========
+//  Class definition for shadow occluder cache.
+
+#ifndef __Actor_h
+#include "Actor.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// OccluderCache: shadow occluder cache class
+// =============
+//
+// Keeps, for each light of a scene, the last actor found blocking a
+// shadow ray toward the light. Shadow rays of nearby points are
+// usually blocked by the same actor, so it is tested before running
+// a full occlusion query, which may then skip it. A cache is meant to
+// be used by one thread during one render; the actors are not
+// referenced.
+class OccluderCache
+{
+public:
+	struct Statistics
+	{
+		long tests; // number of shadow rays tested against the cache
+		long hits; // number of shadow rays blocked by a cached actor
+
+		// Constructor
+		Statistics():
+			tests(0),
+			hits(0)
+		{
+			// do nothing
+		}
+
+		REAL getHitRate() const
+		{
+			return tests > 0 ? (REAL)hits / tests : 0;
+		}
+
+		Statistics& operator +=(const Statistics& s)
+		{
+			tests += s.tests;
+			hits += s.hits;
+			return *this;
+		}
+
+	}; // Statistics
+
+	// Constructor
+	OccluderCache():
+		occluders(0),
+		numberOfLights(0)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	~OccluderCache()
+	{
+		delete []occluders;
+	}
+
+	void reset(int);
+
+	int getNumberOfLights() const
+	{
+		return numberOfLights;
+	}
+
+	const Statistics& getStatistics() const
+	{
+		return statistics;
+	}
+
+	Actor* get(int light) const
+	{
+		return light < numberOfLights ? occluders[light] : 0;
+	}
+
+	void set(int light, Actor* actor)
+	{
+		if (light < numberOfLights)
+			occluders[light] = actor;
+	}
+
+	bool occluded(int, const Ray&, REAL);
+	int occluded(int, const RayPacket&, int, const Real4&);
+
+private:
+	Actor** occluders;
+	int numberOfLights;
+	Statistics statistics;
+
+	OccluderCache(const OccluderCache&);
+	OccluderCache& operator =(const OccluderCache&);
+
+}; // OccluderCache
+
+
+//////////////////////////////////////////////////////////
+//
+// OccluderCache inline implementation
+// =============
+inline void
+OccluderCache::reset(int numberOfLights)
+//[]---------------------------------------------------[]
+//|  Clear the cache and its statistics                 |
+//|  @param number of lights of the scene               |
+//[]---------------------------------------------------[]
+{
+	if (numberOfLights != this->numberOfLights)
+	{
+		delete []occluders;
+		occluders = numberOfLights > 0 ? new Actor*[numberOfLights] : 0;
+		this->numberOfLights = numberOfLights;
+	}
+	for (int i = 0; i < numberOfLights; i++)
+		occluders[i] = 0;
+	statistics = Statistics();
+}
+
+inline bool
+OccluderCache::occluded(int light, const Ray& ray, REAL maxDist)
+//[]---------------------------------------------------[]
+//|  Test a shadow ray against the cached occluder      |
+//|  @param index of the light                          |
+//|  @param the shadow ray                              |
+//|  @param distance to the light                       |
+//|  @return true if the cached actor blocks the ray    |
+//[]---------------------------------------------------[]
+{
+	if (light >= numberOfLights)
+		return false;
+	statistics.tests++;
+
+	Actor* actor = occluders[light];
+
+	if (actor == 0 || !actor->isVisible ||
+		!actor->occluded(ray, maxDist))
+		return false;
+	statistics.hits++;
+	return true;
+}
+
+inline int
+OccluderCache::occluded(int light,
+	const RayPacket& packet,
+	int mask,
+	const Real4& maxDist)
+//[]---------------------------------------------------[]
+//|  Test shadow rays against the cached occluder       |
+//|  @param index of the light                          |
+//|  @param the shadow rays                             |
+//|  @param mask of the lanes to be tested              |
+//|  @param distances to the light                      |
+//|  @return mask of the lanes blocked by the cached    |
+//|  actor                                              |
+//[]---------------------------------------------------[]
+{
+	if (light >= numberOfLights)
+		return 0;
+	statistics.tests += countLanes(mask);
+
+	Actor* actor = occluders[light];
+
+	if (actor == 0 || !actor->isVisible)
+		return 0;
+	mask = actor->occluded(packet, mask, maxDist);
+	statistics.hits += countLanes(mask);
+	return mask;
+}
+
+} // end namespace Graphics
+
+#endif // __OccluderCache_h
@@ -79,8 +79,9 @@ namespace Graphics
 { // begin namespace Graphics
 
 //
-// Forward definition
+// Forward definitions
 //
+class Actor;
 class Model;
 
 
@@ -96,6 +97,13 @@ struct IntersectInfo
 	REAL distance;
 	// The object intercepted by the ray
 	Model* object;
+	// The transformed actor intercepted by the ray, if any (p, triangle
+	// and barycentric coordinates are then in the space of the object)
+	const Actor* instance;
+	// The triangle intercepted by the ray (meshes only)
+	int triangleIndex;
+	// Barycentric coordinates of p in the triangle (meshes only)
+	Vec3 barycentric;
 	// Flags
 	int flags;
 	// Any user data
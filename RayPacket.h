@@ -0,0 +1,128 @@
+#ifndef __RayPacket_h
+#define __RayPacket_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Library                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: RayPacket.h
+//  ========
+//  Class definition for ray packet.
+
+#ifndef __Ray_h
+#include "Ray.h"
+#endif
+#ifndef __Real4_h
+#include "Real4.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+#define RAY_PACKET_SIZE 4
+#define RAY_PACKET_MASK 0xf
+
+//
+// Count the lanes set in a mask
+//
+inline int
+countLanes(int mask)
+{
+	return (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1) + (mask >> 3 & 1);
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// RayPacket: ray packet class
+// =========
+//
+// Four rays stored in structure of arrays layout, one ray per lane.
+// The bit i of active is set if the lane i holds a ray to be traced.
+// The rays are also kept as they are, in order to fall back to the
+// single ray code.
+struct RayPacket
+{
+	Real4 origin[3];
+	Real4 direction[3];
+	Real4 invDirection[3];
+	Ray rays[RAY_PACKET_SIZE];
+	int active;
+
+	// Constructor
+	RayPacket():
+		active(0)
+	{
+		// do nothing
+	}
+
+	void set(int i, const Ray& ray)
+	{
+		Vec3 invDirection = ray.direction.inverse();
+
+		for (int k = 0; k < 3; k++)
+		{
+			this->origin[k].set(i, ray.origin[k]);
+			this->direction[k].set(i, ray.direction[k]);
+			this->invDirection[k].set(i, invDirection[k]);
+		}
+		rays[i] = ray;
+		active |= 1 << i;
+	}
+
+	// Fill the inactive lanes with copies of an active one
+	void pad()
+	{
+		if (active == 0 || active == RAY_PACKET_MASK)
+			return;
+
+		int i = 0;
+
+		while ((active & 1 << i) == 0)
+			i++;
+
+		int mask = active;
+
+		for (int j = 0; j < RAY_PACKET_SIZE; j++)
+			if ((mask & 1 << j) == 0)
+				set(j, rays[i]);
+		active = mask;
+	}
+
+}; // RayPacket
+
+
+//////////////////////////////////////////////////////////
+//
+// PacketHit: intersection ray packet/object info class
+// =========
+struct PacketHit
+{
+	// The distances of the closest hits of the lanes
+	Real4 distance;
+	// The closest hits of the lanes (valid if info[i].object != 0)
+	IntersectInfo info[RAY_PACKET_SIZE];
+
+	// Make a mask of the lanes hit by some object
+	int getMask() const
+	{
+		int mask = 0;
+
+		for (int i = 0; i < RAY_PACKET_SIZE; i++)
+			if (info[i].object != 0)
+				mask |= 1 << i;
+		return mask;
+	}
+
+}; // PacketHit
+
+} // end namespace Graphics
+
+#endif // __RayPacket_h
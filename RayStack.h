@@ -0,0 +1,125 @@
+#ifndef __RayStack_h
+#define __RayStack_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: RayStack.h
+//  ========
+//  Class definition for ray evaluation stack.
+
+#ifndef __Color_h
+#include "Color.h"
+#endif
+#ifndef __Ray_h
+#include "Ray.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// RayStack: ray evaluation stack class
+// ========
+//
+// Explicit stack of the vertices of the path of a ray being traced
+// iteratively. A vertex holds the color of the direct lighting of a
+// hit and the secondary ray spawned by the hit, if any, along with
+// the weight of the color of the ray. Once the last vertex of the
+// path is shaded, the vertices are popped and their colors combined
+// back to the first one. The capacity of the stack, fixed by reset(),
+// bounds the length of the paths, hence the memory used by a thread.
+// A stack is meant to be used by one thread during one render.
+class RayStack
+{
+public:
+	struct Vertex
+	{
+		Color color; // direct lighting of the hit
+		Color specular; // weight of the color of the secondary ray
+		Ray ray; // secondary ray (traced if specular is not black)
+
+	}; // Vertex
+
+	// Constructor
+	RayStack():
+		vertices(0),
+		capacity(0),
+		size(0)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	~RayStack()
+	{
+		delete []vertices;
+	}
+
+	void reset(int);
+
+	int getCapacity() const
+	{
+		return capacity;
+	}
+
+	bool isEmpty() const
+	{
+		return size == 0;
+	}
+
+	// Push a vertex (its fields are left to the caller)
+	Vertex& push()
+	{
+		return vertices[size++];
+	}
+
+	const Vertex& pop()
+	{
+		return vertices[--size];
+	}
+
+private:
+	Vertex* vertices;
+	int capacity;
+	int size;
+
+	RayStack(const RayStack&);
+	RayStack& operator =(const RayStack&);
+
+}; // RayStack
+
+
+//////////////////////////////////////////////////////////
+//
+// RayStack inline implementation
+// ========
+inline void
+RayStack::reset(int capacity)
+//[]---------------------------------------------------[]
+//|  Empty the stack                                    |
+//|  @param maximum number of vertices of a path        |
+//[]---------------------------------------------------[]
+{
+	if (capacity != this->capacity)
+	{
+		delete []vertices;
+		vertices = capacity > 0 ? new Vertex[capacity] : 0;
+		this->capacity = capacity;
+	}
+	size = 0;
+}
+
+} // end namespace Graphics
+
+#endif // __RayStack_h
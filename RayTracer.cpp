@@ -13,153 +13,1552 @@
 //  Source code for simple ray tracer.
 
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef __RayTracer_h
 #include "RayTracer.h"
 #endif
+#ifndef __Timer_h
+#include "Timer.h"
+#endif
+
+using namespace Graphics;
+
+#define EPS 1e-4f // TODO
+
+
+//////////////////////////////////////////////////////////
+//
+// RayTracer implementation
+// =========
+RayTracer::RayTracer(Scene& scene, Camera* camera):
+//[]---------------------------------------------------[]
+//|  Constructor                                        |
+//[]---------------------------------------------------[]
+	Renderer(scene, camera),
+	progressiveImage(0),
+	progressiveFrame(0),
+	progressiveAliased(0),
+	aborts(0),
+	acceleratorScene(0),
+	acceleratorTimestamp(0),
+	framesInUse(false)
+{
+	maxRecursionLevel = 10;
+	minWeight = 0.001f;
+	// one thread: sequential scan; zero threads: one per processor
+	numberOfThreads = 1;
+	tileSize = 16;
+	packetTracing = true;
+	wavefrontTracing = false;
+	occluderCaching = true;
+	// one sample per pixel: no antialiasing
+	maxSamples = 1;
+	contrastThreshold = 0.1f;
+	// refit the BVH of an animated scene until its cost grows by half
+	rebuildThreshold = 1.5f;
+	accelerator = Accelerator::create(Accelerator::Hierarchy);
+	reprojectionCache = 0;
+	dirtyRegion = 0;
+	progressiveContext.step = 1;
+	progressiveContext.frames = false;
+}
+
+RayTracer::~RayTracer()
+//[]---------------------------------------------------[]
+//|  Destructor                                         |
+//[]---------------------------------------------------[]
+{
+	delete progressiveFrame;
+	delete []progressiveAliased;
+	delete reprojectionCache;
+	delete dirtyRegion;
+	delete accelerator;
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// RayTracer::ScanWorker: parallel scan worker class
+// =====================
+class RayTracer::ScanWorker: public Thread
+{
+public:
+	// Constructor
+	ScanWorker():
+		rayTracer(0),
+		scheduler(0),
+		frame(0),
+		index(0),
+		pixels(0)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	~ScanWorker()
+	{
+		delete []pixels;
+	}
+
+	void set(RayTracer* rayTracer,
+		const Context& context,
+		TileScheduler* scheduler,
+		HDRImage* frame,
+		int index)
+	{
+		this->rayTracer = rayTracer;
+		this->context = context;
+		// the counts of the worker are merged into the ones of context
+		this->context.rayCounts = RayCounts();
+		this->context.statistics.reset();
+		if (context.occluderCache != 0)
+		{
+			occluderCache.reset(context.occluderCache->getNumberOfLights());
+			this->context.occluderCache = &occluderCache;
+		}
+		rayStack.reset(context.rayStack->getCapacity());
+		this->context.rayStack = &rayStack;
+		if (rayTracer->wavefrontTracing)
+		{
+			wavefront.reset(context.tileSize * context.tileSize,
+				rayStack.getCapacity());
+			this->context.wavefront = &wavefront;
+		}
+		this->scheduler = scheduler;
+		this->frame = frame;
+		this->index = index;
+		if (context.output != 0 && pixels == 0)
+			pixels = new Pixel[context.tileSize * context.tileSize];
+	}
+
+	void run()
+	{
+		RenderStatistics* previous = RenderStatistics::getCurrent();
+		Tile tile;
+
+		RenderStatistics::setCurrent(&context.statistics);
+		while (!rayTracer->isAborted(context) &&
+			scheduler->nextTile(index, tile))
+		{
+			rayTracer->scanTile(context, tile, *frame);
+			if (context.output != 0)
+				writeTile(tile);
+		}
+		RenderStatistics::setCurrent(previous);
+	}
+
+	const Context& getContext() const
+	{
+		return context;
+	}
+
+	const OccluderCache& getOccluderCache() const
+	{
+		return occluderCache;
+	}
+
+	const Wavefront& getWavefront() const
+	{
+		return wavefront;
+	}
+
+private:
+	RayTracer* rayTracer;
+	Context context;
+	OccluderCache occluderCache;
+	RayStack rayStack;
+	Wavefront wavefront;
+	TileScheduler* scheduler;
+	HDRImage* frame;
+	int index;
+	Pixel* pixels; // resolved tile
+
+	void writeTile(const Tile& tile)
+	{
+		for (int j = 0; j < tile.h; j++)
+			frame->resolve(tile.x, tile.y + j, tile.w, pixels + j * tile.w);
+		context.output->writeTile(tile.x, tile.y, tile.w, tile.h, pixels);
+	}
+
+}; // RayTracer::ScanWorker
+
+void
+RayTracer::render()
+//[]---------------------------------------------------[]
+//|  Render                                             |
+//[]---------------------------------------------------[]
+{
+	printf("Invoke renderImage(image) to run the ray tracer\n");
+}
+
+void
+RayTracer::initContext(Context& context, Image& image, const Camera& camera)
+//[]---------------------------------------------------[]
+//|  Init the context of a full resolution scan         |
+//|  @param the context                                 |
+//|  @param output image                                |
+//|  @param camera of the image                         |
+//|                                                     |
+//|  The caches of the last frame are taken by the      |
+//|  context if no other render is using them.          |
+//[]---------------------------------------------------[]
+{
+	context.aborts = aborts;
+	updateAccelerator();
+	context.camera = &camera;
+	image.getSize(context.W, context.H);
+	// init auxiliary VRC
+	context.VRC_n = camera.getViewPlaneNormal();
+	context.VRC_v = camera.getViewUp();
+	context.VRC_u = context.VRC_v.cross(context.VRC_n);
+	// init auxiliary mapping variables
+	context.II_w = Math::inverse((REAL)context.W);
+	context.II_h = Math::inverse((REAL)context.H);
+
+	REAL height = camera.windowHeight();
+
+	if (context.W >= context.H)
+		context.VW_w = (context.VW_h = height) * context.W * context.II_h;
+	else
+		context.VW_h = (context.VW_w = height) * context.H * context.II_w;
+	// init scan pass
+	context.tileSize = tileSize;
+	context.step = 1;
+	context.refining = false;
+	context.aliased = 0;
+	context.output = 0;
+	{
+		ScopedLock guard(lock);
+
+		context.frames = !framesInUse;
+		framesInUse = true;
+	}
+	context.reprojectionCache = context.frames ? reprojectionCache : 0;
+	context.dirtyRegion = 0;
+	// init pixel ray
+	context.pixelRay.origin = camera.getPosition();
+	context.pixelRay.direction = -context.VRC_n;
+	context.rayCounts = RayCounts();
+	context.statistics.reset();
+	context.occluderCacheStatistics = OccluderCache::Statistics();
+	context.wavefront = 0;
+	context.wavefrontStatistics = Wavefront::Statistics();
+}
+
+void
+RayTracer::publishStatistics(const Context& context)
+//[]---------------------------------------------------[]
+//|  Make the statistics of a context the ones of the   |
+//|  last rendered image                                |
+//[]---------------------------------------------------[]
+{
+	ScopedLock guard(lock);
+
+	rayCounts = context.rayCounts;
+	statistics = context.statistics;
+	occluderCacheStatistics = context.occluderCacheStatistics;
+	wavefrontStatistics = context.wavefrontStatistics;
+}
+
+void
+RayTracer::releaseFrames(Context& context)
+//[]---------------------------------------------------[]
+//|  Release the caches of the last frame taken by a    |
+//|  context                                            |
+//[]---------------------------------------------------[]
+{
+	ScopedLock guard(lock);
+
+	if (context.frames)
+	{
+		framesInUse = false;
+		context.frames = false;
+	}
+}
+
+void
+RayTracer::renderImage(Image& image)
+//[]---------------------------------------------------[]
+//|  Run the ray tracer                                 |
+//[]---------------------------------------------------[]
+{
+	camera->updateView();
+	renderImage(image, *camera);
+}
+
+void
+RayTracer::renderImage(Image& image, const Camera& camera)
+//[]---------------------------------------------------[]
+//|  Run the ray tracer                                 |
+//|  @param output image                                |
+//|  @param camera of the image (with an updated view)  |
+//|                                                     |
+//|  May be called by several threads at a time.        |
+//[]---------------------------------------------------[]
+{
+	Context context;
+	OccluderCache occluderCache;
+	RayStack rayStack;
+
+	initContext(context, image, camera);
+	// init shadow occluder cache and ray evaluation stack
+	if (occluderCaching)
+		occluderCache.reset(scene->getNumberOfLights());
+	context.occluderCache = occluderCaching ? &occluderCache : 0;
+	rayStack.reset(Math::max(maxRecursionLevel + 1, 0));
+	context.rayStack = &rayStack;
+	RenderStatistics::setCurrent(&context.statistics);
+	scan(context, image);
+	RenderStatistics::setCurrent(0);
+	context.occluderCache = 0;
+	context.rayStack = 0;
+	context.occluderCacheStatistics += occluderCache.getStatistics();
+	publishStatistics(context);
+	releaseFrames(context);
+}
+
+void
+RayTracer::startImage(Image& image)
+//[]---------------------------------------------------[]
+//|  Start a progressive rendering                      |
+//|  @param output image                                |
+//[]---------------------------------------------------[]
+{
+	Context& context = progressiveContext;
+	int w = 0;
+	int h = 0;
+
+	// the caches of an unfinished image are released first
+	releaseFrames(context);
+	camera->updateView();
+	initContext(context, image, *camera);
+	if (progressiveFrame != 0)
+		progressiveFrame->getSize(w, h);
+	if (progressiveFrame == 0 || w != context.W || h != context.H)
+	{
+		delete progressiveFrame;
+		delete []progressiveAliased;
+		progressiveFrame = new HDRImage(context.W, context.H);
+		progressiveAliased = 0;
+	}
+	progressiveFrame->setToneMap(toneMap);
+	// the tiles of all passes are aligned to the blocks of the first one
+	context.tileSize =
+		(tileSize + 2 * PROGRESSIVE_STEP - 1) & -(2 * PROGRESSIVE_STEP);
+	context.step = PROGRESSIVE_STEP;
+	context.dirtyRegion = context.frames ? dirtyRegion : 0;
+	// only the dirty pixels of the last frame or the pixels not
+	// reprojected are traced, at full resolution
+	if (context.dirtyRegion != 0 && markDirty(context))
+		context.step = 1;
+	else if (context.reprojectionCache != 0 &&
+		reproject(context, *progressiveFrame))
+		context.step = 1;
+	progressiveImage = &image;
+	progressiveRow = 0;
+
+	ScopedLock guard(lock);
+
+	occluderCacheStatistics = OccluderCache::Statistics();
+	wavefrontStatistics = Wavefront::Statistics();
+	rayCounts = RayCounts();
+	statistics.reset();
+}
+
+bool
+RayTracer::refineImage(double timeLimit)
+//[]---------------------------------------------------[]
+//|  Continue the progressive rendering                 |
+//|  @param time after which to stop, in seconds        |
+//|  @return true if the image is complete              |
+//|                                                     |
+//|  The image is refined band by band of rows; at      |
+//|  least one band is scanned per call. An aborted     |
+//|  image is stopped, leaving its last band unwritten. |
+//[]---------------------------------------------------[]
+{
+	if (progressiveImage == 0)
+		return false;
+
+	Context& context = progressiveContext;
+	OccluderCache occluderCache;
+	RayStack rayStack;
+	int n = numberOfThreads > 0 ?
+		numberOfThreads :
+		Thread::getNumberOfProcessors();
+	System::Timer timer;
+	bool complete = false;
+
+	if (occluderCaching)
+		occluderCache.reset(scene->getNumberOfLights());
+	context.occluderCache = occluderCaching ? &occluderCache : 0;
+	rayStack.reset(Math::max(maxRecursionLevel + 1, 0));
+	context.rayStack = &rayStack;
+	RenderStatistics::setCurrent(&context.statistics);
+	do
+	{
+		int h = Math::min<int>(context.tileSize, context.H - progressiveRow);
+
+		scanRows(context, *progressiveFrame, progressiveRow, h, n);
+		if (isAborted(context))
+		{
+			progressiveImage = 0;
+			break;
+		}
+		progressiveFrame->resolve(*progressiveImage, progressiveRow, h);
+		if ((progressiveRow += h) < context.H)
+			continue;
+		progressiveRow = 0;
+		if (context.step > 1)
+		{
+			context.step >>= 1;
+			context.refining = true;
+			continue;
+		}
+		if (context.aliased != 0 || maxSamples <= 1)
+		{
+			if (context.reprojectionCache != 0)
+				context.reprojectionCache->end(scene->getVersion());
+			if (context.dirtyRegion != 0)
+				context.dirtyRegion->end(scene->getVersion(),
+					context.camera->getTimestamp());
+			// an aliased frame is kept only for the antialiased frames
+			if (context.aliased == 0)
+			{
+				delete []progressiveAliased;
+				progressiveAliased = 0;
+			}
+			progressiveImage = 0;
+			complete = true;
+			break;
+		}
+		// antialias the one ray per pixel frame
+		if (progressiveAliased == 0)
+			progressiveAliased = new Pixel[context.W * context.H];
+		if (context.dirtyRegion == 0)
+			progressiveFrame->resolve(progressiveAliased);
+		else
+			// the clean pixels keep their colors of the last frame
+			for (int j = 0; j < context.H; j++)
+				for (int i = 0; i < context.W; i++)
+					if (context.dirtyRegion->isDirty(i, j))
+						progressiveFrame->resolve(i,
+							j,
+							1,
+							progressiveAliased + j * context.W + i);
+		context.aliased = progressiveAliased;
+	} while (timer.getElapsedTime() < timeLimit);
+	RenderStatistics::setCurrent(0);
+	context.occluderCache = 0;
+	context.rayStack = 0;
+	context.occluderCacheStatistics += occluderCache.getStatistics();
+	publishStatistics(context);
+	// the caches are kept until the image is complete or stopped
+	if (progressiveImage == 0)
+		releaseFrames(context);
+	return complete;
+}
+
+void
+RayTracer::stopImage()
+//[]---------------------------------------------------[]
+//|  Stop the progressive rendering                     |
+//[]---------------------------------------------------[]
+{
+	progressiveImage = 0;
+	releaseFrames(progressiveContext);
+}
+
+void
+RayTracer::printStatistics() const
+//[]---------------------------------------------------[]
+//|  Print the statistics of the last rendered image    |
+//[]---------------------------------------------------[]
+{
+	const OccluderCache::Statistics& s = occluderCacheStatistics;
+
+	printf("Rays: %ld primary, %ld secondary, %ld shadow\n",
+		rayCounts.primary,
+		rayCounts.secondary,
+		rayCounts.shadow);
+	printf("Shadow occluder cache: %ld hits of %ld tests (%.1f%%)\n",
+		s.hits,
+		s.tests,
+		s.getHitRate() * 100);
+	if (reprojectionCache != 0)
+	{
+		const ReprojectionCache::Statistics& r = reprojectionCache->getStatistics();
+
+		printf("Reprojection: %ld of %ld pixels reused (%.1f%%)\n",
+			r.reprojected,
+			r.pixels,
+			r.getReuseRate() * 100);
+	}
+	if (dirtyRegion != 0)
+	{
+		const DirtyRegion::Statistics& d = dirtyRegion->getStatistics();
+
+		printf("Dirty region: %ld of %ld pixels traced (%.1f%%)\n",
+			d.dirty,
+			d.pixels,
+			d.getDirtyRate() * 100);
+	}
+	{
+		const Accelerator::Statistics& a = accelerator->getStatistics();
+		static const char* updates[] = {"refitted", "partially rebuilt", "built"};
+
+		printf("Scene %s: %s in %.2f ms, %.1f KB, "
+			"SAH cost %.2f (%.2f when built)\n",
+			Accelerator::getName(accelerator->getType()),
+			updates[a.lastUpdate],
+			a.lastTime * 1000,
+			a.memorySize / 1024.0,
+			a.cost,
+			a.buildCost);
+	}
+	if (wavefrontTracing)
+	{
+		const Wavefront::Statistics& w = wavefrontStatistics;
+
+		printf("Wavefront: %ld waves, %.1f ms (",
+			w.waves,
+			w.getTime() * 1000);
+		for (int i = 0; i < Wavefront::NumberOfStages; i++)
+			printf("%s%s %.1f",
+				i > 0 ? ", " : "",
+				Wavefront::Statistics::getName((Wavefront::Stage)i),
+				w.times[i] * 1000);
+		printf(")\n");
+	}
+#ifdef __RENDER_STATISTICS
+	for (int i = 0; i < RenderStatistics::NumberOfCounters; i++)
+	{
+		RenderStatistics::Counter c = (RenderStatistics::Counter)i;
+
+		printf("%s: %ld\n", RenderStatistics::getName(c), statistics.get(c));
+	}
+	printf("Rays per recursion level:");
+	for (int i = 0; i < RENDER_STATISTICS_DEPTHS; i++)
+		if (statistics.getDepthCount(i) > 0)
+			printf(" %d%s: %ld",
+				i,
+				i == RENDER_STATISTICS_DEPTHS - 1 ? "+" : "",
+				statistics.getDepthCount(i));
+	printf("\n");
+#endif
+}
+
+void
+RayTracer::updateAccelerator()
+//[]---------------------------------------------------[]
+//|  Update the accelerator if the scene has changed    |
+//[]---------------------------------------------------[]
+{
+	ScopedLock guard(lock);
+
+	if (acceleratorScene != scene)
+		accelerator->build(*scene);
+	else if (acceleratorTimestamp != scene->getTimestamp())
+		accelerator->update(*scene, rebuildThreshold);
+	else
+		return;
+	acceleratorScene = scene;
+	acceleratorTimestamp = scene->getTimestamp();
+}
+
+void
+RayTracer::scan(Context& context, Image& image)
+//[]---------------------------------------------------[]
+//|  Basic scan with optional jitter                    |
+//[]---------------------------------------------------[]
+{
+	int n = numberOfThreads > 0 ?
+		numberOfThreads :
+		Thread::getNumberOfProcessors();
+
+	// packets, waves, antialiasing passes and reprojected frames are
+	// scanned tile by tile, even by a single worker
+	if (n > 1 ||
+		packetTracing ||
+		wavefrontTracing ||
+		maxSamples > 1 ||
+		context.reprojectionCache != 0)
+	{
+		parallelScan(context, image, n);
+		return;
+	}
+
+	HDRImage row(context.W, 1);
+	Pixel* pixels = new Pixel[context.W];
+
+	row.setToneMap(toneMap);
+	for (int j = 0; j < context.H; j++)
+	{
+		REAL y = j + 0.5f;
+
+		printf("Scanning line %d of %d\r", j + 1, context.H);
+		for (int i = 0; i < context.W; i++)
+			row.set(i, 0, shoot(context, i + 0.5f, y));
+		row.resolve(0, 0, context.W, pixels);
+		image.write(j, pixels);
+	}
+	delete []pixels;
+}
+
+void
+RayTracer::parallelScan(Context& context, Image& image, int n)
+//[]---------------------------------------------------[]
+//|  Tiled scan shared by a pool of n workers           |
+//|  @param render context                              |
+//|  @param output image                                |
+//|  @param number of workers                           |
+//[]---------------------------------------------------[]
+{
+	HDRImage frame(context.W, context.H);
+	Image* output = image.canWriteTiles() ? &image : 0;
+	bool antialiasing = maxSamples > 1;
+
+	frame.setToneMap(toneMap);
+	if (context.reprojectionCache != 0)
+		reproject(context, frame);
+	context.output = antialiasing ? 0 : output;
+	scanRows(context, frame, 0, context.H, n);
+	if (antialiasing && !isAborted(context))
+	{
+		// antialias the one ray per pixel frame
+		Pixel* aliased = new Pixel[context.W * context.H];
+
+		frame.resolve(aliased);
+		context.aliased = aliased;
+		context.output = output;
+		scanRows(context, frame, 0, context.H, n);
+		context.aliased = 0;
+		delete []aliased;
+	}
+	context.output = 0;
+	if (context.reprojectionCache != 0 && !isAborted(context))
+		context.reprojectionCache->end(scene->getVersion());
+	if (output == 0)
+		frame.resolve(image);
+}
+
+void
+RayTracer::scanRows(Context& context, HDRImage& frame, int y, int h, int n)
+//[]---------------------------------------------------[]
+//|  Tiled scan of a band of rows by n workers          |
+//|  @param render context                              |
+//|  @param W x H frame                                 |
+//|  @param first row of the band                       |
+//|  @param number of rows of the band                  |
+//|  @param number of workers                           |
+//[]---------------------------------------------------[]
+{
+	TileScheduler scheduler(context.W, h, context.tileSize, n, y);
+	ScanWorker* workers = new ScanWorker[n];
+
+	// worker 0 runs on the calling thread
+	for (int i = 0; i < n; i++)
+		workers[i].set(this, context, &scheduler, &frame, i);
+	for (int i = 1; i < n; i++)
+		if (!workers[i].start())
+			break;
+	workers[0].run();
+	for (int i = 1; i < n; i++)
+		workers[i].join();
+	for (int i = 0; i < n; i++)
+	{
+		context.rayCounts += workers[i].getContext().rayCounts;
+		context.statistics += workers[i].getContext().statistics;
+		context.occluderCacheStatistics +=
+			workers[i].getOccluderCache().getStatistics();
+		context.wavefrontStatistics +=
+			workers[i].getWavefront().getStatistics();
+	}
+	delete []workers;
+}
+
+void
+RayTracer::scanTile(Context& context, const Tile& tile, HDRImage& frame)
+//[]---------------------------------------------------[]
+//|  Scan a tile into a W x H frame                     |
+//[]---------------------------------------------------[]
+{
+	int ie = tile.x + tile.w;
+	int je = tile.y + tile.h;
+	int s = context.step;
+	// the first block of each 2x2 group was shot by the previous pass
+	int lanes = context.refining ? RAY_PACKET_MASK & ~1 : RAY_PACKET_MASK;
+
+	if (context.aliased != 0)
+	{
+		antialiasTile(context, tile, frame);
+		return;
+	}
+	if (context.wavefront != 0)
+	{
+		wavefrontTile(context, tile, frame);
+		return;
+	}
+
+	// shoot 2x2 groups of blocks, as packets if packet tracing is on;
+	// lanes out of the tile, reprojected or not dirty are inactive
+	for (int j = tile.y; j < je; j += 2 * s)
+		for (int i = tile.x; i < ie; i += 2 * s)
+		{
+			Color colors[RAY_PACKET_SIZE];
+			int active = 0;
+
+			for (int k = 0; k < RAY_PACKET_SIZE; k++)
+			{
+				int x = i + (k & 1) * s;
+				int y = j + (k >> 1) * s;
+
+				if (lanes & 1 << k && x < ie && y < je &&
+					isScanned(context, x, y))
+					active |= 1 << k;
+			}
+			if (packetTracing)
+			{
+				RayPacket packet;
+
+				for (int k = 0; k < RAY_PACKET_SIZE; k++)
+					if (active & 1 << k)
+					{
+						setPixelRay(context,
+							i + (k & 1) * s + 0.5f,
+							j + (k >> 1) * s + 0.5f);
+						packet.set(k, context.pixelRay);
+					}
+				packet.pad();
+				shoot(context, packet, colors);
+			}
+			else
+				for (int k = 0; k < RAY_PACKET_SIZE; k++)
+					if (active & 1 << k)
+					{
+						colors[k] = shoot(context,
+							i + (k & 1) * s + 0.5f,
+							j + (k >> 1) * s + 0.5f);
+						context.primaryHits[k] = context.primaryHits[0];
+						context.pixelTrees[k] = context.tree;
+					}
+			for (int k = 0; k < RAY_PACKET_SIZE; k++)
+				if (active & 1 << k)
+					setBlock(context,
+						i + (k & 1) * s,
+						j + (k >> 1) * s,
+						ie,
+						je,
+						colors[k],
+						context.primaryHits[k],
+						context.pixelTrees[k],
+						frame);
+		}
+}
+
+inline bool
+RayTracer::isScanned(const Context& context, int x, int y) const
+//[]---------------------------------------------------[]
+//|  Is a pixel to be traced (neither reprojected nor   |
+//|  clean)?                                            |
+//[]---------------------------------------------------[]
+{
+	ReprojectionCache* cache = context.reprojectionCache;
+	DirtyRegion* region = context.dirtyRegion;
+
+	return (cache == 0 || !cache->isReprojected(x, y)) &&
+		(region == 0 || region->isDirty(x, y));
+}
+
+void
+RayTracer::setBlock(Context& context,
+	int x,
+	int y,
+	int ie,
+	int je,
+	const Color& color,
+	ReprojectionCache::Sample& hit,
+	DirtyRegion::Tree& tree,
+	HDRImage& frame)
+//[]---------------------------------------------------[]
+//|  Fill the block of a pixel ray                      |
+//|  @param render context                              |
+//|  @param first column of the block                   |
+//|  @param first row of the block                      |
+//|  @param column past the end of the tile             |
+//|  @param row past the end of the tile                |
+//|  @param color of the ray                            |
+//|  @param primary hit of the ray                      |
+//|  @param summary of the ray tree                     |
+//|  @param W x H frame                                 |
+//|                                                     |
+//|  The ray of a block is the one of its first pixel,  |
+//|  whose sample and tree are recorded.                |
+//[]---------------------------------------------------[]
+{
+	int xe = Math::min<int>(x + context.step, ie);
+	int ye = Math::min<int>(y + context.step, je);
+
+	if (context.reprojectionCache != 0)
+	{
+		hit.color = color;
+		context.reprojectionCache->set(x, y, hit);
+	}
+	if (context.dirtyRegion != 0)
+	{
+		tree.point = hit.point;
+		if (hit.object != 0)
+			tree.flags |= DirtyRegion::Hit;
+		context.dirtyRegion->set(x, y, tree);
+	}
+	for (; y < ye; y++)
+		for (int p = x; p < xe; p++)
+			frame.set(p, y, color);
+}
+
+void
+RayTracer::wavefrontTile(Context& context, const Tile& tile, HDRImage& frame)
+//[]---------------------------------------------------[]
+//|  Scan a tile as waves of rays                       |
+//|  @param render context (with wavefront buffers)     |
+//|  @param the tile                                    |
+//|  @param W x H frame                                 |
+//|                                                     |
+//|  The pixel rays of the blocks are queued in the     |
+//|  order of the 2x2 groups shot by scanTile(), and    |
+//|  then traced by traceWave().                        |
+//[]---------------------------------------------------[]
+{
+	Wavefront& wave = *context.wavefront;
+	double time = System::Timer::now();
+	int ie = tile.x + tile.w;
+	int je = tile.y + tile.h;
+	int s = context.step;
+	int lanes = context.refining ? RAY_PACKET_MASK & ~1 : RAY_PACKET_MASK;
+
+	wave.numberOfBlocks = wave.numberOfRays = 0;
+	for (int j = tile.y; j < je; j += 2 * s)
+		for (int i = tile.x; i < ie; i += 2 * s)
+			for (int k = 0; k < RAY_PACKET_SIZE; k++)
+			{
+				int x = i + (k & 1) * s;
+				int y = j + (k >> 1) * s;
+
+				if ((lanes & 1 << k) == 0 || x >= ie || y >= je ||
+					!isScanned(context, x, y))
+					continue;
+
+				int b = wave.numberOfBlocks++;
+				Wavefront::PathRay& r = wave.rays[wave.numberOfRays++];
+
+				wave.blockX[b] = x;
+				wave.blockY[b] = y;
+				setPixelRay(context, x + 0.5f, y + 0.5f);
+				r.ray = context.pixelRay;
+				r.weight = 1;
+				r.block = b;
+			}
+	wave.addTime(Wavefront::Generate, System::Timer::now() - time);
+	traceWave(context, wave);
+	for (int b = 0; b < wave.numberOfBlocks; b++)
+		setBlock(context,
+			wave.blockX[b],
+			wave.blockY[b],
+			ie,
+			je,
+			wave.colors[b],
+			wave.primaryHits[b],
+			wave.trees[b],
+			frame);
+}
+
+void
+RayTracer::traceWave(Context& context, Wavefront& wave)
+//[]---------------------------------------------------[]
+//|  Trace the paths of the pixel rays of a wavefront   |
+//|  @param render context                              |
+//|  @param the wavefront, holding the pixel rays       |
+//|  (input) and the colors, primary hits and ray tree  |
+//|  summaries of their blocks (output)                 |
+//|                                                     |
+//|  Each wave is intersected, its shadow rays traced   |
+//|  and its hits shaded, spawning the reflected rays   |
+//|  of the next wave. The colors are the same as the   |
+//|  ones of the depth-first evaluation.                |
+//[]---------------------------------------------------[]
+{
+	int n = wave.numberOfBlocks;
+
+	context.rayCounts.primary += wave.numberOfRays;
+	if (maxRecursionLevel < 0)
+	{
+		for (int b = 0; b < n; b++)
+		{
+			wave.colors[b] = Color::black;
+			wave.primaryHits[b].object = 0;
+			wave.trees[b] = DirtyRegion::Tree();
+		}
+		return;
+	}
+	for (int b = 0; b < n; b++)
+	{
+		wave.depths[b] = 0;
+		wave.trees[b] = DirtyRegion::Tree();
+	}
+
+	// the hits are shaded with the shadows of the wave, unless the
+	// lights do not fit in the bits of an int
+	bool waveShadows = scene->getNumberOfLights() <= (int)sizeof(int) * 8;
+	BoundingBox bounds = scene->getBoundingBox();
+
+	for (int level = 0; wave.numberOfRays > 0; level++)
+	{
+		double time = System::Timer::now();
+		double now;
+
+		wave.addWave();
+		COUNT_DEPTH(level, wave.numberOfRays);
+		intersectWave(wave, level);
+		now = System::Timer::now();
+		wave.addTime(Wavefront::Intersect, now - time);
+		time = now;
+		if (waveShadows)
+		{
+			shadowWave(context, wave, level);
+			now = System::Timer::now();
+			wave.addTime(Wavefront::Shadow, now - time);
+			time = now;
+		}
+		for (int h = 0; h < wave.numberOfHits; h++)
+		{
+			Wavefront::Hit& hit = wave.hits[h];
+			const Wavefront::PathRay& r = wave.rays[hit.ray];
+			RayStack::Vertex& v = wave.getVertex(level, r.block);
+			REAL weight = r.weight;
+
+			context.tree = wave.trees[r.block];
+			if (shade(context,
+				r.ray,
+				hit.info,
+				level,
+				weight,
+				waveShadows ? wave.shadowed + h : 0,
+				v))
+			{
+				Wavefront::PathRay& spawned = wave.spawned[wave.numberOfSpawned++];
+
+				spawned.ray = v.ray;
+				spawned.weight = weight;
+				spawned.block = r.block;
+				wave.depths[r.block]++;
+			}
+			else
+				wave.colors[r.block] = v.color;
+			wave.trees[r.block] = context.tree;
+		}
+		now = System::Timer::now();
+		wave.addTime(Wavefront::Shade, now - time);
+		wave.sort(bounds);
+		wave.addTime(Wavefront::Sort, System::Timer::now() - now);
+	}
+
+	double time = System::Timer::now();
+
+	// combine the colors of the vertices from the last one back
+	for (int b = 0; b < n; b++)
+	{
+		Color color = wave.colors[b];
+
+		for (int d = wave.depths[b]; --d >= 0;)
+		{
+			const RayStack::Vertex& v = wave.getVertex(d, b);
 
-using namespace Graphics;
+			color = v.color + v.specular * color;
+		}
+		wave.colors[b] = color;
+	}
+	wave.addTime(Wavefront::Combine, System::Timer::now() - time);
+}
+
+void
+RayTracer::intersectWave(Wavefront& wave, int level)
+//[]---------------------------------------------------[]
+//|  Find the closest hits of the rays of a wave        |
+//|  @param the wavefront                               |
+//|  @param level of the rays of the wave               |
+//|                                                     |
+//|  Runs of four rays are intersected as packets, if   |
+//|  packet tracing is on. The blocks whose rays miss   |
+//|  get the background color.                          |
+//[]---------------------------------------------------[]
+{
+	int n = wave.numberOfRays;
+	int step = packetTracing ? RAY_PACKET_SIZE : 1;
 
+	wave.numberOfHits = 0;
+	for (int i = 0; i < n; i += step)
+	{
+		PacketHit hit;
+		int mask;
 
-//////////////////////////////////////////////////////////
-//
-// RayTracer implementation
-// =========
-RayTracer::RayTracer(Scene& scene, Camera* camera):
+		if (packetTracing)
+		{
+			RayPacket packet;
+
+			for (int k = 0; k < RAY_PACKET_SIZE && i + k < n; k++)
+				packet.set(k, wave.rays[i + k].ray);
+			packet.pad();
+			mask = intersect(packet, hit, Real4(Math::infinity<REAL>()));
+			mask &= packet.active;
+		}
+		else
+			mask = intersect(wave.rays[i].ray,
+				hit.info[0],
+				Math::infinity<REAL>()) ? 1 : 0;
+		for (int k = 0; k < step && i + k < n; k++)
+		{
+			const Wavefront::PathRay& r = wave.rays[i + k];
+			IntersectInfo& info = hit.info[k];
+
+			if (level == 0)
+			{
+				ReprojectionCache::Sample& sample = wave.primaryHits[r.block];
+
+				sample.object = mask & 1 << k ? info.object : 0;
+				sample.point = makeRayPoint(r.ray, info.distance);
+			}
+			else if (mask & 1 << k)
+				wave.trees[r.block].touch(info.object);
+			if (mask & 1 << k)
+			{
+				Wavefront::Hit& h = wave.hits[wave.numberOfHits++];
+
+				h.info = info;
+				h.ray = i + k;
+			}
+			else
+				wave.colors[r.block] = background();
+		}
+	}
+}
+
+void
+RayTracer::shadowWave(Context& context, Wavefront& wave, int level)
 //[]---------------------------------------------------[]
-//|  Constructor                                        |
+//|  Trace the shadow rays of the hits of a wave        |
+//|  @param render context                              |
+//|  @param the wavefront                               |
+//|  @param level of the rays of the wave               |
+//|                                                     |
+//|  The shadow rays toward each light are queued and   |
+//|  traced as packets of four, if packet tracing is    |
+//|  on. Below the pixel rays, whose shadows are checked|
+//|  against the changes by markDirty(), the occluders  |
+//|  of the rays of dirty region tracking are needed,   |
+//|  so the rays are traced one by one.                 |
 //[]---------------------------------------------------[]
-	Renderer(scene, camera)
 {
-	maxRecursionLevel = 10;
-	minWeight = 0.001f;
+	int n = wave.numberOfHits;
+	bool single = !packetTracing || (level > 0 && context.dirtyRegion != 0);
+
+	for (int h = 0; h < n; h++)
+	{
+		Wavefront::Hit& hit = wave.hits[h];
+		const Ray& ray = wave.rays[hit.ray].ray;
+
+		wave.shadowed[h] = 0;
+		hit.point = makeRayPoint(ray, hit.info.distance);
+		hit.normal = getHitNormal(hit.info);
+		// make sure "real" normal is on right side
+		if (Math::isPositive(hit.normal.inner(ray.direction)))
+			hit.normal.negate();
+	}
+
+	int l = 0; // light index
+
+	for (LightIterator lit(scene->getLightIterator()); lit; l++)
+	{
+		Light* light = lit++; // light source
+
+		if (!light->isOn)
+			continue;
+		// queue the shadow rays of the hits not backfaced to the light
+		wave.numberOfShadowRays = 0;
+		for (int h = 0; h < n; h++)
+		{
+			const Wavefront::Hit& hit = wave.hits[h];
+			Vec3 L; // light vector
+			REAL t; // light distance
+
+			light->getVector(hit.point, L, t);
+			if (Math::isPositive(hit.normal.inner(L)))
+			{
+				Wavefront::ShadowRay& s =
+					wave.shadowRays[wave.numberOfShadowRays++];
+
+				s.ray.set(hit.point, L);
+				s.maxDistance = t;
+				s.hit = h;
+			}
+		}
+		for (int i = 0, m = wave.numberOfShadowRays; i < m;)
+			if (single)
+			{
+				Wavefront::ShadowRay& s = wave.shadowRays[i++];
+				Wavefront::Hit& hit = wave.hits[s.hit];
+				DirtyRegion::Tree& tree = wave.trees[wave.rays[hit.ray].block];
+				Color color;
 
+				context.tree = tree;
+				if (!notShadow(context, l, s.ray, hit.info, s.maxDistance, color))
+					wave.shadowed[s.hit] |= 1 << l;
+				tree = context.tree;
+			}
+			else
+			{
+				RayPacket packet;
+				Real4 maxDistance;
+				int k;
+
+				for (k = 0; k < RAY_PACKET_SIZE && i + k < m; k++)
+				{
+					const Ray& ray = wave.shadowRays[i + k].ray;
+
+					packet.set(k, Ray(ray.origin + ray.direction * EPS,
+						ray.direction));
+					maxDistance.set(k, wave.shadowRays[i + k].maxDistance);
+				}
+				packet.pad();
+
+				int blocked = traceShadows(context, l, packet, maxDistance);
+
+				for (int j = 0; j < k; j++)
+					if (blocked & 1 << j)
+						wave.shadowed[wave.shadowRays[i + j].hit] |= 1 << l;
+				i += k;
+			}
+	}
 }
 
 //
-// Auxiliary VRC
+// Auxiliary functions
 //
-static Vec3 VRC_u;
-static Vec3 VRC_v;
-static Vec3 VRC_n;
+inline REAL
+radicalInverse(int i, int base)
+{
+	REAL f = Math::inverse((REAL)base);
+	REAL r = 0;
 
-//
-// Auxiliary mapping variables
-//
-static REAL VW_h;
-static REAL VW_w;
-static REAL II_h;
-static REAL II_w;
+	for (REAL g = f; i > 0; i /= base, g *= f)
+		r += g * (i % base);
+	return r;
+}
 
-void
-RayTracer::render()
+inline int
+contrast(const Pixel& p, const Pixel& q)
+{
+	int r = abs(p.r - q.r);
+	int g = abs(p.g - q.g);
+	int b = abs(p.b - q.b);
+
+	return r > g ? (r > b ? r : b) : (g > b ? g : b);
+}
+
+inline void
+inflate(Color& low, Color& high, Color c)
+{
+	// compare the samples in the displayable range
+	c.r = Math::min<REAL>(c.r, 1);
+	c.g = Math::min<REAL>(c.g, 1);
+	c.b = Math::min<REAL>(c.b, 1);
+	low.r = Math::min(low.r, c.r);
+	low.g = Math::min(low.g, c.g);
+	low.b = Math::min(low.b, c.b);
+	high.r = Math::max(high.r, c.r);
+	high.g = Math::max(high.g, c.g);
+	high.b = Math::max(high.b, c.b);
+}
+
+bool
+RayTracer::isEdge(const Context& context, int i, int j, int threshold) const
 //[]---------------------------------------------------[]
-//|  Render                                             |
+//|  Does a pixel of the aliased frame differ from any  |
+//|  of its 4-neighbors by more than a threshold (in    |
+//|  0-255 units)?                                      |
 //[]---------------------------------------------------[]
 {
-	printf("Invoke renderImage(image) to run the ray tracer\n");
+	int w = context.W;
+	const Pixel* p = context.aliased + j * w + i;
+
+	return (i > 0 && contrast(*p, p[-1]) > threshold) ||
+		(i < w - 1 && contrast(*p, p[1]) > threshold) ||
+		(j > 0 && contrast(*p, p[-w]) > threshold) ||
+		(j < context.H - 1 && contrast(*p, p[w]) > threshold);
 }
 
 void
-RayTracer::renderImage(Image& image)
+RayTracer::antialiasTile(Context& context, const Tile& tile, HDRImage& frame)
 //[]---------------------------------------------------[]
-//|  Run the ray tracer                                 |
+//|  Adaptive supersampling of a tile                   |
+//|  @param render context (of an antialiasing pass)    |
+//|  @param the tile                                    |
+//|  @param W x H frame (of one sample per pixel)       |
+//|                                                     |
+//|  Samples are added only to the edge pixels of the   |
+//|  aliased frame (which are dirty, if tracking dirty  |
+//|  regions). The samples of an edge pixel are added   |
+//|  in batches at the points of a Halton sequence,     |
+//|  until their colors are within the contrast         |
+//|  threshold or the pixel has got maxSamples samples. |
 //[]---------------------------------------------------[]
 {
-	image.getSize(W, H);
-	// init auxiliary VRC
-	VRC_n = camera->getViewPlaneNormal();
-	VRC_v = camera->getViewUp();
-	VRC_u = VRC_v.cross(VRC_n);
-	// init auxiliary mapping variables
-	II_w = Math::inverse((REAL)W);
-	II_h = Math::inverse((REAL)H);
+	int ie = tile.x + tile.w;
+	int je = tile.y + tile.h;
+	int threshold = (int)(contrastThreshold * 255);
 
-	REAL height = camera->windowHeight();
+	for (int j = tile.y; j < je; j++)
+		for (int i = tile.x; i < ie; i++)
+		{
+			if ((context.dirtyRegion != 0 &&
+				!context.dirtyRegion->isDirty(i, j)) ||
+				!isEdge(context, i, j, threshold))
+				continue;
 
-	if (W >= H)
-		VW_w = (VW_h = height) * W * II_h;
-	else
-		VW_h = (VW_w = height) * H * II_w;
-	// init pixel ray
-	pixelRay.origin = camera->getPosition();
-	pixelRay.direction = -VRC_n;
-	scan(image);
+			// the first sample is the one of the pixel center
+			Color low = Color::white;
+			Color high = Color::black;
+			int n = 1;
+			DirtyRegion::Tree tree;
+
+			inflate(low, high, frame.getColor(i, j));
+			if (context.dirtyRegion != 0)
+				tree = context.dirtyRegion->getTree(i, j);
+			while (n < maxSamples)
+			{
+				for (int k = 0; k < ANTIALIASING_BATCH && n < maxSamples; k++, n++)
+				{
+					Color c = shoot(context,
+						i + radicalInverse(n, 2),
+						j + radicalInverse(n, 3));
+
+					frame.add(i, j, c);
+					inflate(low, high, c);
+					// the tree of the pixel spans the ones of its samples
+					tree.touched |= context.tree.touched;
+					tree.flags |= context.tree.flags;
+				}
+				if (high.r - low.r <= contrastThreshold &&
+					high.g - low.g <= contrastThreshold &&
+					high.b - low.b <= contrastThreshold)
+					break;
+			}
+			if (context.dirtyRegion != 0)
+				context.dirtyRegion->set(i, j, tree);
+		}
 }
 
-void
-RayTracer::scan(Image& image)
+bool
+RayTracer::reproject(Context& context, HDRImage& frame)
 //[]---------------------------------------------------[]
-//|  Basic scan with optional jitter                    |
+//|  Reproject the last complete frame into a new one   |
+//|  @param render context (of the new frame)           |
+//|  @param the new frame                               |
+//|  @return false if there is no frame to reproject    |
 //[]---------------------------------------------------[]
 {
-	Pixel* pixels = new Pixel[W];
+	ReprojectionCache* cache = context.reprojectionCache;
+	bool valid = cache->isValid(context.W, context.H, scene->getVersion());
+
+	cache->begin(context.W, context.H);
+	if (!valid)
+		return false;
 
-	for (int j = 0; j < H; j++)
+	REAL sx = context.W * 0.5f;
+	REAL sy = context.H * 0.5f;
+
+	for (int k = 0, n = context.W * context.H; k < n; k++)
 	{
-		REAL y = j + 0.5f;
+		const ReprojectionCache::Sample& sample = cache->getPrevious(k);
 
-		printf("Scanning line %d of %d\r", j + 1, H);
-		for (int i = 0; i < W; i++)
-			pixels[i] = shoot(i + 0.5f, y);
-		image.write(j, pixels);
+		// the background and the reflective surfaces are traced again
+		if (sample.object == 0)
+			continue;
+
+		const Color& r = sample.object->getMaterial()->surface.specular;
+
+		if (r.r > 0 || r.g > 0 || r.b > 0)
+			continue;
+
+		Vec3 p = project(*context.camera, context.W, context.H, sample.point);
+
+		if (!Math::isPositive(p.z))
+			continue;
+
+		REAL x = (p.x + 1) * sx;
+		REAL y = (p.y + 1) * sy;
+
+		if (x >= 0 && x < context.W && y >= 0 && y < context.H)
+			cache->cover((int)x, (int)y, p.z, sample);
 	}
-	delete []pixels;
+	cache->trim();
+	for (int j = 0; j < context.H; j++)
+		for (int i = 0; i < context.W; i++)
+			if (cache->isReprojected(i, j))
+				frame.set(i, j, cache->getCurrent(i, j).color);
+	return true;
+}
+
+//
+// Auxiliary function
+//
+inline bool
+castsShadow(const Scene& scene,
+	const Vec3& P,
+	const SceneChange changes[],
+	int n)
+{
+	// may the shadow rays of P cross the bounds of some changed actor?
+	for (LightIterator lit(scene.getLightIterator()); lit;)
+	{
+		Light* light = lit++;
+		Vec3 L;
+		REAL t;
+
+		if (!light->isOn)
+			continue;
+		if (light->isDirectional)
+		{
+			L = light->position.versor();
+			t = Math::infinity<REAL>();
+		}
+		else
+		{
+			L = light->position - P;
+			t = 1;
+		}
+		L = L.inverse();
+		for (int c = 0; c < n; c++)
+		{
+			REAL tMin;
+			REAL tMax;
+
+			if (changes[c].boundingBox.intersect(P, L, tMin, tMax) && tMin <= t)
+				return true;
+		}
+	}
+	return false;
+}
+
+bool
+RayTracer::markDirty(Context& context)
+//[]---------------------------------------------------[]
+//|  Mark the pixels of the last complete frame which   |
+//|  the changes of the scene made after it may have    |
+//|  affected                                           |
+//|  @param render context (of the new frame)           |
+//|  @return false if there is no frame to reuse        |
+//[]---------------------------------------------------[]
+{
+	DirtyRegion* region = context.dirtyRegion;
+	SceneChange changes[SCENE_CHANGE_LOG_SIZE];
+	int n = -1;
+
+	// an antialiased frame is reused only along with its aliased one
+	if (region->isValid(context.W, context.H, context.camera->getTimestamp()) &&
+		(maxSamples <= 1 || progressiveAliased != 0))
+		n = scene->getChanges(region->getVersion(), changes);
+	region->begin(context.W, context.H, n >= 0);
+	if (n < 0)
+		return false;
+
+	REAL sx = context.W * 0.5f;
+	REAL sy = context.H * 0.5f;
+	uint touched = 0;
+	bool appeared = false;
+
+	// the pixels covered by the changed actors, plus one around
+	for (int c = 0; c < n; c++)
+	{
+		Vec3 p1;
+		Vec3 p2;
+
+		touched |= DirtyRegion::hash(changes[c].model);
+		appeared |= changes[c].appeared;
+		if (!project(*context.camera,
+			context.W,
+			context.H,
+			changes[c].boundingBox,
+			p1,
+			p2))
+		{
+			region->setDirty(0, 0, context.W - 1, context.H - 1);
+			continue;
+		}
+
+		REAL x1 = Math::max<REAL>((p1.x + 1) * sx - 1, 0);
+		REAL y1 = Math::max<REAL>((p1.y + 1) * sy - 1, 0);
+		REAL x2 = Math::min<REAL>((p2.x + 1) * sx + 1, context.W - 1);
+		REAL y2 = Math::min<REAL>((p2.y + 1) * sy + 1, context.H - 1);
+
+		if (x1 <= x2 && y1 <= y2)
+			region->setDirty((int)x1, (int)y1, (int)x2, (int)y2);
+	}
+	// the pixels whose ray trees may have changed
+	for (int j = 0; j < context.H; j++)
+		for (int i = 0; i < context.W; i++)
+		{
+			if (region->isDirty(i, j))
+				continue;
+
+			const DirtyRegion::Tree& tree = region->getTree(i, j);
+
+			if ((tree.flags & DirtyRegion::Unknown) != 0 ||
+				(tree.touched & touched) != 0 ||
+				(appeared && (tree.flags & DirtyRegion::Reflected) != 0) ||
+				((tree.flags & DirtyRegion::Hit) != 0 &&
+				castsShadow(*scene, tree.point, changes, n)))
+				region->setDirty(i, j);
+		}
+	// the edge pixels of the aliased frame next to the dirty ones may
+	// have changed
+	if (maxSamples > 1)
+		region->dilate();
+
+	// the samples of the clean pixels are kept for reprojection
+	ReprojectionCache* cache = context.reprojectionCache;
+
+	if (cache != 0)
+	{
+		bool valid = cache->isValid(context.W, context.H, region->getVersion());
+
+		cache->begin(context.W, context.H);
+		if (!valid)
+			context.reprojectionCache = 0;
+		else
+			for (int j = 0; j < context.H; j++)
+				for (int i = 0; i < context.W; i++)
+					if (!region->isDirty(i, j))
+						cache->set(i, j, cache->getPrevious(j * context.W + i));
+	}
+	return true;
 }
 
 Color
-RayTracer::shoot(REAL x, REAL y)
+RayTracer::shoot(Context& context, REAL x, REAL y)
 //[]---------------------------------------------------[]
 //|  Shoot a pixel ray                                  |
+//|  @param render context                              |
 //|  @param x coordinate of the pixel                   |
 //|  @param y cordinates of the pixel                   |
-//|  @return RGB color of the pixel                     |
+//|  @return RGB color of the pixel (not clamped)       |
 //[]---------------------------------------------------[]
 {
 	Color color;
 
 	// set pixel ray
-	setPixelRay(x, y);
+	setPixelRay(context, x, y);
+	context.rayCounts.primary++;
+	context.tree = DirtyRegion::Tree();
 	// trace pixel ray
-	trace(pixelRay, color, 0, 1.0f);
-	// adjust RGB color
-	if (color.r > 1.0f)
-		color.r = 1.0f;
-	if (color.g > 1.0f)
-		color.g = 1.0f;
-	if (color.b > 1.0f)
-		color.b = 1.0f;
+	REAL distance = trace(context, context.pixelRay, color, 0, 1.0f);
+
+	// record the hit point (the object is recorded by trace())
+	context.primaryHits[0].point = makeRayPoint(context.pixelRay, distance);
 	// return pixel color
 	return color;
 }
 
 void
-RayTracer::setPixelRay(REAL x, REAL y)
+RayTracer::shoot(Context& context, RayPacket& packet, Color* colors)
+//[]---------------------------------------------------[]
+//|  Shoot a packet of pixel rays                       |
+//|  @param render context                              |
+//|  @param the pixel rays                              |
+//|  @param RGB colors of the active lanes (output, not |
+//|  clamped)                                           |
+//|                                                     |
+//|  Primary and shadow rays are traced in packets;     |
+//|  shading and reflected rays fall back to single     |
+//|  rays, as do the shadow rays of scenes with more    |
+//|  lights than the bits of an int.                    |
+//[]---------------------------------------------------[]
+{
+	if (maxRecursionLevel < 0)
+	{
+		for (int k = 0; k < RAY_PACKET_SIZE; k++)
+			colors[k] = Color::black;
+		return;
+	}
+
+	context.rayCounts.primary += countLanes(packet.active);
+	COUNT_DEPTH(0, countLanes(packet.active));
+
+	PacketHit hit;
+	int mask = intersect(packet, hit, Real4(Math::infinity<REAL>()));
+	int shadowed[RAY_PACKET_SIZE];
+	bool packetShadows = scene->getNumberOfLights() <= (int)sizeof(int) * 8;
+
+	if (mask != 0 && packetShadows)
+		notShadow(context, packet, hit, mask, shadowed);
+	for (int k = 0; k < RAY_PACKET_SIZE; k++)
+	{
+		if ((packet.active & 1 << k) == 0)
+			continue;
+
+		Color& color = colors[k];
+
+		context.primaryHits[k].object = hit.info[k].object;
+		context.primaryHits[k].point =
+			makeRayPoint(packet.rays[k], hit.info[k].distance);
+		context.tree = DirtyRegion::Tree();
+		if (mask & 1 << k)
+			color = evaluate(context,
+				packet.rays[k],
+				hit.info[k],
+				0,
+				1.0f,
+				packetShadows ? shadowed + k : 0);
+		else
+			color = background();
+		context.pixelTrees[k] = context.tree;
+	}
+}
+
+void
+RayTracer::setPixelRay(Context& c, REAL x, REAL y)
 //[]---------------------------------------------------[]
 //|  Set pixel ray                                      |
+//|  @param render context                              |
 //|  @param x coordinate of the pixel                   |
 //|  @param y cordinates of the pixel                   |
 //[]---------------------------------------------------[]
 {
 	Vec3 p;
 
-	p = VW_w * (x * II_w - 0.5) * VRC_u + VW_h * (y * II_h - 0.5) * VRC_v;
-	switch (camera->getProjectionType())
+	p = c.VW_w * (x * c.II_w - 0.5) * c.VRC_u +
+		c.VW_h * (y * c.II_h - 0.5) * c.VRC_v;
+	switch (c.camera->getProjectionType())
 	{
 		case Camera::Perspective:
-			pixelRay.direction = (p - camera->getDistance() * VRC_n).versor();
+			c.pixelRay.direction = (p - c.camera->getDistance() * c.VRC_n).versor();
 			break;
 
 		case Camera::Parallel:
-			pixelRay.origin = camera->getPosition() + p;
+			c.pixelRay.origin = c.camera->getPosition() + p;
 			break;
 	}
 }
 
 REAL
-RayTracer::trace(const Ray& ray, Color& color, int level, REAL weight)
+RayTracer::trace(Context& context,
+	const Ray& ray,
+	Color& color,
+	int level,
+	REAL weight)
 //[]---------------------------------------------------[]
 //|  Trace a ray                                        |
+//|  @param render context                              |
 //|  @param the ray (input)                             |
 //|  @param color of the ray (output)                   |
 //|  @param recursion level                             |
@@ -172,20 +1571,25 @@ RayTracer::trace(const Ray& ray, Color& color, int level, REAL weight)
 		color = Color::black;
 		return 0;
 	}
+	COUNT_DEPTH(level, 1);
 
 	IntersectInfo hit;
 
 	if (intersect(ray, hit, Math::infinity<REAL>()))
 	{
-		color = shade(ray, hit, level, weight);
+		if (level == 0)
+			context.primaryHits[0].object = hit.object;
+		else
+			context.tree.touch(hit.object);
+		color = evaluate(context, ray, hit, level, weight, 0);
 		return hit.distance;
 	}
+	if (level == 0)
+		context.primaryHits[0].object = 0;
 	color = background();
 	return Math::infinity<REAL>();
 }
 
-#define EPS 1e-4f // TODO
-
 bool
 RayTracer::intersect(const Ray& ray, IntersectInfo& hit, REAL maxDist)
 //[]---------------------------------------------------[]
@@ -196,21 +1600,58 @@ RayTracer::intersect(const Ray& ray, IntersectInfo& hit, REAL maxDist)
 //|  @return true if the ray intersects an object       |
 //[]---------------------------------------------------[]
 {
-	hit.distance = maxDist;
-	hit.object = 0;
+	return accelerator->intersect(ray, hit, maxDist);
+}
 
-	IntersectInfo temp;
+int
+RayTracer::intersect(const RayPacket& packet,
+	PacketHit& hit,
+	const Real4& maxDist)
+//[]---------------------------------------------------[]
+//|  Ray packet/object intersection                     |
+//|  @param the ray packet (input)                      |
+//|  @param information on intersections (output)       |
+//|  @param background distances                        |
+//|  @return mask of the lanes which intersect an object|
+//[]---------------------------------------------------[]
+{
+	return accelerator->intersect(packet, hit, maxDist);
+}
 
-	for (ActorIterator ait(scene->getActorIterator()); ait; ++ait)
-		if (ait.current()->isVisible)
-		{
-			Model* object = ait.current()->getModel();
+bool
+RayTracer::occluded(const Ray& ray,
+	REAL maxDist,
+	Actor** occluder,
+	const Actor* skipped)
+//[]---------------------------------------------------[]
+//|  Ray/object occlusion query                         |
+//|  @param the ray                                     |
+//|  @param distance beyond which hits do not count     |
+//|  @param the actor hit, if any (optional output)     |
+//|  @param actor not to be tested (optional)           |
+//|  @return true if the ray hits any object closer     |
+//|  than maxDist                                       |
+//[]---------------------------------------------------[]
+{
+	return accelerator->occluded(ray, maxDist, occluder, skipped);
+}
 
-			if (object->intersect(ray, temp))
-				if (temp.distance < hit.distance)
-					hit = temp;
-		}
-	return hit.object != 0;
+int
+RayTracer::occluded(const RayPacket& packet,
+	const Real4& maxDist,
+	Actor** occluder,
+	const Actor* skipped)
+//[]---------------------------------------------------[]
+//|  Ray packet/object occlusion query                  |
+//|  @param the ray packet                              |
+//|  @param distances beyond which hits do not count    |
+//|  @param the last actor hit, if any (optional output)|
+//|  @param actor not to be tested (optional)           |
+//|  @return mask of the lanes which hit any object     |
+//|  closer than maxDist                                |
+//[]---------------------------------------------------[]
+{
+	return accelerator->occluded(packet, maxDist, occluder, skipped);
 }
 
 Color
@@ -236,20 +1677,91 @@ maxRGB(Color& color)
 }
 
 Color
-RayTracer::shade(const Ray& ray, IntersectInfo& hit, int level, REAL weight)
+RayTracer::evaluate(Context& context,
+	const Ray& ray,
+	IntersectInfo& hit,
+	int level,
+	REAL weight,
+	const int* shadowed)
+//[]---------------------------------------------------[]
+//|  Evaluate the color of a ray                        |
+//|  @param render context                              |
+//|  @param the ray (input)                             |
+//|  @param information on intersection (input)         |
+//|  @param level of the ray                            |
+//|  @param ray weight                                  |
+//|  @param bit l set if the hit is shadowed from the   |
+//|  light l (null: test the shadows with notShadow())  |
+//|  @return color of the ray                           |
+//|                                                     |
+//|  The path of the ray is traced iteratively: each    |
+//|  hit is shaded and its reflected ray pushed onto    |
+//|  the ray stack of the context, then traced, until   |
+//|  a ray misses or no ray is spawned; the colors of   |
+//|  the hits are then combined from the last one back. |
+//[]---------------------------------------------------[]
+{
+	RayStack& stack = *context.rayStack;
+	Ray r = ray;
+	IntersectInfo h = hit;
+	Color color;
+
+	for (;;)
+	{
+		RayStack::Vertex& v = stack.push();
+
+		if (!shade(context, r, h, level, weight, shadowed, v))
+		{
+			color = stack.pop().color;
+			break;
+		}
+		// trace the reflected ray of the vertex
+		r = v.ray;
+		shadowed = 0;
+		level++;
+		COUNT_DEPTH(level, 1);
+		if (!intersect(r, h, Math::infinity<REAL>()))
+		{
+			color = background();
+			break;
+		}
+		context.tree.touch(h.object);
+	}
+	while (!stack.isEmpty())
+	{
+		const RayStack::Vertex& v = stack.pop();
+
+		color = v.color + v.specular * color;
+	}
+	return color;
+}
+
+bool
+RayTracer::shade(Context& context,
+	const Ray& ray,
+	IntersectInfo& hit,
+	int level,
+	REAL& weight,
+	const int* shadowed,
+	RayStack::Vertex& vertex)
 //[]---------------------------------------------------[]
 //|  Shade a point P                                    |
+//|  @param render context                              |
 //|  @param the ray (input)                             |
 //|  @param information on intersection (input)         |
-//|  @param recursion level                             |
-//|  @param shade weight                                |
-//|  @return color at point P                           |
+//|  @param level of the ray                            |
+//|  @param shade weight (input), weight of the         |
+//|  reflected ray (output)                             |
+//|  @param bit l set if P is shadowed from the light l |
+//|  (null: test the shadows with notShadow())          |
+//|  @param path vertex of P (output)                   |
+//|  @return true if a reflected ray is to be traced    |
 //[]---------------------------------------------------[]
 {
 	Vec3 R; // reflection vector
 	bool calc_R = false; // we haven't calculated the reflection vector yet
 	Vec3 P = makeRayPoint(ray, hit.distance);
-	Vec3 N = hit.object->normal(hit);
+	Vec3 N = getHitNormal(hit);
 	Vec3 V = ray.direction;
 	Material::Surface& surf = hit.object->getMaterial()->surface;
 	REAL dot_NV = N.inner(V);
@@ -263,15 +1775,21 @@ RayTracer::shade(const Ray& ray, IntersectInfo& hit, int level, REAL weight)
 	}
 
 	// start with global ambient
-	Color color = surf.ambient * scene->ambientLight;
+	Color& color = vertex.color;
+
+	color = surf.ambient * scene->ambientLight;
 
 	// compute direct lighting
-	for (LightIterator lit(scene->getLightIterator()); lit;)
+	int l = 0; // light index
+
+	for (LightIterator lit(scene->getLightIterator()); lit; l++)
 	{
 		Light* light = lit++; // light source
 		Vec3 L; // light vector
 		REAL t; // light distance
 
+		if (!light->isOn)
+			continue;
 		light->getVector(P, L, t);
 
 		REAL dot_NL = N.inner(L);
@@ -281,10 +1799,13 @@ RayTracer::shade(const Ray& ray, IntersectInfo& hit, int level, REAL weight)
 		{
 			Ray lightRay(P, L); // light ray
 			IntersectInfo temp = hit;
-			Color shadowColor; // shadow color
+			Color shadowColor = Color::white; // shadow color
+			bool isLit = shadowed != 0 ?
+				(*shadowed & 1 << l) == 0 :
+				notShadow(context, l, lightRay, hit, t, shadowColor);
 
 			// if not shadowed
-			if (notShadow(lightRay, hit, t, shadowColor))
+			if (isLit)
 			{
 				Color I = light->getScaledColor(t); // light color
 
@@ -311,29 +1832,36 @@ RayTracer::shade(const Ray& ray, IntersectInfo& hit, int level, REAL weight)
 	if (surf.specular != Color::black)
 	{
 		weight *= maxRGB(surf.specular);
-		if (weight > minWeight && (level < maxRecursionLevel))
+		if (weight <= minWeight)
+			COUNT_STATISTIC(MinWeightTerminations, 1);
+		else if (level >= maxRecursionLevel)
+			COUNT_STATISTIC(MaxLevelTerminations, 1);
+		else
 		{
 			if (!calc_R)
 				R = getReflectDir(V, N, dot_NV);
-
-			Ray reflectedRay(P + R * EPS, R); // reflection ray
-			Color reflectedColor; // reflection color
-
-			// trace reflection color
-			trace(reflectedRay, reflectedColor, level + 1, weight);
-			color += surf.specular * reflectedColor;
+			// spawn reflection ray
+			vertex.specular = surf.specular;
+			vertex.ray.set(P + R * EPS, R);
+			context.rayCounts.secondary++;
+			context.tree.flags |= DirtyRegion::Reflected;
+			return true;
 		}
 	}
-	return color;
+	return false;
 }
 
 bool
-RayTracer::notShadow(const Ray& ray,
+RayTracer::notShadow(Context& context,
+	int light,
+	const Ray& ray,
 	IntersectInfo& hit,
 	REAL maxDistance,
 	Color& color)
 //[]---------------------------------------------------[]
 //|  Verifiy if ray is not a shadow ray                 |
+//|  @param render context                              |
+//|  @param index of the light                          |
 //|  @param the ray (input)                             |
 //|  @param information on intersection (input)         |
 //|  @param background distance                         |
@@ -343,9 +1871,143 @@ RayTracer::notShadow(const Ray& ray,
 	color = Color::black;
 
 	Ray shadowRay(ray.origin + ray.direction * EPS, ray.direction);
-	IntersectInfo temp;
+	OccluderCache* cache = context.occluderCache;
 
-	if (intersect(shadowRay, temp, maxDistance))
-		return false;
+	context.rayCounts.shadow++;
+
+	Actor* occluder;
+
+	if (cache == 0)
+	{
+		if (occluded(shadowRay, maxDistance, &occluder, 0))
+		{
+			context.tree.touch(occluder->getModel());
+			return false;
+		}
+	}
+	else
+	{
+		// try the last occluder of the light first
+		if (cache->occluded(light, shadowRay, maxDistance))
+		{
+			context.tree.touch(cache->get(light)->getModel());
+			return false;
+		}
+		if (occluded(shadowRay, maxDistance, &occluder, cache->get(light)))
+		{
+			cache->set(light, occluder);
+			context.tree.touch(occluder->getModel());
+			return false;
+		}
+	}
 	color = Color::white; return true;
 }
+
+void
+RayTracer::notShadow(Context& context,
+	const RayPacket& packet,
+	PacketHit& hit,
+	int mask,
+	int* shadowed)
+//[]---------------------------------------------------[]
+//|  Trace the shadow rays of a packet                  |
+//|  @param render context                              |
+//|  @param the ray packet (input)                      |
+//|  @param information on intersections (input)        |
+//|  @param mask of the lanes which hit an object       |
+//|  @param bit l of shadowed[k] is set if the hit of   |
+//|  the lane k is shadowed from the light l (output)   |
+//|                                                     |
+//|  One packet per light holds the shadow rays of the  |
+//|  lanes whose hits are not backfaced to the light.   |
+//[]---------------------------------------------------[]
+{
+	Vec3 P[RAY_PACKET_SIZE];
+	Vec3 N[RAY_PACKET_SIZE];
+
+	for (int k = 0; k < RAY_PACKET_SIZE; k++)
+	{
+		shadowed[k] = 0;
+		if ((mask & 1 << k) == 0)
+			continue;
+		P[k] = makeRayPoint(packet.rays[k], hit.info[k].distance);
+		N[k] = getHitNormal(hit.info[k]);
+		// make sure "real" normal is on right side
+		if (Math::isPositive(N[k].inner(packet.rays[k].direction)))
+			N[k].negate();
+	}
+
+	int l = 0; // light index
+
+	for (LightIterator lit(scene->getLightIterator()); lit; l++)
+	{
+		Light* light = lit++; // light source
+		RayPacket shadowPacket;
+		Real4 maxDistance;
+
+		if (!light->isOn)
+			continue;
+		for (int k = 0; k < RAY_PACKET_SIZE; k++)
+		{
+			Vec3 L; // light vector
+			REAL t; // light distance
+
+			if ((mask & 1 << k) == 0)
+				continue;
+			light->getVector(P[k], L, t);
+			// if not backfaced
+			if (Math::isPositive(N[k].inner(L)))
+			{
+				shadowPacket.set(k, Ray(P[k] + L * EPS, L));
+				maxDistance.set(k, t);
+			}
+		}
+		if (shadowPacket.active == 0)
+			continue;
+		shadowPacket.pad();
+
+		int blocked = traceShadows(context, l, shadowPacket, maxDistance);
+
+		for (int k = 0; k < RAY_PACKET_SIZE; k++)
+			if (blocked & 1 << k)
+				shadowed[k] |= 1 << l;
+	}
+}
+
+int
+RayTracer::traceShadows(Context& context,
+	int light,
+	RayPacket& packet,
+	const Real4& maxDistance)
+//[]---------------------------------------------------[]
+//|  Trace a packet of shadow rays toward a light       |
+//|  @param render context                              |
+//|  @param index of the light                          |
+//|  @param the shadow rays (padded; the active lanes   |
+//|  are changed)                                       |
+//|  @param light distances                             |
+//|  @return mask of the lanes which are blocked        |
+//[]---------------------------------------------------[]
+{
+	OccluderCache* cache = context.occluderCache;
+
+	context.rayCounts.shadow += countLanes(packet.active);
+	if (cache == 0)
+		return occluded(packet, maxDistance, 0, 0);
+
+	Actor* occluder;
+	// try the last occluder of the light first
+	int blocked = cache->occluded(light, packet, packet.active, maxDistance);
+
+	if ((packet.active &= ~blocked) != 0)
+	{
+		int others = occluded(packet, maxDistance, &occluder, cache->get(light));
+
+		if (others != 0)
+		{
+			cache->set(light, occluder);
+			blocked |= others;
+		}
+	}
+	return blocked;
+}
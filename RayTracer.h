@@ -15,51 +15,360 @@
 //  ========
 //  Class definition for simple ray tracer.
 
+#ifndef __Accelerator_h
+#include "Accelerator.h"
+#endif
+#ifndef __DirtyRegion_h
+#include "DirtyRegion.h"
+#endif
+#ifndef __HDRImage_h
+#include "HDRImage.h"
+#endif
 #ifndef __Image_h
 #include "Image.h"
 #endif
+#ifndef __OccluderCache_h
+#include "OccluderCache.h"
+#endif
+#ifndef __RayStack_h
+#include "RayStack.h"
+#endif
 #ifndef __Renderer_h
 #include "Renderer.h"
 #endif
+#ifndef __RenderStatistics_h
+#include "RenderStatistics.h"
+#endif
+#ifndef __ReprojectionCache_h
+#include "ReprojectionCache.h"
+#endif
+#ifndef __Thread_h
+#include "Thread.h"
+#endif
+#ifndef __TileScheduler_h
+#include "TileScheduler.h"
+#endif
+#ifndef __Wavefront_h
+#include "Wavefront.h"
+#endif
 
 namespace Graphics
 { // begin namespace Graphics
 
+#define PROGRESSIVE_STEP 8 // pixel stride of the first progressive pass
+#define ANTIALIASING_BATCH 4 // samples added at a time to an edge pixel
+
 
 //////////////////////////////////////////////////////////
 //
 // RayTracer: simple ray tracer class
 // =========
+//
+// renderImage() is reentrant: any number of threads may render
+// images of the scene at the same time, each one seen by its own
+// camera, with no other state shared by the renders than the scene
+// accelerator (a BVH, unless set otherwise), built by the first of
+// them after the scene has changed. The statistics reported are the
+// ones of the last render finished. The last frame kept by the
+// reprojection cache is used by one render at a time; the renders
+// running meanwhile trace all their pixels. The scene, the cameras
+// and the settings of the ray tracer must not be changed while
+// rendering.
 class RayTracer: public Renderer
 {
 public:
+	// Numbers of rays traced by kind
+	struct RayCounts
+	{
+		long primary; // pixel rays
+		long secondary; // reflected rays
+		long shadow; // shadow rays
+
+		// Constructor
+		RayCounts():
+			primary(0),
+			secondary(0),
+			shadow(0)
+		{
+			// do nothing
+		}
+
+		long getTotal() const
+		{
+			return primary + secondary + shadow;
+		}
+
+		RayCounts& operator +=(const RayCounts& c)
+		{
+			primary += c.primary;
+			secondary += c.secondary;
+			shadow += c.shadow;
+			return *this;
+		}
+
+	}; // RayCounts
+
 	// Constructor
 	RayTracer(Scene&, Camera* = 0);
 
+	// Destructor
+	~RayTracer();
+
 	int getMaxRecursionLevel() const;
 	REAL getMinWeight() const;
+	int getNumberOfThreads() const;
+	int getTileSize() const;
+	bool getPacketTracing() const;
+	bool getWavefrontTracing() const;
+	bool getOccluderCaching() const;
+	int getMaxSamples() const;
+	REAL getContrastThreshold() const;
+	const ToneMap& getToneMap() const;
+	bool getReprojection() const;
+	bool getDirtyRegions() const;
+	REAL getRebuildThreshold() const;
+	Accelerator::Type getAcceleratorType() const;
 
 	void setMaxRecursionLevel(int);
 	void setMinWeight(REAL);
+	void setNumberOfThreads(int);
+	void setTileSize(int);
+	void setPacketTracing(bool);
+	void setWavefrontTracing(bool);
+	void setOccluderCaching(bool);
+	void setMaxSamples(int);
+	void setContrastThreshold(REAL);
+	void setToneMap(const ToneMap&);
+	void setReprojection(bool);
+	void setDirtyRegions(bool);
+	void setRebuildThreshold(REAL);
+	void setAcceleratorType(Accelerator::Type);
+
+	// Shadow occluder cache statistics of the last rendered image
+	const OccluderCache::Statistics& getOccluderCacheStatistics() const;
+	// Reprojection statistics of the last rendered image
+	ReprojectionCache::Statistics getReprojectionStatistics() const;
+	// Dirty region statistics of the last rendered image
+	DirtyRegion::Statistics getDirtyRegionStatistics() const;
+	// Wavefront stage timing of the last rendered image (summed over
+	// the threads)
+	const Wavefront::Statistics& getWavefrontStatistics() const;
+	// Build and refit statistics of the scene accelerator
+	const Accelerator::Statistics& getAcceleratorStatistics() const;
+	// Numbers of rays traced for the last rendered image
+	const RayCounts& getRayCounts() const;
+	// Hot path statistics of the last rendered image (all zero unless
+	// compiled with __RENDER_STATISTICS)
+	const RenderStatistics& getStatistics() const;
+	void printStatistics() const;
 
 	void render();
 	virtual void renderImage(Image&);
+	virtual void renderImage(Image&, const Camera&);
+
+	// Progressive rendering: startImage() begins an image which is
+	// then rendered by successive calls to refineImage(), first with
+	// one ray per PROGRESSIVE_STEP x PROGRESSIVE_STEP block of pixels
+	// and then pass by pass, halving the block size, up to one ray per
+	// pixel, followed by the antialiasing pass, if any. Calling
+	// startImage() again restarts the rendering.
+	//
+	// With reprojection on, the samples of the last complete image
+	// are reprojected into the next one, as seen by the camera of the
+	// latter, and only the remaining pixels are traced (then at full
+	// resolution from the start, when rendering progressively). The
+	// reprojected pixels keep their colors, so highlights lag behind
+	// a moving camera; reflective surfaces are always traced again.
+	// Any change of the scene or of the image size discards the last
+	// image.
+	//
+	// With dirty regions on, an image of a changed scene seen by an
+	// unchanged camera is rendered by tracing again, at full
+	// resolution, only the pixels of the last complete image which the
+	// changes logged by the scene may have affected: the ones covered
+	// by the projected bounds of the changed actors, the ones whose
+	// ray trees touched the changed models, the reflective ones if some
+	// model was shown, and the ones whose primary hits may have their
+	// shadows cast or uncast. Changes not logged by the scene discard
+	// the last image; changes of the settings of the ray tracer are not
+	// tracked (turning dirty regions off and on discards it).
+	void startImage(Image&);
+	bool refineImage(double);
+	void stopImage();
+
+	// Abort the images being rendered, either by renderImage() or
+	// progressively; may be called by any thread
+	void abortImage()
+	{
+		atomicIncrement(aborts);
+	}
+
+	bool isRefining() const
+	{
+		return progressiveImage != 0;
+	}
+
+	// Get the block size of the current progressive pass
+	int getProgressiveStep() const
+	{
+		return progressiveContext.step;
+	}
 
 protected:
-	Ray pixelRay;
+	//
+	// Per-render context: camera, image size, view basis and mapping
+	// parameters computed once per renderImage() call, the tiling and
+	// pass of the scan, and the pixel ray, the ray counts, the
+	// statistics, the shadow occluder cache (null if caching is off)
+	// and the ray evaluation stack of the thread using it. Each scan
+	// worker owns a copy of the context and its own cache and stack.
+	// All the state of a render is kept by its contexts, hence renders
+	// do not interfere with each other.
+	// A scan pass shoots one ray per step x step block of pixels; a
+	// refinement pass skips the blocks whose rays were shot by the
+	// previous pass, that is, the ones at even multiples of step.
+	// An antialiasing pass reads the pixels of a complete one ray per
+	// pixel frame and supersamples the ones differing from their
+	// neighbors by more than the contrast threshold. The tiles of the
+	// last pass of a render are resolved and written to the output
+	// image by the workers as they finish them, if the image can
+	// write tiles.
+	//
+	struct Context
+	{
+		const Camera* camera;
+		int W;
+		int H;
+		int aborts; // number of aborts requested before the render
+		bool frames; // are the caches of the last frame taken?
+		Vec3 VRC_u;
+		Vec3 VRC_v;
+		Vec3 VRC_n;
+		REAL VW_h;
+		REAL VW_w;
+		REAL II_h;
+		REAL II_w;
+		int tileSize;
+		int step;
+		bool refining;
+		const Pixel* aliased; // frame read by an antialiasing pass
+		Image* output; // image written tile by tile (or null)
+		// samples of the pixels traced are recorded (if not null)
+		ReprojectionCache* reprojectionCache;
+		// ray trees of the pixels traced are recorded (if not null)
+		DirtyRegion* dirtyRegion;
+		// points and objects hit by the last pixel rays shot, one per
+		// packet lane
+		ReprojectionCache::Sample primaryHits[RAY_PACKET_SIZE];
+		// summaries of the ray tree being traced and of the trees of the
+		// last pixel rays shot, one per packet lane
+		DirtyRegion::Tree tree;
+		DirtyRegion::Tree pixelTrees[RAY_PACKET_SIZE];
+		Ray pixelRay;
+		RayCounts rayCounts;
+		RenderStatistics statistics;
+		OccluderCache* occluderCache;
+		OccluderCache::Statistics occluderCacheStatistics;
+		RayStack* rayStack;
+		// wavefront buffers of the scan worker (null if tracing depth
+		// first)
+		Wavefront* wavefront;
+		Wavefront::Statistics wavefrontStatistics;
+
+	}; // Context
+
 	int maxRecursionLevel;
 	REAL minWeight;
+	int numberOfThreads;
+	int tileSize;
+	bool packetTracing;
+	bool wavefrontTracing;
+	bool occluderCaching;
+	int maxSamples;
+	REAL contrastThreshold;
+	REAL rebuildThreshold;
+	ToneMap toneMap;
+	ReprojectionCache* reprojectionCache;
+	DirtyRegion* dirtyRegion;
+	Accelerator* accelerator;
+	OccluderCache::Statistics occluderCacheStatistics;
+	Wavefront::Statistics wavefrontStatistics;
+	RayCounts rayCounts;
+	RenderStatistics statistics;
+	Image* progressiveImage;
+	Context progressiveContext;
+	HDRImage* progressiveFrame;
+	Pixel* progressiveAliased;
+	int progressiveRow;
+	volatile int aborts;
 
-	virtual void scan(Image&);
-	virtual void setPixelRay(REAL, REAL);
-	virtual REAL trace(const Ray&, Color&, int, REAL);
+	virtual void scan(Context&, Image&);
+	virtual void scanTile(Context&, const Tile&, HDRImage&);
+	virtual void antialiasTile(Context&, const Tile&, HDRImage&);
+	virtual void wavefrontTile(Context&, const Tile&, HDRImage&);
+	virtual void traceWave(Context&, Wavefront&);
+	virtual void setPixelRay(Context&, REAL, REAL);
+	virtual REAL trace(Context&, const Ray&, Color&, int, REAL);
 	virtual bool intersect(const Ray&, IntersectInfo&, REAL);
-	virtual bool notShadow(const Ray&, IntersectInfo&, REAL, Color&);
+	virtual int intersect(const RayPacket&, PacketHit&, const Real4&);
+	virtual bool occluded(const Ray&, REAL, Actor**, const Actor*);
+	virtual int occluded(const RayPacket&, const Real4&, Actor**, const Actor*);
+	virtual bool notShadow(Context&, int, const Ray&, IntersectInfo&, REAL, Color&);
+	virtual void notShadow(Context&, const RayPacket&, PacketHit&, int, int*);
 
-	virtual Color shoot(REAL, REAL);
-	virtual Color shade(const Ray&, IntersectInfo&, int, REAL);
+	virtual Color shoot(Context&, REAL, REAL);
+	virtual void shoot(Context&, RayPacket&, Color*);
+	virtual Color evaluate(Context&,
+		const Ray&,
+		IntersectInfo&,
+		int,
+		REAL,
+		const int*);
+	virtual bool shade(Context&,
+		const Ray&,
+		IntersectInfo&,
+		int,
+		REAL&,
+		const int*,
+		RayStack::Vertex&);
 	virtual Color background() const;
 
+private:
+	class ScanWorker;
+
+	Scene* acceleratorScene;
+	uint acceleratorTimestamp;
+	mutable Mutex lock; // guards the accelerator build, statistics and caches
+	bool framesInUse; // are the caches of the last frame in use?
+
+	bool isAborted(const Context& context) const
+	{
+		return aborts != context.aborts;
+	}
+
+	void initContext(Context&, Image&, const Camera&);
+	void updateAccelerator();
+	void publishStatistics(const Context&);
+	void releaseFrames(Context&);
+	void parallelScan(Context&, Image&, int);
+	void scanRows(Context&, HDRImage&, int, int, int);
+	bool isScanned(const Context&, int, int) const;
+	void setBlock(Context&,
+		int,
+		int,
+		int,
+		int,
+		const Color&,
+		ReprojectionCache::Sample&,
+		DirtyRegion::Tree&,
+		HDRImage&);
+	int traceShadows(Context&, int, RayPacket&, const Real4&);
+	void intersectWave(Wavefront&, int);
+	void shadowWave(Context&, Wavefront&, int);
+	bool isEdge(const Context&, int, int, int) const;
+	bool reproject(Context&, HDRImage&);
+	bool markDirty(Context&);
+
 }; // RayTracer
 
 
@@ -91,6 +400,214 @@ RayTracer::setMaxRecursionLevel(int maxRecursionLevel)
 	this->maxRecursionLevel = maxRecursionLevel;
 }
 
+inline int
+RayTracer::getNumberOfThreads() const
+{
+	return numberOfThreads;
+}
+
+inline void
+RayTracer::setNumberOfThreads(int numberOfThreads)
+{
+	this->numberOfThreads = numberOfThreads > 0 ? numberOfThreads : 0;
+}
+
+inline int
+RayTracer::getTileSize() const
+{
+	return tileSize;
+}
+
+inline void
+RayTracer::setTileSize(int tileSize)
+{
+	this->tileSize = tileSize > 0 ? tileSize : 1;
+}
+
+inline bool
+RayTracer::getPacketTracing() const
+{
+	return packetTracing;
+}
+
+inline void
+RayTracer::setPacketTracing(bool packetTracing)
+{
+	this->packetTracing = packetTracing;
+}
+
+inline bool
+RayTracer::getWavefrontTracing() const
+{
+	return wavefrontTracing;
+}
+
+inline void
+RayTracer::setWavefrontTracing(bool wavefrontTracing)
+{
+	this->wavefrontTracing = wavefrontTracing;
+}
+
+inline bool
+RayTracer::getOccluderCaching() const
+{
+	return occluderCaching;
+}
+
+inline void
+RayTracer::setOccluderCaching(bool occluderCaching)
+{
+	this->occluderCaching = occluderCaching;
+}
+
+inline int
+RayTracer::getMaxSamples() const
+{
+	return maxSamples;
+}
+
+inline void
+RayTracer::setMaxSamples(int maxSamples)
+{
+	this->maxSamples = maxSamples > 1 ? maxSamples : 1;
+}
+
+inline REAL
+RayTracer::getContrastThreshold() const
+{
+	return contrastThreshold;
+}
+
+inline void
+RayTracer::setContrastThreshold(REAL contrastThreshold)
+{
+	this->contrastThreshold = contrastThreshold;
+}
+
+inline const ToneMap&
+RayTracer::getToneMap() const
+{
+	return toneMap;
+}
+
+inline void
+RayTracer::setToneMap(const ToneMap& toneMap)
+{
+	this->toneMap = toneMap;
+}
+
+inline bool
+RayTracer::getReprojection() const
+{
+	return reprojectionCache != 0;
+}
+
+inline void
+RayTracer::setReprojection(bool reprojection)
+{
+	if (!reprojection)
+	{
+		delete reprojectionCache;
+		reprojectionCache = 0;
+	}
+	else if (reprojectionCache == 0)
+		reprojectionCache = new ReprojectionCache();
+}
+
+inline ReprojectionCache::Statistics
+RayTracer::getReprojectionStatistics() const
+{
+	return reprojectionCache != 0 ?
+		reprojectionCache->getStatistics() :
+		ReprojectionCache::Statistics();
+}
+
+inline bool
+RayTracer::getDirtyRegions() const
+{
+	return dirtyRegion != 0;
+}
+
+inline void
+RayTracer::setDirtyRegions(bool dirtyRegions)
+{
+	if (!dirtyRegions)
+	{
+		delete dirtyRegion;
+		dirtyRegion = 0;
+	}
+	else if (dirtyRegion == 0)
+		dirtyRegion = new DirtyRegion();
+}
+
+inline REAL
+RayTracer::getRebuildThreshold() const
+{
+	return rebuildThreshold;
+}
+
+inline void
+RayTracer::setRebuildThreshold(REAL rebuildThreshold)
+{
+	this->rebuildThreshold = rebuildThreshold;
+}
+
+inline Accelerator::Type
+RayTracer::getAcceleratorType() const
+{
+	return accelerator->getType();
+}
+
+inline void
+RayTracer::setAcceleratorType(Accelerator::Type type)
+{
+	if (type != accelerator->getType())
+	{
+		delete accelerator;
+		accelerator = Accelerator::create(type);
+		// built by the next render
+		acceleratorScene = 0;
+	}
+}
+
+inline DirtyRegion::Statistics
+RayTracer::getDirtyRegionStatistics() const
+{
+	return dirtyRegion != 0 ?
+		dirtyRegion->getStatistics() :
+		DirtyRegion::Statistics();
+}
+
+inline const OccluderCache::Statistics&
+RayTracer::getOccluderCacheStatistics() const
+{
+	return occluderCacheStatistics;
+}
+
+inline const Wavefront::Statistics&
+RayTracer::getWavefrontStatistics() const
+{
+	return wavefrontStatistics;
+}
+
+inline const Accelerator::Statistics&
+RayTracer::getAcceleratorStatistics() const
+{
+	return accelerator->getStatistics();
+}
+
+inline const RayTracer::RayCounts&
+RayTracer::getRayCounts() const
+{
+	return rayCounts;
+}
+
+inline const RenderStatistics&
+RayTracer::getStatistics() const
+{
+	return statistics;
+}
+
 } // end namespace Graphics
 
 #endif // __RayTracer_h
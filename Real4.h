@@ -0,0 +1,304 @@
+#ifndef __Real4_h
+#define __Real4_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                        GVSG Foundation Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+// OVERVIEW: Real4.h
+// ========
+// Class definition for 4-wide SIMD vector of reals.
+
+#ifndef __Real_h
+#include "Real.h"
+#endif
+
+//
+// SSE is used only if REAL is float; otherwise Real4 falls back to
+// plain arrays of four REALs.
+//
+#if !defined(__DOUBLE_FP) && \
+	(defined(__SSE__) || defined(_M_X64) || _M_IX86_FP >= 1)
+#define __SIMD_SSE
+#include <xmmintrin.h>
+#if defined(__SSE2__) || defined(_M_X64) || _M_IX86_FP >= 2
+#define __SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+
+//////////////////////////////////////////////////////////
+//
+// Real4: 4-wide SIMD vector of reals class
+// =====
+//
+// Comparison operators return lane masks to be used with select(),
+// the bitwise operators and getMask(). With SSE, a mask lane has all
+// bits set; in the scalar fallback, it holds -1 (set) or 0 (clear).
+// The bitwise operators are meant to be applied to masks only.
+class Real4
+{
+public:
+	// Constructors
+	Real4()
+	{
+		// do nothing
+	}
+	Real4(REAL s)
+	{
+#ifdef __SIMD_SSE
+		v = _mm_set1_ps(s);
+#else
+		r[0] = r[1] = r[2] = r[3] = s;
+#endif
+	}
+	Real4(REAL a, REAL b, REAL c, REAL d)
+	{
+#ifdef __SIMD_SSE
+		v = _mm_setr_ps(a, b, c, d);
+#else
+		r[0] = a;
+		r[1] = b;
+		r[2] = c;
+		r[3] = d;
+#endif
+	}
+
+	REAL operator [](int i) const
+	{
+		return r[i];
+	}
+
+	void set(int i, REAL s)
+	{
+		r[i] = s;
+	}
+
+	// Get a bit mask with a bit per set lane
+	int getMask() const
+	{
+#ifdef __SIMD_SSE
+		return _mm_movemask_ps(v);
+#else
+		return (r[0] < 0) | (r[1] < 0) << 1 | (r[2] < 0) << 2 | (r[3] < 0) << 3;
+#endif
+	}
+
+#ifdef __SIMD_SSE
+#define REAL4_OP(op, sse) \
+	Real4 operator op(const Real4& b) const \
+	{ \
+		return Real4(sse(v, b.v)); \
+	}
+#else
+#define REAL4_OP(op, sse) \
+	Real4 operator op(const Real4& b) const \
+	{ \
+		Real4 c; \
+		for (int i = 0; i < 4; i++) \
+			c.r[i] = r[i] op b.r[i]; \
+		return c; \
+	}
+#endif
+
+	REAL4_OP(+, _mm_add_ps)
+	REAL4_OP(-, _mm_sub_ps)
+	REAL4_OP(*, _mm_mul_ps)
+	REAL4_OP(/, _mm_div_ps)
+
+#undef REAL4_OP
+
+#ifdef __SIMD_SSE
+#define REAL4_CMP(op, sse) \
+	Real4 operator op(const Real4& b) const \
+	{ \
+		return Real4(sse(v, b.v)); \
+	}
+#else
+#define REAL4_CMP(op, sse) \
+	Real4 operator op(const Real4& b) const \
+	{ \
+		Real4 c; \
+		for (int i = 0; i < 4; i++) \
+			c.r[i] = r[i] op b.r[i] ? -1 : 0; \
+		return c; \
+	}
+#endif
+
+	REAL4_CMP(<, _mm_cmplt_ps)
+	REAL4_CMP(<=, _mm_cmple_ps)
+	REAL4_CMP(>, _mm_cmpgt_ps)
+	REAL4_CMP(>=, _mm_cmpge_ps)
+	REAL4_CMP(==, _mm_cmpeq_ps)
+	REAL4_CMP(!=, _mm_cmpneq_ps)
+
+#undef REAL4_CMP
+
+	Real4 operator &(const Real4& b) const
+	{
+#ifdef __SIMD_SSE
+		return Real4(_mm_and_ps(v, b.v));
+#else
+		return bitwise(b, 0);
+#endif
+	}
+
+	Real4 operator |(const Real4& b) const
+	{
+#ifdef __SIMD_SSE
+		return Real4(_mm_or_ps(v, b.v));
+#else
+		return bitwise(b, 1);
+#endif
+	}
+
+	Real4 operator -() const
+	{
+		return Real4(0) - *this;
+	}
+
+	friend Real4 min(const Real4& a, const Real4& b)
+	{
+#ifdef __SIMD_SSE
+		return Real4(_mm_min_ps(a.v, b.v));
+#else
+		return Real4(Math::min<REAL>(a.r[0], b.r[0]),
+			Math::min<REAL>(a.r[1], b.r[1]),
+			Math::min<REAL>(a.r[2], b.r[2]),
+			Math::min<REAL>(a.r[3], b.r[3]));
+#endif
+	}
+
+	friend Real4 max(const Real4& a, const Real4& b)
+	{
+#ifdef __SIMD_SSE
+		return Real4(_mm_max_ps(a.v, b.v));
+#else
+		return Real4(Math::max<REAL>(a.r[0], b.r[0]),
+			Math::max<REAL>(a.r[1], b.r[1]),
+			Math::max<REAL>(a.r[2], b.r[2]),
+			Math::max<REAL>(a.r[3], b.r[3]));
+#endif
+	}
+
+	friend Real4 sqrt(const Real4& a)
+	{
+#ifdef __SIMD_SSE
+		return Real4(_mm_sqrt_ps(a.v));
+#else
+		return Real4(::sqrt(a.r[0]),
+			::sqrt(a.r[1]),
+			::sqrt(a.r[2]),
+			::sqrt(a.r[3]));
+#endif
+	}
+
+	// Select a where mask is set and b elsewhere
+	friend Real4 select(const Real4& mask, const Real4& a, const Real4& b)
+	{
+#ifdef __SIMD_SSE
+		return Real4(_mm_or_ps(_mm_and_ps(mask.v, a.v),
+			_mm_andnot_ps(mask.v, b.v)));
+#else
+		Real4 c;
+
+		for (int i = 0; i < 4; i++)
+			c.r[i] = mask.r[i] < 0 ? a.r[i] : b.r[i];
+		return c;
+#endif
+	}
+
+	// Make a vector of four unsigned bytes
+	static Real4 fromBytes(const unsigned char* b)
+	{
+#ifdef __SIMD_SSE2
+		union
+		{
+			int i;
+			unsigned char b[4];
+		} u;
+		__m128i zero = _mm_setzero_si128();
+
+		u.b[0] = b[0];
+		u.b[1] = b[1];
+		u.b[2] = b[2];
+		u.b[3] = b[3];
+
+		__m128i i = _mm_unpacklo_epi8(_mm_cvtsi32_si128(u.i), zero);
+
+		return Real4(_mm_cvtepi32_ps(_mm_unpacklo_epi16(i, zero)));
+#else
+		return Real4(b[0], b[1], b[2], b[3]);
+#endif
+	}
+
+	// Make a lane mask from the low 4 bits of an int
+	static Real4 fromMask(int mask)
+	{
+		Real4 c(0);
+
+		for (int i = 0; i < 4; i++)
+			if (mask & 1 << i)
+				c.r[i] = setLane();
+		return c;
+	}
+
+private:
+	union
+	{
+#ifdef __SIMD_SSE
+		__m128 v;
+#endif
+		REAL r[4];
+	};
+
+#ifdef __SIMD_SSE
+	Real4(__m128 m):
+		v(m)
+	{
+		// do nothing
+	}
+#else
+	Real4 bitwise(const Real4& b, int op) const
+	{
+		Real4 c;
+
+		for (int i = 0; i < 4; i++)
+		{
+			bool x = r[i] < 0;
+			bool y = b.r[i] < 0;
+
+			c.r[i] = (op == 0 ? x && y : x || y) ? -1 : 0;
+		}
+		return c;
+	}
+#endif
+
+	// Value of a set mask lane
+	static REAL setLane()
+	{
+#ifdef __SIMD_SSE
+		union
+		{
+			int i;
+			float f;
+		} u;
+
+		u.i = -1;
+		return u.f;
+#else
+		return -1;
+#endif
+	}
+
+}; // Real4
+
+#endif // __Real4_h
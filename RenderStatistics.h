@@ -0,0 +1,165 @@
+#ifndef __RenderStatistics_h
+#define __RenderStatistics_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: RenderStatistics.h
+//  ========
+//  Class definition for render statistics.
+
+namespace Graphics
+{ // begin namespace Graphics
+
+//
+// The counters are updated only if __RENDER_STATISTICS is defined;
+// otherwise COUNT_STATISTIC() and COUNT_DEPTH() expand to nothing and
+// the statistics of a render are all zero.
+//
+#ifdef __RENDER_STATISTICS
+#define COUNT_STATISTIC(counter, n) \
+	RenderStatistics::count(RenderStatistics::counter, n)
+#define COUNT_DEPTH(level, n) \
+	RenderStatistics::countDepth(level, n)
+#else
+#define COUNT_STATISTIC(counter, n) ((void)0)
+#define COUNT_DEPTH(level, n) ((void)0)
+#endif
+
+#ifdef __LINUX
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL __declspec(thread)
+#endif
+
+#define RENDER_STATISTICS_DEPTHS 32
+
+
+//////////////////////////////////////////////////////////
+//
+// RenderStatistics: render statistics class
+// ================
+//
+// Hot path counters of a render. Each rendering thread counts into
+// its own statistics, made current for the thread by setCurrent(),
+// so that code with no access to the render context (models and
+// BVH traversals) can count without locking. Packet tests count one
+// test per active lane; packet node visits count one visit per node.
+class RenderStatistics
+{
+public:
+	enum Counter
+	{
+		SphereTests,
+		TriangleTests,
+		NodeVisits,
+		PacketNodeVisits,
+		MinWeightTerminations,
+		MaxLevelTerminations,
+		NumberOfCounters
+
+	}; // Counter
+
+	// Constructor
+	RenderStatistics()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		for (int i = 0; i < NumberOfCounters; i++)
+			counters[i] = 0;
+		for (int i = 0; i < RENDER_STATISTICS_DEPTHS; i++)
+			depths[i] = 0;
+	}
+
+	long get(Counter counter) const
+	{
+		return counters[counter];
+	}
+
+	// Get the number of rays traced at a recursion level (the last
+	// level also counts the rays of the deeper ones)
+	long getDepthCount(int level) const
+	{
+		return depths[level];
+	}
+
+	static const char* getName(Counter counter)
+	{
+		static const char* names[] =
+		{
+			"Sphere tests",
+			"Triangle tests",
+			"BVH node visits",
+			"BVH packet node visits",
+			"Min weight terminations",
+			"Max level terminations"
+		};
+
+		return names[counter];
+	}
+
+	RenderStatistics& operator +=(const RenderStatistics& s)
+	{
+		for (int i = 0; i < NumberOfCounters; i++)
+			counters[i] += s.counters[i];
+		for (int i = 0; i < RENDER_STATISTICS_DEPTHS; i++)
+			depths[i] += s.depths[i];
+		return *this;
+	}
+
+	// Get the statistics counted by the calling thread (may be null)
+	static RenderStatistics* getCurrent()
+	{
+		return current();
+	}
+
+	static void setCurrent(RenderStatistics* statistics)
+	{
+		current() = statistics;
+	}
+
+	static void count(Counter counter, long n)
+	{
+		RenderStatistics* s = current();
+
+		if (s != 0)
+			s->counters[counter] += n;
+	}
+
+	static void countDepth(int level, long n)
+	{
+		RenderStatistics* s = current();
+
+		if (s != 0)
+			s->depths[level < RENDER_STATISTICS_DEPTHS ?
+				level :
+				RENDER_STATISTICS_DEPTHS - 1] += n;
+	}
+
+private:
+	long counters[NumberOfCounters];
+	long depths[RENDER_STATISTICS_DEPTHS];
+
+	static RenderStatistics*& current()
+	{
+		static THREAD_LOCAL RenderStatistics* statistics;
+
+		return statistics;
+	}
+
+}; // RenderStatistics
+
+} // end namespace Graphics
+
+#endif // __RenderStatistics_h
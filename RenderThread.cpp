@@ -0,0 +1,261 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: RenderThread.cpp
+//  ========
+//  Source file for background render thread.
+
+#include <string.h>
+
+#ifndef __RenderThread_h
+#include "RenderThread.h"
+#endif
+
+using namespace Graphics;
+
+#define REFINE_TIME 0.05 // seconds between checks of posted views
+
+
+//////////////////////////////////////////////////////////
+//
+// RenderThread::BackBuffer: back buffer class
+// ========================
+//
+// Image written by the ray tracer and read by present(), both under
+// the lock of the render thread. Keeps the range of rows written
+// since the last present().
+class RenderThread::BackBuffer: public Image
+{
+public:
+	// Constructor
+	BackBuffer(Mutex& aLock):
+		lock(aLock),
+		pixels(0),
+		W(0),
+		H(0),
+		firstRow(0),
+		lastRow(-1)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	~BackBuffer()
+	{
+		delete []pixels;
+	}
+
+	void getSize(int& w, int& h) const
+	{
+		w = W;
+		h = H;
+	}
+
+	void write(int j, Pixel pixels[])
+	{
+		ScopedLock guard(lock);
+
+		memcpy(this->pixels + j * W, pixels, W * sizeof(Pixel));
+		if (firstRow > lastRow)
+			firstRow = lastRow = j;
+		else if (j < firstRow)
+			firstRow = j;
+		else if (j > lastRow)
+			lastRow = j;
+	}
+
+	// Resize the buffer (the caller must hold the lock)
+	void resize(int w, int h)
+	{
+		if (w * h != W * H)
+		{
+			delete []pixels;
+			pixels = new Pixel[w * h];
+		}
+		W = w;
+		H = h;
+		firstRow = 0;
+		lastRow = -1;
+	}
+
+	// Copy the rows written since the last copy (the caller must
+	// hold the lock)
+	bool copy(Image& image)
+	{
+		int w;
+		int h;
+
+		image.getSize(w, h);
+		if (firstRow > lastRow || w != W || h != H)
+			return false;
+		for (int j = firstRow; j <= lastRow; j++)
+			image.write(j, pixels + j * W);
+		firstRow = 0;
+		lastRow = -1;
+		return true;
+	}
+
+private:
+	Mutex& lock;
+	Pixel* pixels;
+	int W;
+	int H;
+	int firstRow;
+	int lastRow;
+
+}; // RenderThread::BackBuffer
+
+
+//////////////////////////////////////////////////////////
+//
+// RenderThread implementation
+// ============
+RenderThread::RenderThread(Scene& scene):
+	postedW(0),
+	postedH(0),
+	restart(false),
+	rendering(false),
+	paused(false),
+	busy(false),
+	quit(false)
+//[]---------------------------------------------------[]
+//|  Constructor                                        |
+//[]---------------------------------------------------[]
+{
+	rayTracer = new RayTracer(scene, &camera);
+	backBuffer = new BackBuffer(lock);
+}
+
+RenderThread::~RenderThread()
+//[]---------------------------------------------------[]
+//|  Destructor                                         |
+//[]---------------------------------------------------[]
+{
+	stop();
+	delete backBuffer;
+	delete rayTracer;
+}
+
+void
+RenderThread::postView(const Camera& camera, int w, int h)
+//[]---------------------------------------------------[]
+//|  Post a view to be rendered                         |
+//|  @param the camera (copied)                         |
+//|  @param image width                                 |
+//|  @param image height                                |
+//[]---------------------------------------------------[]
+{
+	ScopedLock guard(lock);
+
+	postedCamera = camera;
+	postedW = w;
+	postedH = h;
+	restart = true;
+	paused = false;
+	rayTracer->abortImage();
+	wakeup.signal();
+}
+
+void
+RenderThread::pause()
+//[]---------------------------------------------------[]
+//|  Abort the frame in flight and wait until the       |
+//|  thread no longer reads the scene                   |
+//[]---------------------------------------------------[]
+{
+	ScopedLock guard(lock);
+
+	paused = true;
+	rayTracer->abortImage();
+	while (busy)
+		idle.wait(lock);
+	restart = rendering = false;
+}
+
+bool
+RenderThread::present(Image& image)
+//[]---------------------------------------------------[]
+//|  Copy the rows rendered since the last call         |
+//|  @param the front image                             |
+//|  @return true if any row has been copied            |
+//[]---------------------------------------------------[]
+{
+	ScopedLock guard(lock);
+
+	return backBuffer->copy(image);
+}
+
+bool
+RenderThread::isRendering() const
+//[]---------------------------------------------------[]
+//|  Is there a frame being (or to be) rendered?        |
+//[]---------------------------------------------------[]
+{
+	ScopedLock guard(lock);
+
+	return restart || rendering;
+}
+
+void
+RenderThread::stop()
+//[]---------------------------------------------------[]
+//|  Abort the frame in flight and finish the thread    |
+//[]---------------------------------------------------[]
+{
+	{
+		ScopedLock guard(lock);
+
+		quit = true;
+		rayTracer->abortImage();
+		wakeup.signal();
+	}
+	join();
+}
+
+void
+RenderThread::run()
+//[]---------------------------------------------------[]
+//|  Thread body                                        |
+//[]---------------------------------------------------[]
+{
+	for (;;)
+	{
+		bool start = false;
+
+		{
+			ScopedLock guard(lock);
+
+			busy = false;
+			idle.broadcast();
+			while (!quit && (paused || (!restart && !rendering)))
+				wakeup.wait(lock);
+			if (quit)
+				return;
+			busy = true;
+			if (restart)
+			{
+				camera = postedCamera;
+				backBuffer->resize(postedW, postedH);
+				restart = false;
+				rendering = start = true;
+			}
+		}
+		// the scene BVH may be built here, so do not hold the lock
+		if (start)
+			rayTracer->startImage(*backBuffer);
+		if (rayTracer->refineImage(REFINE_TIME))
+		{
+			ScopedLock guard(lock);
+
+			rendering = false;
+		}
+	}
+}
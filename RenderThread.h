@@ -0,0 +1,91 @@
+#ifndef __RenderThread_h
+#define __RenderThread_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: RenderThread.h
+//  ========
+//  Class definition for background render thread.
+
+#ifndef __RayTracer_h
+#include "RayTracer.h"
+#endif
+#ifndef __Thread_h
+#include "Thread.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// RenderThread: background render thread class
+// ============
+//
+// Ray traces the views posted by postView() into a back buffer,
+// progressively and on its own thread (plus the tile workers of its
+// ray tracer). The rows of the back buffer written since the last
+// call to present() are copied by present() into a front image, so
+// that the thread presenting the frames never waits for the ray
+// tracer. Posting a view aborts the frame in flight and restarts the
+// rendering with a copy of the posted camera, hence the caller may
+// keep changing its camera meanwhile. The scene must not be changed
+// while the thread is running, unless paused by pause(); the next
+// posted view resumes the rendering.
+class RenderThread: public Thread
+{
+public:
+	// Constructor
+	RenderThread(Scene&);
+
+	// Destructor
+	~RenderThread();
+
+	// Get the ray tracer (to be set up before the thread is started)
+	RayTracer& getRayTracer()
+	{
+		return *rayTracer;
+	}
+
+	void postView(const Camera&, int, int);
+	void pause();
+	bool present(Image&);
+	bool isRendering() const;
+	void stop();
+
+protected:
+	void run();
+
+private:
+	class BackBuffer;
+
+	mutable Mutex lock;
+	Condition wakeup;
+	Condition idle;
+	Camera camera;
+	Camera postedCamera;
+	int postedW;
+	int postedH;
+	bool restart;
+	bool rendering;
+	bool paused;
+	bool busy;
+	bool quit;
+	RayTracer* rayTracer;
+	BackBuffer* backBuffer;
+
+}; // RenderThread
+
+} // end namespace Graphics
+
+#endif // __RenderThread_h
@@ -44,6 +44,7 @@ Renderer::Renderer(Scene& aScene, Camera* aCamera):
 	// Note: set camera first
 	camera = aCamera != 0 ? aCamera : defaultCamera = new Camera();
 	setScene(aScene);
+	setImageSize(DFL_IMAGE_W, DFL_IMAGE_H);
 	VTM.identity(); invVTM.identity();
 }
 
@@ -119,14 +120,88 @@ Renderer::backToWC(int x, int y) const
 	return viewToWorld(p);
 }
 
-inline Vec3
-Renderer::project(const Vec3& p) const
+Vec3
+Renderer::project(const Camera& camera, int W, int H, const Vec3& p)
 //[]---------------------------------------------------[]
 //|  Project point                                      |
+//|  @param the camera                                  |
+//|  @param image width                                 |
+//|  @param image height                                |
+//|  @param the point (in WC)                           |
+//|  @return CVV coordinates of the projection of the   |
+//|  point onto the view plane (x and y) and its depth  |
+//|  (z) along the direction of projection              |
+//|                                                     |
+//|  The view window has the height of the camera one   |
+//|  and the aspect ratio of the W x H image (the       |
+//|  smaller side of the window gets the camera height, |
+//|  as in the ray tracer).                             |
+//[]---------------------------------------------------[]
+{
+	Vec3 n = camera.getViewPlaneNormal();
+	Vec3 v = camera.getViewUp();
+	Vec3 u = v.cross(n);
+	Vec3 d = p - camera.getPosition();
+	REAL x = d.inner(u);
+	REAL y = d.inner(v);
+	REAL z = -d.inner(n);
+
+	if (camera.getProjectionType() == Camera::Perspective)
+	{
+		REAL s = camera.getDistance() * Math::inverse(z);
+
+		x *= s;
+		y *= s;
+	}
+
+	REAL height = camera.windowHeight();
+	REAL w = W >= H ? height * W / H : height;
+	REAL h = W >= H ? height : height * H / W;
+
+	return Vec3(2 * x / w, 2 * y / h, z);
+}
+
+bool
+Renderer::project(const Camera& camera,
+	int W,
+	int H,
+	const BoundingBox& box,
+	Vec3& p1,
+	Vec3& p2)
+//[]---------------------------------------------------[]
+//|  Project bounding box                               |
+//|  @param the camera                                  |
+//|  @param image width                                 |
+//|  @param image height                                |
+//|  @param the box (in WC)                             |
+//|  @param min corner of the bounds of the projection  |
+//|  of the box (output)                                |
+//|  @param max corner of the bounds of the projection  |
+//|  of the box (output)                                |
+//|  @return false if the box is not in front of the    |
+//|  view plane (then the bounds are not computed)      |
+//|                                                     |
+//|  The bounds are given in the coordinates returned   |
+//|  by project(const Camera&, int, int, const Vec3&).  |
 //[]---------------------------------------------------[]
 {
-	// TODO
-	return Vec3(p.x, p.y, 0);
+	const Vec3& b1 = box.getP1();
+	const Vec3& b2 = box.getP2();
+	bool perspective = camera.getProjectionType() == Camera::Perspective;
+
+	p1.x = p1.y = p1.z = +Math::infinity<REAL>();
+	p2.x = p2.y = p2.z = -Math::infinity<REAL>();
+	for (int i = 0; i < 8; i++)
+	{
+		Vec3 p = project(camera, W, H, Vec3(i & 1 ? b2.x : b1.x,
+			i & 2 ? b2.y : b1.y,
+			i & 4 ? b2.z : b1.z));
+
+		if (perspective && !Math::isPositive(p.z))
+			return false;
+		inflateAABB(p1, p2, p);
+	}
+	return true;
 }
 
 DCPoint
@@ -98,7 +98,24 @@ protected:
 	int H;
 
 	Light* makeDefaultLight() const;
-	Vec3 project(const Vec3&) const;
+
+	static Vec3 project(const Camera&, int, int, const Vec3&);
+	static bool project(const Camera&,
+		int,
+		int,
+		const BoundingBox&,
+		Vec3&,
+		Vec3&);
+
+	Vec3 project(const Vec3& p) const
+	{
+		return project(*camera, W, H, p);
+	}
+
+	bool project(const BoundingBox& box, Vec3& p1, Vec3& p2) const
+	{
+		return project(*camera, W, H, box, p1, p2);
+	}
 
 private:
 	Camera* defaultCamera;
@@ -0,0 +1,269 @@
+#ifndef __ReprojectionCache_h
+#define __ReprojectionCache_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: ReprojectionCache.h
+//  ========
+//  Class definition for reprojection cache.
+
+#include <string.h>
+
+#ifndef __Model_h
+#include "Model.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// ReprojectionCache: reprojection cache class
+// =================
+//
+// Keeps, for each pixel of the last complete frame, the point and
+// the object hit by its primary ray and its color, so that the
+// samples of the frame can be reprojected into the next one, drawn
+// by a moved camera, and only the pixels left uncovered traced. The
+// samples of the frame being rendered are recorded apart from the
+// ones of the previous frame, which are replaced by end(); distinct
+// pixels may be recorded by distinct threads with no locking. The
+// objects are not referenced.
+class ReprojectionCache
+{
+public:
+	struct Sample
+	{
+		Vec3 point; // primary hit point
+		Model* object; // primary hit object (null if none)
+		Color color; // color of the pixel
+
+	}; // Sample
+
+	struct Statistics
+	{
+		long pixels; // number of pixels of the last frame
+		long reprojected; // number of pixels reprojected
+
+		// Constructor
+		Statistics():
+			pixels(0),
+			reprojected(0)
+		{
+			// do nothing
+		}
+
+		REAL getReuseRate() const
+		{
+			return pixels > 0 ? (REAL)reprojected / pixels : 0;
+		}
+
+	}; // Statistics
+
+	// Constructor
+	ReprojectionCache():
+		W(0),
+		H(0),
+		previous(0),
+		current(0),
+		flags(0),
+		depths(0),
+		valid(false),
+		timestamp(0)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	~ReprojectionCache()
+	{
+		release();
+	}
+
+	void begin(int, int);
+	void end(uint);
+
+	void invalidate()
+	{
+		valid = false;
+	}
+
+	// Can the previous frame be reprojected into a w x h frame of a
+	// scene with a given timestamp?
+	bool isValid(int w, int h, uint timestamp) const
+	{
+		return valid && w == W && h == H && timestamp == this->timestamp;
+	}
+
+	const Sample& getPrevious(int k) const
+	{
+		return previous[k];
+	}
+
+	const Sample& getCurrent(int i, int j) const
+	{
+		return current[j * W + i];
+	}
+
+	void set(int i, int j, const Sample& sample)
+	{
+		current[j * W + i] = sample;
+	}
+
+	void cover(int, int, REAL, const Sample&);
+	void trim();
+
+	bool isReprojected(int i, int j) const
+	{
+		return flags[j * W + i] == Reprojected;
+	}
+
+	const Statistics& getStatistics() const
+	{
+		return statistics;
+	}
+
+private:
+	enum
+	{
+		Empty,
+		Covered,
+		Reprojected
+	};
+
+	int W;
+	int H;
+	Sample* previous;
+	Sample* current;
+	uint8* flags;
+	REAL* depths;
+	bool valid;
+	uint timestamp;
+	Statistics statistics;
+
+	void release();
+
+	ReprojectionCache(const ReprojectionCache&);
+	ReprojectionCache& operator =(const ReprojectionCache&);
+
+}; // ReprojectionCache
+
+
+//////////////////////////////////////////////////////////
+//
+// ReprojectionCache inline implementation
+// =================
+inline void
+ReprojectionCache::release()
+//[]---------------------------------------------------[]
+//|  Release the buffers                                |
+//[]---------------------------------------------------[]
+{
+	delete []previous;
+	delete []current;
+	delete []flags;
+	delete []depths;
+	previous = current = 0;
+	flags = 0;
+	depths = 0;
+}
+
+inline void
+ReprojectionCache::begin(int w, int h)
+//[]---------------------------------------------------[]
+//|  Begin a frame, with no pixel reprojected           |
+//|  @param frame width                                 |
+//|  @param frame height                                |
+//[]---------------------------------------------------[]
+{
+	if (w != W || h != H)
+	{
+		release();
+		previous = new Sample[w * h];
+		current = new Sample[w * h];
+		flags = new uint8[w * h];
+		depths = new REAL[w * h];
+		W = w;
+		H = h;
+		valid = false;
+	}
+	memset(flags, Empty, w * h);
+	statistics = Statistics();
+	statistics.pixels = w * h;
+}
+
+inline void
+ReprojectionCache::cover(int i, int j, REAL depth, const Sample& sample)
+//[]---------------------------------------------------[]
+//|  Reproject a sample of the previous frame           |
+//|  @param pixel column of the current frame           |
+//|  @param pixel row of the current frame              |
+//|  @param depth of the sample point                   |
+//|  @param the sample                                  |
+//|                                                     |
+//|  The nearest sample reprojected into a pixel wins.  |
+//[]---------------------------------------------------[]
+{
+	int k = j * W + i;
+
+	if (flags[k] == Empty || depth < depths[k])
+	{
+		flags[k] = Covered;
+		depths[k] = depth;
+		current[k] = sample;
+	}
+}
+
+inline void
+ReprojectionCache::trim()
+//[]---------------------------------------------------[]
+//|  Keep as reprojected only the covered pixels whose  |
+//|  4-neighbors are all covered                        |
+//|                                                     |
+//|  Holes are disocclusions or gaps left by the        |
+//|  magnification of the surfaces; the pixels around   |
+//|  them may show samples seen through the gaps, so    |
+//|  they are traced too.                               |
+//[]---------------------------------------------------[]
+{
+	for (int j = 0; j < H; j++)
+		for (int i = 0, k = j * W; i < W; i++, k++)
+			if (flags[k] != Empty &&
+				(i == 0 || flags[k - 1] != Empty) &&
+				(i == W - 1 || flags[k + 1] != Empty) &&
+				(j == 0 || flags[k - W] != Empty) &&
+				(j == H - 1 || flags[k + W] != Empty))
+			{
+				flags[k] = Reprojected;
+				statistics.reprojected++;
+			}
+}
+
+inline void
+ReprojectionCache::end(uint timestamp)
+//[]---------------------------------------------------[]
+//|  End a complete frame, to be reprojected next       |
+//|  @param timestamp of the scene of the frame         |
+//[]---------------------------------------------------[]
+{
+	Sample* temp = previous;
+
+	previous = current;
+	current = temp;
+	this->timestamp = timestamp;
+	valid = true;
+}
+
+} // end namespace Graphics
+
+#endif // __ReprojectionCache_h
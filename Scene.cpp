@@ -96,7 +96,9 @@ Scene::addActor(Actor* actor)
 		actors.add(actor);
 		actor->scene = this;
 		actor->makeUse();
-		boundingBox.inflate(actor->model->getBoundingBox());
+		boundingBox.inflate(actor->getBoundingBox());
+		timestamp++;
+		addChange(actor->model, actor->getBoundingBox(), true);
 	}
 }
 
@@ -110,7 +112,9 @@ Scene::deleteActor(Actor* actor)
 	{
 		actors.remove(*actor);
 		actor->scene = 0;
+		addChange(actor->model, actor->getBoundingBox(), false);
 		actor->release();
+		timestamp++;
 	}
 }
 
@@ -125,6 +129,7 @@ Scene::addLight(Light* light)
 		lights.add(light);
 		light->scene = this;
 		light->makeUse();
+		setModified(light);
 	}
 }
 
@@ -139,6 +144,7 @@ Scene::deleteLight(Light* light)
 		lights.remove(*light);
 		light->scene = 0;
 		light->release();
+		setModified(light);
 	}
 }
 
@@ -155,6 +161,7 @@ Scene::deleteActors()
 		actor->release();
 	}
 	boundingBox.setEmpty();
+	setModified();
 }
 
 void
@@ -169,6 +176,7 @@ Scene::deleteLights()
 		light->scene = 0;
 		light->release();
 	}
+	globalVersion = ++version;
 }
 
 Actor*
@@ -191,6 +199,57 @@ Scene::computeBoundingBox()
 {
 	boundingBox.setEmpty();
 	for (Actor* actor = actors.peekHead(); actor != 0; actor = actor->next)
-		boundingBox.inflate(actor->model->getBoundingBox());
+		boundingBox.inflate(actor->getBoundingBox());
 	return boundingBox;
 }
+
+void
+Scene::addChange(const Model* model,
+	const BoundingBox& boundingBox,
+	bool appeared)
+//[]---------------------------------------------------[]
+//|  Log an actor change                                |
+//|  @param the actor model                             |
+//|  @param bounds of the actor model in world space    |
+//|  @param can the model be hit where it could not?    |
+//[]---------------------------------------------------[]
+{
+	SceneChange& change = changeLog[++version % SCENE_CHANGE_LOG_SIZE];
+
+	change.boundingBox = boundingBox;
+	change.model = model;
+	change.appeared = appeared;
+}
+
+void
+Scene::setModified(Material* material)
+//[]---------------------------------------------------[]
+//|  Notify that the surface of a material was modified |
+//[]---------------------------------------------------[]
+{
+	for (Actor* actor = actors.peekHead(); actor != 0; actor = actor->next)
+		if (actor->model->getMaterial() == material)
+			addChange(actor->model, actor->getBoundingBox(), false);
+}
+
+int
+Scene::getChanges(uint version, SceneChange changes[]) const
+//[]---------------------------------------------------[]
+//|  Get the actor changes made after a version         |
+//|  @param the version                                 |
+//|  @param the changes, oldest first (output, at most  |
+//|  SCENE_CHANGE_LOG_SIZE)                             |
+//|  @return number of changes, or -1 if the changes    |
+//|  made after the version are not all logged          |
+//[]---------------------------------------------------[]
+{
+	if (globalVersion > version ||
+		this->version - version > SCENE_CHANGE_LOG_SIZE)
+		return -1;
+
+	int n = 0;
+
+	for (uint v = version + 1; v <= this->version; v++)
+		changes[n++] = changeLog[v % SCENE_CHANGE_LOG_SIZE];
+	return n;
+}
@@ -18,18 +18,46 @@
 #ifndef __Actor_h
 #include "Actor.h"
 #endif
+#ifndef __BVH_h
+#include "BVH.h"
+#endif
 #ifndef __Light_h
 #include "Light.h"
 #endif
 
+#define SCENE_CHANGE_LOG_SIZE 32 // number of actor changes kept by a scene
+
 namespace Graphics
 { // begin namespace Graphics
 
 
+//////////////////////////////////////////////////////////
+//
+// SceneChange: actor change record
+// ===========
+struct SceneChange
+{
+	BoundingBox boundingBox; // bounds of the actor model in world space
+	const Model* model; // the actor model (not referenced)
+	bool appeared; // can the model be hit where it could not before?
+
+}; // SceneChange
+
+
 //////////////////////////////////////////////////////////
 //
 // Scene: scene class
 // =====
+//
+// Every change of a scene advances its version. The last
+// SCENE_CHANGE_LOG_SIZE changes of single actors (added, deleted,
+// shown, hidden, moved, given another model or material) are logged, so
+// that a renderer may find out which parts of an image of a former
+// version of the scene are still valid. Changes of the lights, of the
+// geometry of the models or of the scene as a whole are not logged.
+//
+// The BVH options of a scene tell how the BVH of its actors, and of
+// the meshes made for it by SceneGenerator, are built.
 class Scene: public NameableObject
 {
 public:
@@ -41,7 +69,10 @@ public:
 		NameableObject(name),
 		backgroundColor(Color::black),
 		ambientLight(Color::gray),
-		IOR(1)
+		IOR(1),
+		timestamp(0),
+		version(0),
+		globalVersion(0)
 	{
 		// do nothing
 	}
@@ -59,6 +90,18 @@ public:
 		IOR = ior > 0 ? ior : 0;
 	}
 
+	const BVH::BuildOptions& getBVHOptions() const
+	{
+		return bvhOptions;
+	}
+
+	// Set how the BVHs are built (the BVH of the actors is rebuilt)
+	void setBVHOptions(const BVH::BuildOptions& options)
+	{
+		bvhOptions = options;
+		setModified();
+	}
+
 	int getNumberOfActors() const
 	{
 		return actors.size();
@@ -101,15 +144,54 @@ public:
 
 	BoundingBox computeBoundingBox();
 
+	// Get the time of the last change of the actors geometry
+	uint getTimestamp() const
+	{
+		return timestamp;
+	}
+
+	// Get the version of the scene, advanced by any change
+	uint getVersion() const
+	{
+		return version;
+	}
+
+	int getChanges(uint, SceneChange[]) const;
+
+	// Notify that the geometry of the scene actors (or any public
+	// attribute of the scene) was modified
+	void setModified()
+	{
+		timestamp++;
+		globalVersion = ++version;
+	}
+
+	// Notify that a light was modified (lights may change any pixel)
+	void setModified(Light*)
+	{
+		globalVersion = ++version;
+	}
+
+	void setModified(Material*);
+
 protected:
 	BoundingBox boundingBox;
 	REAL IOR;
+	BVH::BuildOptions bvhOptions;
+	uint timestamp;
+	uint version;
+	uint globalVersion; // version of the last change not logged
+	SceneChange changeLog[SCENE_CHANGE_LOG_SIZE];
 	// Scene components
 	Actors actors;
 	Lights lights;
 
+	void addChange(const Model*, const BoundingBox&, bool);
+
 	DECLARE_SERIALIZABLE(Scene);
 
+	friend class Actor;
+
 }; // Scene
 
 } // end namespace Graphics
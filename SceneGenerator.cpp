@@ -0,0 +1,295 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: SceneGenerator.cpp
+//  ========
+//  Source file for synthetic scene generator.
+
+#ifndef __MeshModel_h
+#include "MeshModel.h"
+#endif
+#ifndef __SceneGenerator_h
+#include "SceneGenerator.h"
+#endif
+#ifndef __Sphere_h
+#include "Sphere.h"
+#endif
+#ifndef __Sweeper_h
+#include "Sweeper.h"
+#endif
+
+using namespace Graphics;
+
+//
+// Auxiliary function
+//
+inline REAL
+modelSize(int n)
+{
+	// keep the density of the scene about the same for any n
+	return SCENE_SIZE / (REAL)pow((double)(n > 0 ? n : 1), 1.0 / 3);
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// SceneGenerator implementation
+// ==============
+Scene*
+SceneGenerator::makeScene(const String& name, const Parameters& p)
+//[]---------------------------------------------------[]
+//|  Make scene                                         |
+//|  @param scene name                                  |
+//|  @param scene parameters                            |
+//|  @return a new scene                                |
+//[]---------------------------------------------------[]
+{
+	Scene* scene = new Scene(name);
+
+	scene->setBVHOptions(p.bvhOptions);
+	state = p.seed;
+	addSpheres(*scene, p.numberOfSpheres, p.reflectivity);
+	addMeshSpheres(*scene, p.numberOfMeshSpheres, p.sphereSegments, p.reflectivity);
+	addCylinders(*scene, p.numberOfCylinders, p.cylinderSegments, p.reflectivity);
+	addInstances(*scene,
+		p.numberOfInstances,
+		p.sphereSegments,
+		p.cylinderSegments,
+		p.reflectivity);
+	addLights(*scene, p.numberOfLights);
+	scene->backgroundColor = Color(0.1f, 0.1f, 0.2f);
+	return scene;
+}
+
+Camera*
+SceneGenerator::makeCamera(REAL aspectRatio) const
+//[]---------------------------------------------------[]
+//|  Make a camera looking at the whole scene           |
+//|  @param aspect ratio of the image                   |
+//|  @return a new camera                               |
+//[]---------------------------------------------------[]
+{
+	Camera* camera = new Camera();
+
+	camera->setPosition(Vec3(0, 0, 3 * SCENE_SIZE));
+	camera->setViewAngle(45);
+	camera->setAspectRatio(aspectRatio);
+	camera->updateView();
+	return camera;
+}
+
+Vec3
+SceneGenerator::randomPoint(REAL size)
+//[]---------------------------------------------------[]
+//|  Get a random point in [-size, size]^3              |
+//[]---------------------------------------------------[]
+{
+	REAL x = random(-size, size);
+	REAL y = random(-size, size);
+	REAL z = random(-size, size);
+
+	return Vec3(x, y, z);
+}
+
+Material*
+SceneGenerator::makeMaterial(REAL reflectivity)
+//[]---------------------------------------------------[]
+//|  Make a material of random color                    |
+//|  @param specular color of the material              |
+//[]---------------------------------------------------[]
+{
+	Material* material = MaterialFactory::New();
+	Finish finish;
+	REAL r = random(0.2f, 1);
+	REAL g = random(0.2f, 1);
+	REAL b = random(0.2f, 1);
+
+	finish.shine = 20;
+	finish.spot = 0.5f;
+	finish.specular = Color::white * reflectivity;
+	material->setSurface(Color(r, g, b), finish);
+	return material;
+}
+
+void
+SceneGenerator::addSpheres(Scene& scene, int n, REAL reflectivity)
+//[]---------------------------------------------------[]
+//|  Add spheres                                        |
+//|  @param the scene                                   |
+//|  @param number of spheres                           |
+//|  @param specular color of the spheres               |
+//[]---------------------------------------------------[]
+{
+	REAL size = modelSize(n);
+
+	for (int i = 0; i < n; i++)
+	{
+		Vec3 center = randomPoint(SCENE_SIZE);
+		Primitive* model = new Sphere(center, size * random(0.2f, 0.5f));
+
+		model->setMaterial(makeMaterial(reflectivity));
+		scene.addActor(new Actor(*model));
+	}
+}
+
+void
+SceneGenerator::addMeshSpheres(Scene& scene,
+	int n,
+	int segments,
+	REAL reflectivity)
+//[]---------------------------------------------------[]
+//|  Add spheres tessellated by Sphere::getMesh()       |
+//|  @param the scene                                   |
+//|  @param number of spheres                           |
+//|  @param segments in 180 degrees                     |
+//|  @param specular color of the spheres               |
+//[]---------------------------------------------------[]
+{
+	REAL size = modelSize(n);
+
+	for (int i = 0; i < n; i++)
+	{
+		Vec3 center = randomPoint(SCENE_SIZE);
+		Sphere sphere(center, size * random(0.2f, 0.5f), segments);
+		Primitive* model = new MeshModel(sphere.getMesh(), scene.getBVHOptions());
+
+		model->setMaterial(makeMaterial(reflectivity));
+		scene.addActor(new Actor(*model));
+	}
+}
+
+void
+SceneGenerator::addCylinders(Scene& scene,
+	int n,
+	int segments,
+	REAL reflectivity)
+//[]---------------------------------------------------[]
+//|  Add cylinders made by makeCylinder()               |
+//|  @param the scene                                   |
+//|  @param number of cylinders                         |
+//|  @param segments of the circle of a cylinder        |
+//|  @param specular color of the cylinders             |
+//[]---------------------------------------------------[]
+{
+	REAL size = modelSize(n);
+
+	for (int i = 0; i < n; i++)
+	{
+		Vec3 center = randomPoint(SCENE_SIZE);
+		Vec3 axis = randomPoint(1);
+
+		if (Math::isZero(axis.length()))
+			axis.set(0, 1, 0);
+		axis.normalize();
+
+		// any direction perpendicular to the axis
+		Vec3 u = axis.cross(fabs(axis.x) < 0.9f ?
+			Vec3(1, 0, 0) :
+			Vec3(0, 1, 0)).versor();
+		REAL radius = size * random(0.1f, 0.3f);
+		REAL height = size * random(0.4f, 1);
+		TriangleMesh* mesh = makeCylinder(center,
+			center + u * radius,
+			axis,
+			height,
+			segments);
+		Primitive* model = new MeshModel(mesh, scene.getBVHOptions());
+
+		model->setMaterial(makeMaterial(reflectivity));
+		scene.addActor(new Actor(*model));
+	}
+}
+
+void
+SceneGenerator::addInstances(Scene& scene,
+	int n,
+	int sphereSegments,
+	int cylinderSegments,
+	REAL reflectivity)
+//[]---------------------------------------------------[]
+//|  Add randomly placed, rotated and scaled instances  |
+//|  of a mesh sphere and of a cylinder                 |
+//|  @param the scene                                   |
+//|  @param number of instances                         |
+//|  @param segments in 180 degrees of the sphere       |
+//|  @param segments of the circle of the cylinder      |
+//|  @param specular color of the models                |
+//|                                                     |
+//|  Only the two models are stored; the instances of a |
+//|  model share its material.                          |
+//[]---------------------------------------------------[]
+{
+	if (n <= 0)
+		return;
+
+	Sphere sphere(Vec3(0, 0, 0), 1, sphereSegments);
+	Primitive* models[2];
+
+	models[0] = new MeshModel(sphere.getMesh(), scene.getBVHOptions());
+	models[1] = new MeshModel(makeCylinder(Vec3(0, -1, 0),
+			Vec3(0.5f, -1, 0),
+			Vec3(0, 1, 0),
+			2,
+			cylinderSegments),
+		scene.getBVHOptions());
+	// hold the models until they are used by the actors
+	for (int i = 0; i < 2; i++)
+	{
+		models[i]->makeUse();
+		models[i]->setMaterial(makeMaterial(reflectivity));
+	}
+
+	REAL size = modelSize(n);
+
+	for (int i = 0; i < n; i++)
+	{
+		Vec3 center = randomPoint(SCENE_SIZE);
+		Vec3 axis = randomPoint(1);
+
+		if (Math::isZero(axis.length()))
+			axis.set(0, 1, 0);
+
+		Transf3 t;
+		Transf3 m;
+
+		t.scale(size * random(0.2f, 0.5f));
+		t.compose(m.rotation(axis, Math::toRadians<REAL>(random(0, 360))));
+		t.compose(m.translation(center));
+		scene.addActor(new Actor(*models[i & 1], t));
+	}
+	for (int i = 0; i < 2; i++)
+		models[i]->release();
+}
+
+void
+SceneGenerator::addLights(Scene& scene, int n)
+//[]---------------------------------------------------[]
+//|  Add point lights around the scene                  |
+//|  @param the scene                                   |
+//|  @param number of lights                            |
+//[]---------------------------------------------------[]
+{
+	// each light has 1/sqrt(n) the intensity of a white one, so that
+	// together they are sqrt(n) times as bright as a single white one
+	Color color = Color::white * (REAL)(n > 1 ? 1.0 / sqrt((double)n) : 1);
+
+	for (int i = 0; i < n; i++)
+	{
+		Vec3 p = randomPoint(1);
+
+		if (Math::isZero(p.length()))
+			p.set(0, 0, 1);
+		p.normalize();
+		// keep the lights in front of the scene
+		p.z = fabs(p.z);
+		scene.addLight(new Light(p * (2 * SCENE_SIZE), color));
+	}
+}
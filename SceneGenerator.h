@@ -0,0 +1,115 @@
+#ifndef __SceneGenerator_h
+#define __SceneGenerator_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: SceneGenerator.h
+//  ========
+//  Class definition for synthetic scene generator.
+
+#ifndef __Camera_h
+#include "Camera.h"
+#endif
+#ifndef __Scene_h
+#include "Scene.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+#define SCENE_SIZE 4
+
+
+//////////////////////////////////////////////////////////
+//
+// SceneGenerator: synthetic scene generator class
+// ==============
+//
+// Adds randomly placed models and lights to a scene. Models lie in
+// the cube [-SCENE_SIZE, SCENE_SIZE]^3 and lights around it. The
+// generator uses its own pseudo-random sequence, hence scenes made
+// from the same seed are the same on every platform. The BVHs of the
+// meshes are built with the BVH options of the scene.
+class SceneGenerator
+{
+public:
+	// Parameters of a scene
+	struct Parameters
+	{
+		int numberOfSpheres; // analytic spheres
+		int numberOfMeshSpheres; // spheres tessellated by Sphere::getMesh
+		int sphereSegments; // segments in 180 degrees of a mesh sphere
+		int numberOfCylinders; // cylinders made by makeCylinder
+		int cylinderSegments; // segments of the circle of a cylinder
+		int numberOfInstances; // actors sharing a mesh sphere or cylinder
+		int numberOfLights;
+		REAL reflectivity; // specular color of the models
+		uint seed;
+		BVH::BuildOptions bvhOptions;
+
+		// Constructor
+		Parameters():
+			numberOfSpheres(0),
+			numberOfMeshSpheres(0),
+			sphereSegments(16),
+			numberOfCylinders(0),
+			cylinderSegments(16),
+			numberOfInstances(0),
+			numberOfLights(1),
+			reflectivity(0),
+			seed(1)
+		{
+			// do nothing
+		}
+
+	}; // Parameters
+
+	// Constructor
+	SceneGenerator(uint seed = 1):
+		state(seed)
+	{
+		// do nothing
+	}
+
+	Scene* makeScene(const String&, const Parameters&);
+	Camera* makeCamera(REAL) const;
+
+	void addSpheres(Scene&, int, REAL);
+	void addMeshSpheres(Scene&, int, int, REAL);
+	void addCylinders(Scene&, int, int, REAL);
+	void addInstances(Scene&, int, int, int, REAL);
+	void addLights(Scene&, int);
+
+	// Get a pseudo-random number in [0, 1)
+	REAL random()
+	{
+		state = state * 1103515245 + 12345;
+		return (REAL)((state >> 8) & 0xffffff) / 0x1000000;
+	}
+
+	// Get a pseudo-random number in [a, b)
+	REAL random(REAL a, REAL b)
+	{
+		return a + (b - a) * random();
+	}
+
+private:
+	uint state;
+
+	Vec3 randomPoint(REAL);
+	Material* makeMaterial(REAL);
+
+}; // SceneGenerator
+
+} // end namespace Graphics
+
+#endif // __SceneGenerator_h
@@ -20,6 +20,8 @@ using namespace Graphics;
 
 bool Sphere::intersect(const Ray& r, Graphics::IntersectInfo& info) const
 {
+	COUNT_STATISTIC(SphereTests, 1);
+
 	float B = 2 * (r.direction * (r.origin - this->center));
 
 	float C = (r.origin - this->center) * (r.origin - this->center) - (this->radius * this->radius);
@@ -37,13 +39,43 @@ bool Sphere::intersect(const Ray& r, Graphics::IntersectInfo& info) const
 	return false;
 }
 
-Vec3 Sphere::normal(const IntersectInfo& info) const
+int Sphere::intersect(const RayPacket& packet, int mask, PacketHit& hit) const
 {
-	return (info.p - this->center).versor();
+	COUNT_STATISTIC(SphereTests, countLanes(mask));
+
+	// same operations of the single ray intersect(), four lanes at a time
+	Real4 ox = packet.origin[0] - Real4(this->center.x);
+	Real4 oy = packet.origin[1] - Real4(this->center.y);
+	Real4 oz = packet.origin[2] - Real4(this->center.z);
+
+	Real4 B = Real4(2) * (packet.direction[0] * ox + packet.direction[1] * oy + packet.direction[2] * oz);
+
+	Real4 C = (ox * ox + oy * oy + oz * oz) - Real4(this->radius * this->radius);
+
+	Real4 D = B * B - Real4(4.0f) * C;
+
+	Real4 t = (-B - sqrt(D)) / Real4(2.0f);
+
+	mask &= ((D >= Real4(0)) & (t > Real4(0)) & (t < hit.distance)).getMask();
+	if(mask == 0)
+		return 0;
+
+	hit.distance = select(Real4::fromMask(mask), t, hit.distance);
+
+	for(int i = 0; i < RAY_PACKET_SIZE; i++)
+		if(mask & 1 << i)
+		{
+			hit.info[i].distance = t[i];
+			hit.info[i].object = (Model*) this;
+			hit.info[i].p = makeRayPoint(packet.rays[i], t[i]);
+		}
+
+	return mask;
 }
 
-Material* Sphere::getMaterial()
+Vec3 Sphere::normal(const IntersectInfo& info) const
 {
+	return (info.p - this->center).versor();
 }
 
 BoundingBox Sphere::getBoundingBox() const
@@ -51,17 +83,19 @@ BoundingBox Sphere::getBoundingBox() const
 	Vec3 p1 = Vec3( this->center.x - this->radius, this->center.y - this->radius, this->center.z - this->radius );
 	Vec3 p2 = Vec3( this->center.x + this->radius, this->center.y + this->radius, this->center.z + this->radius );
 
-	new BoundingBox( p1 , p2);
+	return BoundingBox(p1, p2);
 }
 
 TriangleMesh* Sphere::getMesh()
 {
-	Vec3 normal;
-	Transf3 m;
+	// the poles are on the X axis; each of the segs - 1 rings between
+	// them has 2 * segs vertices
+	int nr = this->segs - 1;
+	int ns = 2 * this->segs;
 
-	int nv = (this->segs - 1) * (this->segs - 1) + 2;
+	int nv = nr * ns + 2;
 	int nn = nv;
-	int nt = nv * 2 * (this->segs - 1);
+	int nt = 2 * ns * nr;
 
 	// mesh init
 	TriangleMesh::Data data;
@@ -75,83 +109,59 @@ TriangleMesh* Sphere::getMesh()
 	data.numberOfTriangles = nt;
 	data.triangles = new TriangleMesh::Triangle[nt];
 
-	// startPoint is aligned in X axis with center
-	Vec3 startPoint = this->center;
-	startPoint.x += this->radius;
+	// poles
+	data.normals[0] = Vec3(1, 0, 0);
+	data.normals[nv - 1] = Vec3(-1, 0, 0);
 
-	// second point
-	Vec3 p = this->center;
-	p.y += this->radius;
-
-	// first normal is perpendicular with p and startPoint, at the same time (cross product)
-	normal = p.cross(startPoint);
-
-	// gera um meio-crculo
-	// define rotao, com ponto fixo 'center', em relao ao eixo 'normal' em 180/seg graus
-	m.rotation(this->center, normal, Math::toRadians<REAL>(180.0f/this->segs));
-
-	// polos da esfera
-	data.vertices[0] = startPoint;
-	data.vertices[nv-1] = this->center; data.vertices[nv-1].x -= this->radius;
-
-	for(int i = 1; i < this->segs; i++)
-		data.vertices[i] = m.transform(data.vertices[i-1]);
-
-	// agora rotaciona o meio-crulo para gerar a circunferencia
-	normal = (startPoint - this->center);
-
-	Vec3 diff = startPoint - this->center;
-	diff = diff.inverse();
-	REAL invR = diff.length();
-
-	// rotaciona o meio-crculo no eixo contrrio, em 360 graus
-	m.rotation(this->center, normal, Math::toRadians<REAL>(180.0f/(this->segs)));
-
-	for(int j = 1; j < this->segs; j++)
+	// rings: vertex 1 + r * ns + s
+	for(int r = 0; r < nr; r++)
 	{
-		for(int i = this->segs * j; i < (this->segs * j + 1); i++)
+		REAL theta = Math::toRadians<REAL>(180.0f * (r + 1) / this->segs);
+		REAL x = cos(theta);
+		REAL rr = sin(theta);
+
+		for(int s = 0; s < ns; s++)
 		{
-			data.vertices[i] = m.transform(data.vertices[i-this->segs]);
+			REAL phi = Math::toRadians<REAL>(360.0f * s / ns);
 
-			data.normals[i] = (data.vertices[i] - this->center) * invR;
+			data.normals[1 + r * ns + s] = Vec3(x, rr * cos(phi), rr * sin(phi));
 		}
 	}
 
-	data.normals[0] = (data.vertices[0] - this->center) * invR;
-	data.normals[nv - 1] = (data.vertices[0] - this->center).inverse() * invR;
+	for(int i = 0; i < nv; i++)
+		data.vertices[i] = this->center + data.normals[i] * this->radius;
 
 	TriangleMesh::Triangle* t = data.triangles;
 
-	// j so os vrtices, i  a linha da circunferencia
-	for(int j = 1; j < nv - 1; j++)
+	for(int s = 0; s < ns; s++)
 	{
-		t->v[0] = j;
-		t->v[1] = j - this->segs;
-		t->v[1] = j+1;
+		int s1 = (s + 1) % ns;
 
+		// pole triangles
+		t->setVertices(0, 1 + s1, 1 + s);
+		t++;
+		t->setVertices(nv - 1, 1 + (nr - 1) * ns + s, 1 + (nr - 1) * ns + s1);
 		t++;
 
-		t->v[0] = j - this->segs;
-		t->v[1] = j + 1;
-		t->v[2] = j+1-this->segs;
+		// band triangles
+		for(int r = 0; r < nr - 1; r++)
+		{
+			int a = 1 + r * ns;
+			int b = a + ns;
 
-		t++;
+			t->setVertices(a + s, a + s1, b + s);
+			t++;
+			t->setVertices(a + s1, b + s1, b + s);
+			t++;
+		}
 	}
 
-	// triangulos dos polos
-	for(int j = 1; j < this->segs; j++)
+	// one normal per vertex
+	for(int i = 0; i < nt; i++)
 	{
-		// polo zero
-		t->v[0] = 0;
-		t->v[1] = this->segs * j;
-		t->v[2] = this->segs * (j + 1);
-
-		t++;
+		const int* v = data.triangles[i].v;
 
-		// polo nv
-		t->v[0] = nv - 1;
-		t->v[1] = (this->segs - 1) * j;
-		t->v[2] = (this->segs - 1) * (j + 1);
+		data.triangles[i].setNormals(v[0], v[1], v[2]);
 	}
 
 	return new TriangleMesh(data);
@@ -163,5 +173,5 @@ void Sphere::transform(const Transf3& t)
 
 void Sphere::setMaterial(Material* m)
 {
-
+	Primitive::setMaterial(m);
 }
@@ -42,8 +42,8 @@ class Sphere : public Primitive
 		}
 
 		bool intersect(const Ray&, Graphics::IntersectInfo&) const;
+		int intersect(const RayPacket&, int, PacketHit&) const;
 		Vec3 normal(const IntersectInfo&) const;
-		Material* getMaterial();
 		BoundingBox getBoundingBox() const;
 
 		TriangleMesh* getMesh();
@@ -27,7 +27,7 @@
 
 using namespace Graphics;
 
-Vec3*
+inline Vec3*
 makeCircle(const Vec3& center, const Vec3& startPoint, const Vec3& normal, int seg = 10)
 {
 	Vec3* points = new Vec3[seg];
@@ -45,7 +45,7 @@ makeCircle(const Vec3& center, const Vec3& startPoint, const Vec3& normal, int s
 	return points;
 }
 
-TriangleMesh*
+inline TriangleMesh*
 makeCylinder(const Vec3& center, const Vec3& startPoint, const Vec3& normal, REAL height, int seg = 10)
 {
 	Vec3* base = makeCircle(center, startPoint, normal, seg);
@@ -67,9 +67,7 @@ makeCylinder(const Vec3& center, const Vec3& startPoint, const Vec3& normal, REA
 	data.triangles = new TriangleMesh::Triangle[nt];
 
 	Vec3 h = normal * height;
-	Vec3 diff = startPoint - center;
-	diff = diff.inverse();
-	REAL invR = diff.length();
+	REAL invR = Math::inverse<REAL>((startPoint - center).length());
 
 	for(int i = 0; i < seg; i++)
 	{
@@ -78,36 +76,39 @@ makeCylinder(const Vec3& center, const Vec3& startPoint, const Vec3& normal, REA
 
 		data.normals[i] = (base[i] - center) * invR;
 	}
+	delete []base;
 
 	data.normals[seg] = -normal; // bottom
 	data.normals[seg + 1] = normal; // top
 
 	TriangleMesh::Triangle* t = data.triangles;
 
-	for(int j = seg, i = 0; i < seg;)
+	// lados: i no topo, i + seg na base
+	for(int i = 0; i < seg; i++)
 	{
-		t->v[0] = i;
-		t->v[1] = j;
-		t->n[0] = t->n[1] = i;
-
-		// equivalente a (++t).t->n[0]
-		t[1].n[0] = i;
+		int k = (i + 1) % seg;
 
-		t->v[2] = ++i;
-		t->n[2] = i;
+		t->setVertices(i, i + seg, k);
+		t->setNormals(i, i, k);
+		t++;
 
+		t->setVertices(i + seg, k + seg, k);
+		t->setNormals(i, k, k);
 		t++;
+	}
 
-		t->v[0] = j;
-		t->v[1] = ++j;
-		t->v[2] = i;
-		t->n[1] = t->n[2] = i;
+	// tampas
+	for(int i = 1; i < seg - 1; i++)
+	{
+		t->setVertices(0, i, i + 1);
+		t->setNormal(seg + 1);
+		t++;
 
+		t->setVertices(seg, seg + i + 1, seg + i);
+		t->setNormal(seg);
 		t++;
 	}
 
-	// tampas: t em diante
-
 	return new TriangleMesh(data);
 }
 #endif
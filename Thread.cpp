@@ -0,0 +1,224 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                        GVSG Foundation Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+// OVERVIEW: Thread.cpp
+// ========
+// Source file for threads and mutexes.
+
+#ifdef __LINUX
+#include <unistd.h>
+#endif
+
+#ifndef __Thread_h
+#include "Thread.h"
+#endif
+
+using namespace System;
+
+
+//////////////////////////////////////////////////////////
+//
+// Mutex implementation
+// =====
+Mutex::Mutex()
+//[]---------------------------------------------------[]
+//|  Constructor                                        |
+//[]---------------------------------------------------[]
+{
+#ifdef __LINUX
+	pthread_mutex_init(&handle, 0);
+#else
+	InitializeCriticalSection(&handle);
+#endif
+}
+
+Mutex::~Mutex()
+//[]---------------------------------------------------[]
+//|  Destructor                                         |
+//[]---------------------------------------------------[]
+{
+#ifdef __LINUX
+	pthread_mutex_destroy(&handle);
+#else
+	DeleteCriticalSection(&handle);
+#endif
+}
+
+void
+Mutex::lock()
+//[]---------------------------------------------------[]
+//|  Lock                                               |
+//[]---------------------------------------------------[]
+{
+#ifdef __LINUX
+	pthread_mutex_lock(&handle);
+#else
+	EnterCriticalSection(&handle);
+#endif
+}
+
+void
+Mutex::unlock()
+//[]---------------------------------------------------[]
+//|  Unlock                                             |
+//[]---------------------------------------------------[]
+{
+#ifdef __LINUX
+	pthread_mutex_unlock(&handle);
+#else
+	LeaveCriticalSection(&handle);
+#endif
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// Condition implementation
+// =========
+Condition::Condition()
+//[]---------------------------------------------------[]
+//|  Constructor                                        |
+//[]---------------------------------------------------[]
+{
+#ifdef __LINUX
+	pthread_cond_init(&handle, 0);
+#else
+	InitializeConditionVariable(&handle);
+#endif
+}
+
+Condition::~Condition()
+//[]---------------------------------------------------[]
+//|  Destructor                                         |
+//[]---------------------------------------------------[]
+{
+#ifdef __LINUX
+	pthread_cond_destroy(&handle);
+#endif
+}
+
+void
+Condition::wait(Mutex& mutex)
+//[]---------------------------------------------------[]
+//|  Wait                                               |
+//[]---------------------------------------------------[]
+{
+#ifdef __LINUX
+	pthread_cond_wait(&handle, &mutex.handle);
+#else
+	SleepConditionVariableCS(&handle, &mutex.handle, INFINITE);
+#endif
+}
+
+void
+Condition::signal()
+//[]---------------------------------------------------[]
+//|  Signal                                             |
+//[]---------------------------------------------------[]
+{
+#ifdef __LINUX
+	pthread_cond_signal(&handle);
+#else
+	WakeConditionVariable(&handle);
+#endif
+}
+
+void
+Condition::broadcast()
+//[]---------------------------------------------------[]
+//|  Broadcast                                          |
+//[]---------------------------------------------------[]
+{
+#ifdef __LINUX
+	pthread_cond_broadcast(&handle);
+#else
+	WakeAllConditionVariable(&handle);
+#endif
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// Thread implementation
+// ======
+Thread::~Thread()
+//[]---------------------------------------------------[]
+//|  Destructor                                         |
+//[]---------------------------------------------------[]
+{
+	join();
+}
+
+#ifdef __LINUX
+void*
+Thread::entry(void* arg)
+#else
+DWORD WINAPI
+Thread::entry(LPVOID arg)
+#endif
+//[]---------------------------------------------------[]
+//|  Thread entry point                                 |
+//[]---------------------------------------------------[]
+{
+	((Thread*)arg)->run();
+	return 0;
+}
+
+bool
+Thread::start()
+//[]---------------------------------------------------[]
+//|  Start                                              |
+//[]---------------------------------------------------[]
+{
+	if (running)
+		return false;
+#ifdef __LINUX
+	running = pthread_create(&handle, 0, entry, this) == 0;
+#else
+	running = (handle = CreateThread(0, 0, entry, this, 0, 0)) != 0;
+#endif
+	return running;
+}
+
+void
+Thread::join()
+//[]---------------------------------------------------[]
+//|  Join                                               |
+//[]---------------------------------------------------[]
+{
+	if (!running)
+		return;
+#ifdef __LINUX
+	pthread_join(handle, 0);
+#else
+	WaitForSingleObject(handle, INFINITE);
+	CloseHandle(handle);
+#endif
+	running = false;
+}
+
+int
+Thread::getNumberOfProcessors()
+//[]---------------------------------------------------[]
+//|  Get number of processors                           |
+//[]---------------------------------------------------[]
+{
+#ifdef __LINUX
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+
+	long n = info.dwNumberOfProcessors;
+#endif
+	return n > 0 ? (int)n : 1;
+}
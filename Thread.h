@@ -0,0 +1,198 @@
+#ifndef __Thread_h
+#define __Thread_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                        GVSG Foundation Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+// OVERVIEW: Thread.h
+// ========
+// Class definitions for threads and mutexes.
+
+#ifdef __LINUX
+#include <pthread.h>
+#else
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace System
+{ // begin namespace System
+
+
+//////////////////////////////////////////////////////////
+//
+// Mutex: mutual exclusion lock class
+// =====
+class Mutex
+{
+public:
+	// Constructor
+	Mutex();
+
+	// Destructor
+	~Mutex();
+
+	void lock();
+	void unlock();
+
+private:
+#ifdef __LINUX
+	pthread_mutex_t handle;
+#else
+	CRITICAL_SECTION handle;
+#endif
+
+	Mutex(const Mutex&);
+	Mutex& operator =(const Mutex&);
+
+	friend class Condition;
+
+}; // Mutex
+
+
+//////////////////////////////////////////////////////////
+//
+// Condition: condition variable class
+// =========
+class Condition
+{
+public:
+	// Constructor
+	Condition();
+
+	// Destructor
+	~Condition();
+
+	// Unlock the mutex, wait for a signal and lock the mutex again
+	void wait(Mutex&);
+	// Wake up one/all of the waiting threads
+	void signal();
+	void broadcast();
+
+private:
+#ifdef __LINUX
+	pthread_cond_t handle;
+#else
+	CONDITION_VARIABLE handle;
+#endif
+
+	Condition(const Condition&);
+	Condition& operator =(const Condition&);
+
+}; // Condition
+
+
+//////////////////////////////////////////////////////////
+//
+// ScopedLock: mutex guard class
+// ==========
+class ScopedLock
+{
+public:
+	// Constructor
+	ScopedLock(Mutex& m):
+		mutex(m)
+	{
+		mutex.lock();
+	}
+
+	// Destructor
+	~ScopedLock()
+	{
+		mutex.unlock();
+	}
+
+private:
+	Mutex& mutex;
+
+	ScopedLock(const ScopedLock&);
+	ScopedLock& operator =(const ScopedLock&);
+
+}; // ScopedLock
+
+
+//////////////////////////////////////////////////////////
+//
+// Thread: generic thread class
+// ======
+class Thread
+{
+public:
+	// Constructor
+	Thread():
+		running(false)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	virtual ~Thread();
+
+	// Start running the thread
+	bool start();
+
+	// Wait for the thread to finish
+	void join();
+
+	bool isRunning() const
+	{
+		return running;
+	}
+
+	static int getNumberOfProcessors();
+
+protected:
+	// Thread body
+	virtual void run() = 0;
+
+private:
+#ifdef __LINUX
+	pthread_t handle;
+
+	static void* entry(void*);
+#else
+	HANDLE handle;
+
+	static DWORD WINAPI entry(LPVOID);
+#endif
+	bool running;
+
+	Thread(const Thread&);
+	Thread& operator =(const Thread&);
+
+}; // Thread
+
+//
+// Atomic counter ops
+//
+inline int
+atomicIncrement(volatile int& counter)
+{
+#ifdef __LINUX
+	return __sync_add_and_fetch(&counter, 1);
+#else
+	return InterlockedIncrement((volatile LONG*)&counter);
+#endif
+}
+
+inline int
+atomicAdd(volatile int& counter, int value)
+{
+#ifdef __LINUX
+	return __sync_add_and_fetch(&counter, value);
+#else
+	return InterlockedExchangeAdd((volatile LONG*)&counter, value) + value;
+#endif
+}
+
+} // end namespace System
+
+#endif // __Thread_h
@@ -0,0 +1,139 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                        GVSG Foundation Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: TileScheduler.cpp
+//  ========
+//  Source file for work stealing image tile scheduler.
+
+#ifndef __TileScheduler_h
+#include "TileScheduler.h"
+#endif
+
+using namespace Graphics;
+
+
+//////////////////////////////////////////////////////////
+//
+// TileScheduler implementation
+// =============
+TileScheduler::TileScheduler(int w, int h, int size, int workers, int y):
+	W(w),
+	H(h),
+	top(y)
+//[]---------------------------------------------------[]
+//|  Constructor                                        |
+//|  @param image width                                 |
+//|  @param image (or band) height                      |
+//|  @param tile size                                   |
+//|  @param number of workers                           |
+//|  @param first row of the band                       |
+//[]---------------------------------------------------[]
+{
+	tileSize = size > 0 ? size : 1;
+	tilesPerRow = (W + tileSize - 1) / tileSize;
+	numberOfTiles = tilesPerRow * ((H + tileSize - 1) / tileSize);
+	numberOfWorkers = workers > 0 ? workers : 1;
+	queues = new Queue[numberOfWorkers];
+	// each worker starts with a contiguous run of tiles
+	for (int i = 0; i < numberOfWorkers; i++)
+	{
+		queues[i].head = numberOfTiles * i / numberOfWorkers;
+		queues[i].tail = numberOfTiles * (i + 1) / numberOfWorkers;
+	}
+}
+
+TileScheduler::~TileScheduler()
+//[]---------------------------------------------------[]
+//|  Destructor                                         |
+//[]---------------------------------------------------[]
+{
+	delete []queues;
+}
+
+void
+TileScheduler::makeTile(int index, Tile& tile) const
+//[]---------------------------------------------------[]
+//|  Make tile                                          |
+//[]---------------------------------------------------[]
+{
+	tile.x = (index % tilesPerRow) * tileSize;
+	tile.y = (index / tilesPerRow) * tileSize;
+	tile.w = W - tile.x < tileSize ? W - tile.x : tileSize;
+	tile.h = H - tile.y < tileSize ? H - tile.y : tileSize;
+	tile.y += top;
+}
+
+bool
+TileScheduler::pop(int worker, int& index)
+//[]---------------------------------------------------[]
+//|  Pop a tile from the head of the worker's queue     |
+//[]---------------------------------------------------[]
+{
+	Queue& q = queues[worker];
+	ScopedLock guard(q.lock);
+
+	if (q.head >= q.tail)
+		return false;
+	index = q.head++;
+	return true;
+}
+
+bool
+TileScheduler::steal(int worker, int& index)
+//[]---------------------------------------------------[]
+//|  Steal half of the tiles left in another queue      |
+//[]---------------------------------------------------[]
+{
+	for (int i = 1; i < numberOfWorkers; i++)
+	{
+		Queue& victim = queues[(worker + i) % numberOfWorkers];
+		int first;
+		int last;
+
+		{
+			ScopedLock guard(victim.lock);
+
+			if (victim.head >= victim.tail)
+				continue;
+			first = victim.tail - (victim.tail - victim.head + 1) / 2;
+			last = victim.tail;
+			victim.tail = first;
+		}
+		index = first;
+		if (++first < last)
+		{
+			Queue& q = queues[worker];
+			ScopedLock guard(q.lock);
+
+			q.head = first;
+			q.tail = last;
+		}
+		return true;
+	}
+	return false;
+}
+
+bool
+TileScheduler::nextTile(int worker, Tile& tile)
+//[]---------------------------------------------------[]
+//|  Next tile                                          |
+//|  @param worker index                                |
+//|  @param next tile to be rendered (output)           |
+//|  @return false if there are no tiles left           |
+//[]---------------------------------------------------[]
+{
+	int index;
+
+	if (!pop(worker, index) && !steal(worker, index))
+		return false;
+	makeTile(index, tile);
+	return true;
+}
@@ -0,0 +1,105 @@
+#ifndef __TileScheduler_h
+#define __TileScheduler_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                        GVSG Foundation Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: TileScheduler.h
+//  ========
+//  Class definition for work stealing image tile scheduler.
+
+#ifndef __Thread_h
+#include "Thread.h"
+#endif
+
+using namespace System;
+
+namespace Graphics
+{ // begin namespace Graphics
+
+
+//////////////////////////////////////////////////////////
+//
+// Tile: image tile class
+// ====
+struct Tile
+{
+	int x;
+	int y;
+	int w;
+	int h;
+
+}; // Tile
+
+
+//////////////////////////////////////////////////////////
+//
+// TileScheduler: work stealing tile scheduler class
+// =============
+//
+// The image (or the band of its rows starting at a given row) is
+// split into tiles of (at most) tileSize x tileSize pixels. Each
+// worker owns a queue initialized with a contiguous run of tiles; a
+// worker pops tiles from the head of its own queue and, when it runs
+// dry, steals from the tail of another worker's queue, so that
+// expensive regions do not stall the whole frame.
+class TileScheduler
+{
+public:
+	// Constructor
+	TileScheduler(int, int, int, int, int = 0);
+
+	// Destructor
+	~TileScheduler();
+
+	int getNumberOfTiles() const
+	{
+		return numberOfTiles;
+	}
+
+	int getNumberOfWorkers() const
+	{
+		return numberOfWorkers;
+	}
+
+	// Get the next tile to be rendered by a worker
+	bool nextTile(int, Tile&);
+
+private:
+	struct Queue
+	{
+		Mutex lock;
+		int head;
+		int tail;
+
+	}; // Queue
+
+	int W;
+	int H;
+	int top;
+	int tileSize;
+	int tilesPerRow;
+	int numberOfTiles;
+	int numberOfWorkers;
+	Queue* queues;
+
+	void makeTile(int, Tile&) const;
+	bool pop(int, int&);
+	bool steal(int, int&);
+
+	TileScheduler(const TileScheduler&);
+	TileScheduler& operator =(const TileScheduler&);
+
+}; // TileScheduler
+
+} // end namespace Graphics
+
+#endif // __TileScheduler_h
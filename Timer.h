@@ -0,0 +1,79 @@
+#ifndef __Timer_h
+#define __Timer_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                        GVSG Foundation Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+// OVERVIEW: Timer.h
+// ========
+// Class definition for wall clock timer.
+
+#ifdef __LINUX
+#include <sys/time.h>
+#else
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace System
+{ // begin namespace System
+
+
+//////////////////////////////////////////////////////////
+//
+// Timer: wall clock timer class
+// =====
+class Timer
+{
+public:
+	// Constructor
+	Timer()
+	{
+		start();
+	}
+
+	void start()
+	{
+		startTime = now();
+	}
+
+	// Get the time elapsed since start(), in seconds
+	double getElapsedTime() const
+	{
+		return now() - startTime;
+	}
+
+	// Get the current wall clock time, in seconds
+	static double now()
+	{
+#ifdef __LINUX
+		timeval t;
+
+		gettimeofday(&t, 0);
+		return t.tv_sec + t.tv_usec * 1e-6;
+#else
+		LARGE_INTEGER count;
+		LARGE_INTEGER frequency;
+
+		QueryPerformanceCounter(&count);
+		QueryPerformanceFrequency(&frequency);
+		return (double)count.QuadPart / frequency.QuadPart;
+#endif
+	}
+
+private:
+	double startTime;
+
+}; // Timer
+
+} // end namespace System
+
+#endif // __Timer_h
@@ -75,7 +75,7 @@ invert(const REAL m[4][4], REAL c[4][4])
 	REAL m4 = DET3(a2, a3, a4, b2, b3, b4, c2, c3, c4);
 	REAL d;
 
-	if (Math::isZero(d = a1 * m1 + b1 * m2 + c1 * m3 + d1 * m4))
+	if (Math::isZero(d = a1 * m1 - b1 * m2 + c1 * m3 - d1 * m4))
 		return false;
 	d = Math::inverse<REAL>(d);
 	c[0][0] =  m1 * d;
@@ -88,7 +88,7 @@ invert(const REAL m[4][4], REAL c[4][4])
 	c[3][1] =  DET3(a1, a3, a4, b1, b3, b4, c1, c3, c4) * d;
 	c[0][2] =  DET3(b1, b2, b4, c1, c2, c4, d1, d2, d4) * d;
 	c[1][2] = -DET3(a1, a2, a4, c1, c2, c4, d1, d2, d4) * d;
-	c[2][2] =  DET3(a1, a2, a4, b1, b2, b4, d2, d2, d4) * d;
+	c[2][2] =  DET3(a1, a2, a4, b1, b2, b4, d1, d2, d4) * d;
 	c[3][2] = -DET3(a1, a2, a4, b1, b2, b4, c1, c2, c4) * d;
 	c[0][3] = -DET3(b1, b2, b3, c1, c2, c3, d1, d2, d3) * d;
 	c[1][3] =  DET3(a1, a2, a3, c1, c2, c3, d1, d2, d3) * d;
@@ -74,6 +74,7 @@ TriangleMesh::Data::transform(const Transf3& t)
 //|  Transform                                          |
 //[]---------------------------------------------------[]
 {
+	deleteIntersectCache();
 	for (int i = 0; i < numberOfVertices; i++)
 		t.transformRef(vertices[i]);
 	if (normals != 0)
@@ -81,6 +82,34 @@ TriangleMesh::Data::transform(const Transf3& t)
 			t.transformVectorRef(normals[i]);
 }
 
+void
+TriangleMesh::Data::buildIntersectCache()
+//[]---------------------------------------------------[]
+//|  Build intersection cache                           |
+//[]---------------------------------------------------[]
+{
+	if (records == 0)
+		records = new IntersectRecord[numberOfTriangles];
+	for (int i = 0; i < numberOfTriangles; i++)
+	{
+		const int* v = triangles[i].v;
+
+		records[i].v0 = vertices[v[0]];
+		records[i].e1 = vertices[v[1]] - vertices[v[0]];
+		records[i].e2 = vertices[v[2]] - vertices[v[0]];
+	}
+}
+
+void
+TriangleMesh::Data::deleteIntersectCache()
+//[]---------------------------------------------------[]
+//|  Delete intersection cache                          |
+//[]---------------------------------------------------[]
+{
+	delete []records;
+	records = 0;
+}
+
 void
 TriangleMesh::Data::print(FILE* f)
 //[]---------------------------------------------------[]
@@ -249,6 +249,43 @@ public:
 
 	}; // Triangle
 
+	// Precomputed Moller-Trumbore intersection data of a triangle
+	struct IntersectRecord
+	{
+		Vec3 v0;
+		Vec3 e1; // v1 - v0
+		Vec3 e2; // v2 - v0
+
+		bool intersect(const Ray& ray, Vec3& p, REAL& t) const
+		{
+			Vec3 q = ray.direction.cross(e2);
+			REAL det = e1 * q;
+
+			if (det == 0)
+				return false;
+			det = Math::inverse(det);
+
+			Vec3 s = ray.origin - v0;
+			REAL uf = (s * q) * det;
+
+			if (uf < 0 || 1 < uf)
+				return false;
+			s = s.cross(e1);
+
+			REAL vf = (ray.direction * s) * det;
+
+			if (vf < 0 || (uf + vf) > 1)
+				return false;
+			if ((t = (e2 * s) * det) <= Math::zero<REAL>())
+				return false;
+			p[0] = 1 - (uf + vf);
+			p[1] = uf;
+			p[2] = vf;
+			return true;
+		}
+
+	}; // IntersectRecord
+
 	struct Data
 	{
 		int numberOfVertices;
@@ -257,6 +294,8 @@ public:
 		Vec3* normals;
 		int numberOfTriangles;
 		Triangle* triangles;
+		// Optional intersection cache (see buildIntersectCache())
+		IntersectRecord* records;
 
 		// Constructor
 		Data():
@@ -265,19 +304,25 @@ public:
 			numberOfNormals(0),
 			normals(0),
 			numberOfTriangles(0),
-			triangles(0)
+			triangles(0),
+			records(0)
 		{
 			// do nothing
 		}
 
 		bool intersect(int i, const Ray& ray, Vec3& p, REAL& d) const
 		{
+			if (records != 0)
+				return records[i].intersect(ray, p, d);
+
 			Graphics::Triangle t(vertices, triangles[i].v);
 			return t.intersect(ray, p, d);
 		}
 
 		void setMaterial(const Material&);
 		void transform(const Transf3&);
+		void buildIntersectCache();
+		void deleteIntersectCache();
 
 		void print(FILE*);
 
@@ -295,9 +340,10 @@ public:
 	// Destructor
 	~TriangleMesh()
 	{
-		delete data.vertices;
-		delete data.normals;
-		delete data.triangles;
+		delete []data.vertices;
+		delete []data.normals;
+		delete []data.triangles;
+		delete []data.records;
 	}
 
 	const Data& getData() const
@@ -313,6 +359,10 @@ public:
 	{
 		data.transform(t);
 	}
+	void buildIntersectCache()
+	{
+		data.buildIntersectCache();
+	}
 
 protected:
 	Data data;
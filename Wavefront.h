@@ -0,0 +1,373 @@
+#ifndef __Wavefront_h
+#define __Wavefront_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: Wavefront.h
+//  ========
+//  Class definition for wavefront ray queues.
+
+#include <string.h>
+
+#ifndef __DirtyRegion_h
+#include "DirtyRegion.h"
+#endif
+#ifndef __RayStack_h
+#include "RayStack.h"
+#endif
+#ifndef __ReprojectionCache_h
+#include "ReprojectionCache.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+// number of origin cells per axis of the ray sort key
+#define WAVEFRONT_CELLS 4
+#define WAVEFRONT_KEYS (8 * WAVEFRONT_CELLS * WAVEFRONT_CELLS * WAVEFRONT_CELLS)
+
+
+//////////////////////////////////////////////////////////
+//
+// Wavefront: wavefront ray queues class
+// =========
+//
+// Buffers of the wavefront tracing of a tile: the pixel rays of the
+// blocks of the tile are traced as a wave, then the shadow rays of
+// the hits, queued light by light, and then the reflected rays
+// spawned by shading the hits, as the next wave, sorted by direction
+// octant and origin cell for coherence. The path vertices of each
+// block are kept until its path ends, and then combined as by the
+// depth-first evaluation. The capacities fixed by reset() bound the
+// memory used by a thread; the buffers are meant to be used by one
+// thread during one render.
+class Wavefront
+{
+public:
+	enum Stage
+	{
+		Generate, // pixel rays
+		Intersect, // closest hits of a wave
+		Shadow, // shadow rays of the hits
+		Shade, // direct lighting and reflected rays
+		Sort, // reflected rays
+		Combine, // path colors
+		NumberOfStages
+	};
+
+	struct Statistics
+	{
+		double times[NumberOfStages]; // seconds spent in each stage
+		long waves; // number of waves traced
+
+		// Constructor
+		Statistics():
+			waves(0)
+		{
+			for (int i = 0; i < NumberOfStages; i++)
+				times[i] = 0;
+		}
+
+		double getTime() const
+		{
+			double t = 0;
+
+			for (int i = 0; i < NumberOfStages; i++)
+				t += times[i];
+			return t;
+		}
+
+		Statistics& operator +=(const Statistics& s)
+		{
+			for (int i = 0; i < NumberOfStages; i++)
+				times[i] += s.times[i];
+			waves += s.waves;
+			return *this;
+		}
+
+		static const char* getName(Stage);
+
+	}; // Statistics
+
+	// Ray of a wave
+	struct PathRay
+	{
+		Ray ray;
+		REAL weight;
+		int block; // index of the block of the ray
+
+	}; // PathRay
+
+	// Closest hit of a ray of a wave
+	struct Hit
+	{
+		IntersectInfo info;
+		int ray; // index of the ray in the wave
+		Vec3 point;
+		Vec3 normal; // facing the ray
+
+	}; // Hit
+
+	// Shadow ray of a hit
+	struct ShadowRay
+	{
+		Ray ray;
+		REAL maxDistance;
+		int hit; // index of the hit
+
+	}; // ShadowRay
+
+	// Blocks of the tile
+	int numberOfBlocks;
+	int* blockX; // first column of the block
+	int* blockY; // first row of the block
+	ReprojectionCache::Sample* primaryHits;
+	DirtyRegion::Tree* trees;
+	int* depths; // number of vertices spawning a ray
+	Color* colors; // color of the end of the path, then of the block
+	// Wave being traced and next wave
+	int numberOfRays;
+	PathRay* rays;
+	int numberOfSpawned;
+	PathRay* spawned;
+	// Hits of the wave
+	int numberOfHits;
+	Hit* hits;
+	int* shadowed; // bit l set if the hit is shadowed from the light l
+	// Shadow rays of the hits toward a light
+	int numberOfShadowRays;
+	ShadowRay* shadowRays;
+
+	// Constructor
+	Wavefront():
+		numberOfBlocks(0),
+		blockX(0),
+		blockY(0),
+		primaryHits(0),
+		trees(0),
+		depths(0),
+		colors(0),
+		numberOfRays(0),
+		rays(0),
+		numberOfSpawned(0),
+		spawned(0),
+		numberOfHits(0),
+		hits(0),
+		shadowed(0),
+		numberOfShadowRays(0),
+		shadowRays(0),
+		vertices(0),
+		capacity(0),
+		levels(0),
+		keys(0)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	~Wavefront()
+	{
+		release();
+	}
+
+	void reset(int, int);
+
+	int getCapacity() const
+	{
+		return capacity;
+	}
+
+	int getNumberOfLevels() const
+	{
+		return levels;
+	}
+
+	// Get the path vertex of a block at a level
+	RayStack::Vertex& getVertex(int level, int block)
+	{
+		return vertices[level * capacity + block];
+	}
+
+	void sort(const BoundingBox&);
+
+	const Statistics& getStatistics() const
+	{
+		return statistics;
+	}
+
+	void addTime(Stage stage, double time)
+	{
+		statistics.times[stage] += time;
+	}
+
+	void addWave()
+	{
+		statistics.waves++;
+	}
+
+private:
+	RayStack::Vertex* vertices;
+	int capacity;
+	int levels;
+	int* keys; // sort keys of the spawned rays
+	int counts[WAVEFRONT_KEYS];
+	Statistics statistics;
+
+	void release();
+
+	Wavefront(const Wavefront&);
+	Wavefront& operator =(const Wavefront&);
+
+}; // Wavefront
+
+
+//////////////////////////////////////////////////////////
+//
+// Wavefront inline implementation
+// =========
+inline const char*
+Wavefront::Statistics::getName(Stage stage)
+{
+	static const char* names[] =
+	{
+		"generate",
+		"intersect",
+		"shadow",
+		"shade",
+		"sort",
+		"combine"
+	};
+
+	return names[stage];
+}
+
+inline void
+Wavefront::release()
+//[]---------------------------------------------------[]
+//|  Release the buffers                                |
+//[]---------------------------------------------------[]
+{
+	delete []blockX;
+	delete []blockY;
+	delete []primaryHits;
+	delete []trees;
+	delete []depths;
+	delete []colors;
+	delete []rays;
+	delete []spawned;
+	delete []hits;
+	delete []shadowed;
+	delete []shadowRays;
+	delete []vertices;
+	delete []keys;
+	blockX = blockY = depths = shadowed = keys = 0;
+	primaryHits = 0;
+	trees = 0;
+	colors = 0;
+	rays = spawned = 0;
+	hits = 0;
+	shadowRays = 0;
+	vertices = 0;
+}
+
+inline void
+Wavefront::reset(int capacity, int levels)
+//[]---------------------------------------------------[]
+//|  Empty the queues and clear the statistics          |
+//|  @param maximum number of blocks of a tile          |
+//|  @param maximum number of vertices of a path        |
+//[]---------------------------------------------------[]
+{
+	if (capacity != this->capacity || levels != this->levels)
+	{
+		release();
+		blockX = new int[capacity];
+		blockY = new int[capacity];
+		primaryHits = new ReprojectionCache::Sample[capacity];
+		trees = new DirtyRegion::Tree[capacity];
+		depths = new int[capacity];
+		colors = new Color[capacity];
+		rays = new PathRay[capacity];
+		spawned = new PathRay[capacity];
+		hits = new Hit[capacity];
+		shadowed = new int[capacity];
+		shadowRays = new ShadowRay[capacity];
+		vertices = new RayStack::Vertex[capacity * levels];
+		keys = new int[capacity];
+		this->capacity = capacity;
+		this->levels = levels;
+	}
+	numberOfBlocks = numberOfRays = numberOfSpawned = 0;
+	numberOfHits = numberOfShadowRays = 0;
+	statistics = Statistics();
+}
+
+//
+// Auxiliary function
+//
+inline int
+waveCell(REAL x, REAL x1, REAL s)
+{
+	int c = (int)((x - x1) * s);
+
+	return c < 0 ? 0 : c < WAVEFRONT_CELLS ? c : WAVEFRONT_CELLS - 1;
+}
+
+inline void
+Wavefront::sort(const BoundingBox& box)
+//[]---------------------------------------------------[]
+//|  Make the spawned rays the next wave, sorted by     |
+//|  direction octant and then by origin cell           |
+//|  @param bounds of the scene (split into cells)      |
+//|                                                     |
+//|  The rays are counting sorted, so that the ones of  |
+//|  a key keep their order.                            |
+//[]---------------------------------------------------[]
+{
+	const Vec3& p1 = box.getP1();
+	const Vec3& p2 = box.getP2();
+	Vec3 s = p2 - p1;
+
+	s.x = WAVEFRONT_CELLS * Math::inverse(Math::max<REAL>(s.x, 1e-6f));
+	s.y = WAVEFRONT_CELLS * Math::inverse(Math::max<REAL>(s.y, 1e-6f));
+	s.z = WAVEFRONT_CELLS * Math::inverse(Math::max<REAL>(s.z, 1e-6f));
+
+	memset(counts, 0, sizeof(counts));
+	for (int i = 0; i < numberOfSpawned; i++)
+	{
+		const Ray& r = spawned[i].ray;
+		int octant = (r.direction.x < 0) |
+			(r.direction.y < 0) << 1 |
+			(r.direction.z < 0) << 2;
+		int cell = (waveCell(r.origin.x, p1.x, s.x) * WAVEFRONT_CELLS +
+			waveCell(r.origin.y, p1.y, s.y)) * WAVEFRONT_CELLS +
+			waveCell(r.origin.z, p1.z, s.z);
+
+		keys[i] = octant * (WAVEFRONT_KEYS / 8) + cell;
+		counts[keys[i]]++;
+	}
+	for (int k = 0, first = 0; k < WAVEFRONT_KEYS; k++)
+	{
+		int n = counts[k];
+
+		counts[k] = first;
+		first += n;
+	}
+	for (int i = 0; i < numberOfSpawned; i++)
+		rays[counts[keys[i]]++] = spawned[i];
+	numberOfRays = numberOfSpawned;
+	numberOfSpawned = 0;
+}
+
+} // end namespace Graphics
+
+#endif // __Wavefront_h
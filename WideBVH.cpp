@@ -0,0 +1,316 @@
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: WideBVH.cpp
+//  ========
+//  Source file for compressed 4-wide bounding volume hierarchy.
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef __Timer_h
+#include "Timer.h"
+#endif
+#ifndef __WideBVH_h
+#include "WideBVH.h"
+#endif
+
+using namespace Graphics;
+
+#define CACHE_LINE_SIZE 64
+
+//
+// Auxiliary functions
+//
+inline int
+numberOfPieces(int count)
+{
+	return (count + WIDE_BVH_MAX_LEAF_SIZE - 1) / WIDE_BVH_MAX_LEAF_SIZE;
+}
+
+inline int
+numberOfSplitNodes(int pieces)
+{
+	// nodes made by WideBVH::split() for a leaf of that many pieces
+	if (pieces <= 1)
+		return 0;
+
+	int n = Math::min(pieces, WIDE_BVH_WIDTH);
+	int count = 1;
+
+	for (int i = 0; i < n; i++)
+		count += numberOfSplitNodes(pieces / n + (i < pieces % n));
+	return count;
+}
+
+inline float
+floorFloat(REAL x)
+{
+	// the greatest float not greater than x
+	float f = (float)x;
+
+	while (f > x)
+		f = nextafterf(f, -Math::infinity<float>());
+	return f;
+}
+
+inline float
+ceilFloat(REAL x)
+{
+	// the least float not less than x
+	float f = (float)x;
+
+	while (f < x)
+		f = nextafterf(f, Math::infinity<float>());
+	return f;
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// WideBVH implementation
+// =======
+void
+WideBVH::clear()
+//[]---------------------------------------------------[]
+//|  Clear                                              |
+//[]---------------------------------------------------[]
+{
+	delete []buffer;
+	delete []primitives;
+	nodes = 0;
+	buffer = 0;
+	primitives = 0;
+	numberOfNodes = numberOfPrimitives = 0;
+	bounds.setEmpty();
+	quality = BVH::Quality();
+	buildTime = 0;
+}
+
+void
+WideBVH::build(const BVH& bvh)
+//[]---------------------------------------------------[]
+//|  Build                                              |
+//|  @param the BVH to be collapsed                     |
+//[]---------------------------------------------------[]
+{
+	System::Timer timer;
+
+	clear();
+	options = bvh.getBuildOptions();
+	if (bvh.isEmpty())
+		return;
+
+	const BVH::Node* source = bvh.getNodes();
+	int n = bvh.getNumberOfNodes();
+	// a node takes the place of at least one interior node of the
+	// BVH, but for the root and the nodes of split leaves
+	int capacity = 1;
+
+	for (int i = 0; i < n; i++)
+		if (!source[i].isLeaf())
+			capacity++;
+		else if (source[i].count > WIDE_BVH_MAX_LEAF_SIZE)
+			capacity += numberOfSplitNodes(numberOfPieces(source[i].count));
+	buffer = new char[capacity * sizeof(Node) + CACHE_LINE_SIZE - 1];
+	nodes = (Node*)(((size_t)buffer + CACHE_LINE_SIZE - 1) &
+		~(size_t)(CACHE_LINE_SIZE - 1));
+	numberOfNodes = 1;
+	collapse(source, 0, 0);
+	numberOfPrimitives = bvh.getNumberOfPrimitives();
+	primitives = new int[numberOfPrimitives];
+	memcpy(primitives, bvh.getPrimitives(), numberOfPrimitives * sizeof(int));
+	bounds = bvh.getBounds();
+	quality = bvh.getQuality();
+	buildTime = bvh.getBuildTime() + timer.getElapsedTime();
+}
+
+void
+WideBVH::collapse(const BVH::Node* source, int root, int index)
+//[]---------------------------------------------------[]
+//|  Collapse a subtree of a BVH into a node            |
+//|  @param nodes of the BVH                            |
+//|  @param root of the subtree                         |
+//|  @param index of the node                           |
+//|                                                     |
+//|  The children of the node are the children of the   |
+//|  root (or the root itself, if a leaf), whose        |
+//|  interior nodes are replaced by their children,     |
+//|  largest first, until the node is full.             |
+//[]---------------------------------------------------[]
+{
+	int c[WIDE_BVH_WIDTH];
+	int n;
+
+	if (source[root].isLeaf())
+	{
+		c[0] = root;
+		n = 1;
+	}
+	else
+	{
+		c[0] = root + 1;
+		c[1] = source[root].first;
+		n = 2;
+	}
+	while (n < WIDE_BVH_WIDTH)
+	{
+		int largest = -1;
+		REAL area = -1;
+
+		for (int i = 0; i < n; i++)
+			if (!source[c[i]].isLeaf() && source[c[i]].bounds.getArea() > area)
+			{
+				largest = i;
+				area = source[c[i]].bounds.getArea();
+			}
+		if (largest < 0)
+			break;
+
+		int parent = c[largest];
+
+		c[largest] = parent + 1;
+		c[n++] = source[parent].first;
+	}
+
+	BoundingBox childBounds[WIDE_BVH_WIDTH];
+
+	for (int i = 0; i < n; i++)
+		childBounds[i] = source[c[i]].bounds;
+	quantize(nodes[index], source[root].bounds, childBounds, n);
+	// the subtrees of the children follow the node, in order
+	for (int i = 0; i < n; i++)
+	{
+		Node& node = nodes[index];
+		const BVH::Node& child = source[c[i]];
+
+		if (child.isLeaf() && child.count <= WIDE_BVH_MAX_LEAF_SIZE)
+		{
+			node.counts[i] = child.count;
+			node.children[i] = child.first;
+		}
+		else
+		{
+			int k = numberOfNodes++;
+
+			node.counts[i] = 0;
+			node.children[i] = k;
+			if (child.isLeaf())
+				split(child.bounds, child.first, child.count, k);
+			else
+				collapse(source, c[i], k);
+		}
+	}
+}
+
+void
+WideBVH::split(const BoundingBox& box, int first, int count, int index)
+//[]---------------------------------------------------[]
+//|  Split a BVH leaf too large for a node              |
+//|  @param bounds of the leaf                          |
+//|  @param first primitive of the leaf                 |
+//|  @param number of primitives of the leaf            |
+//|  @param index of the node                           |
+//|                                                     |
+//|  The pieces of the leaf are spread over the node    |
+//|  and its descendants, all of them bounded by the    |
+//|  leaf box.                                          |
+//[]---------------------------------------------------[]
+{
+	int pieces = numberOfPieces(count);
+	int n = Math::min(pieces, WIDE_BVH_WIDTH);
+	BoundingBox childBounds[WIDE_BVH_WIDTH];
+
+	for (int i = 0; i < n; i++)
+		childBounds[i] = box;
+	quantize(nodes[index], box, childBounds, n);
+	for (int i = 0; i < n; i++)
+	{
+		Node& node = nodes[index];
+		// pieces of the child
+		int p = pieces / n + (i < pieces % n);
+		int c = Math::min(count, p * WIDE_BVH_MAX_LEAF_SIZE);
+
+		if (p == 1)
+		{
+			node.counts[i] = c;
+			node.children[i] = first;
+		}
+		else
+		{
+			int k = numberOfNodes++;
+
+			node.counts[i] = 0;
+			node.children[i] = k;
+			split(box, first, c, k);
+		}
+		first += c;
+		count -= c;
+	}
+}
+
+void
+WideBVH::quantize(Node& node,
+	const BoundingBox& box,
+	const BoundingBox* childBounds,
+	int n)
+//[]---------------------------------------------------[]
+//|  Set the bounds of a node and of its children       |
+//|  @param the node                                    |
+//|  @param bounds of the node                          |
+//|  @param bounds of the children                      |
+//|  @param number of children                          |
+//|                                                     |
+//|  The lower bounds of the children are rounded down  |
+//|  and the upper ones up, to steps of a power of two  |
+//|  such that 255 steps span the node; the decoded     |
+//|  bounds, origin + q * 2^e, are then exact. Bounds   |
+//|  are rounded outward to floats, and the rounded     |
+//|  ones compared in double, so that the decoded       |
+//|  bounds enclose the original ones whatever the      |
+//|  precision of REAL.                                 |
+//[]---------------------------------------------------[]
+{
+	memset(&node, 0, sizeof(Node));
+	node.numberOfChildren = n;
+	for (int k = 0; k < 3; k++)
+	{
+		float origin = floorFloat(box.getP1()[k]);
+		double top = ceilFloat(box.getP2()[k]);
+		int e;
+
+		// 2^e >= extent / 255
+		frexp(Math::max<double>((top - origin) / 255, 1e-30), &e);
+		while (origin + 255 * ldexp(1.0, e) < top)
+			e++;
+		node.origin[k] = origin;
+		node.exponents[k] = e;
+
+		double step = ldexp(1.0, e);
+
+		for (int i = 0; i < n; i++)
+		{
+			double lower = floorFloat(childBounds[i].getP1()[k]);
+			double upper = ceilFloat(childBounds[i].getP2()[k]);
+			int l = Math::max(0, (int)floor((lower - origin) / step));
+			int u = Math::min(255, (int)ceil((upper - origin) / step));
+
+			// compensate the rounding of the divisions
+			while (l > 0 && origin + l * step > lower)
+				l--;
+			while (u < 255 && origin + u * step < upper)
+				u++;
+			node.lower[k][i] = l;
+			node.upper[k][i] = u;
+		}
+	}
+}
@@ -0,0 +1,633 @@
+#ifndef __WideBVH_h
+#define __WideBVH_h
+
+//[]------------------------------------------------------------------------[]
+//|                                                                          |
+//|                          GVSG Graphics Classes                           |
+//|                               Version 1.0                                |
+//|                                                                          |
+//|                Copyright 2007, Paulo Aristarco Pagliosa                 |
+//|                Copyright 2010, Cauan Gama Cabral                        |
+//|                All Rights Reserved.                                      |
+//|                                                                          |
+//[]------------------------------------------------------------------------[]
+//
+//  OVERVIEW: WideBVH.h
+//  ========
+//  Class definition for compressed 4-wide bounding volume hierarchy.
+
+#ifndef __BVH_h
+#include "BVH.h"
+#endif
+
+namespace Graphics
+{ // begin namespace Graphics
+
+#define WIDE_BVH_WIDTH 4
+#define WIDE_BVH_MAX_LEAF_SIZE 255
+#define WIDE_BVH_STACK_SIZE (4 * BVH_STACK_SIZE)
+#define WIDE_BVH_MAX_INVERSE 1e20f // of a ray direction component
+
+
+//////////////////////////////////////////////////////////
+//
+// WideBVH: compressed 4-wide bounding volume hierarchy class
+// =======
+//
+// Read only copy of a BVH for faster traversal in less memory. The
+// binary tree is collapsed into a tree of 4-wide nodes, each child
+// of a node taking the place of the largest of its descendants which
+// are not leaves, until the node has four children. A node holds the
+// bounds of its children quantized to 8 bits relative to its own
+// bounds, whose lower corner is kept as floats and whose extent is
+// kept as power of two steps per axis (so that the bounds decoded
+// are exact and enclose the original ones), hence a node takes one
+// 64 byte cache line whatever the precision of REAL. The four child
+// boxes of a node are tested against a ray at once with Real4. Nodes
+// are stored in depth-first order and aligned to cache lines.
+//
+// Leaves are kept in the nodes as children referring to ranges of
+// the primitive index array, of up to WIDE_BVH_MAX_LEAF_SIZE
+// primitives; larger leaves of the BVH are split into several.
+class WideBVH
+{
+public:
+	struct Node
+	{
+		float origin[3]; // lower corner of the bounds of the node
+		signed char exponents[3]; // quantization step of an axis is 2^e
+		unsigned char numberOfChildren;
+		unsigned char lower[3][WIDE_BVH_WIDTH]; // child bounds, per axis
+		unsigned char upper[3][WIDE_BVH_WIDTH];
+		unsigned char counts[WIDE_BVH_WIDTH]; // primitives of a leaf child
+		int children[WIDE_BVH_WIDTH]; // child node or first primitive
+		int reserved; // padding to 64 bytes
+
+		bool isLeaf(int i) const
+		{
+			return counts[i] > 0;
+		}
+
+	}; // Node
+
+	// Constructor
+	WideBVH():
+		nodes(0),
+		buffer(0),
+		numberOfNodes(0),
+		primitives(0),
+		numberOfPrimitives(0),
+		buildTime(0)
+	{
+		// do nothing
+	}
+
+	// Destructor
+	~WideBVH()
+	{
+		clear();
+	}
+
+	void build(const BVH&);
+	void clear();
+
+	bool isEmpty() const
+	{
+		return numberOfNodes == 0;
+	}
+
+	int getNumberOfNodes() const
+	{
+		return numberOfNodes;
+	}
+
+	const Node* getNodes() const
+	{
+		return nodes;
+	}
+
+	const int* getPrimitives() const
+	{
+		return primitives;
+	}
+
+	const BoundingBox& getBounds() const
+	{
+		return bounds;
+	}
+
+	// Get the bytes taken by the nodes and primitive indices
+	long getMemorySize() const
+	{
+		return (long)numberOfNodes * sizeof(Node) +
+			(long)numberOfPrimitives * sizeof(int);
+	}
+
+	// Get the options, quality and build time (including the time to
+	// collapse it) of the BVH this one was built from
+	const BVH::BuildOptions& getBuildOptions() const
+	{
+		return options;
+	}
+
+	const BVH::Quality& getQuality() const
+	{
+		return quality;
+	}
+
+	double getBuildTime() const
+	{
+		return buildTime;
+	}
+
+	template <typename Intersector>
+	bool intersect(const Ray&, REAL&, Intersector&) const;
+	template <typename PacketIntersector>
+	int intersect(const RayPacket&, int, Real4&, PacketIntersector&) const;
+	template <typename Intersector>
+	bool occluded(const Ray&, REAL, Intersector&) const;
+	template <typename PacketIntersector>
+	int occluded(const RayPacket&, int, const Real4&, PacketIntersector&) const;
+
+private:
+	Node* nodes;
+	char* buffer; // holding the cache aligned nodes
+	int numberOfNodes;
+	int* primitives;
+	int numberOfPrimitives;
+	BoundingBox bounds;
+	BVH::BuildOptions options;
+	BVH::Quality quality;
+	double buildTime;
+
+	void collapse(const BVH::Node*, int, int);
+	void split(const BoundingBox&, int, int, int);
+	void quantize(Node&, const BoundingBox&, const BoundingBox*, int);
+
+	static void decode(const Node&,
+		int,
+		const Real4&,
+		const Real4&,
+		Real4&,
+		Real4&);
+	static int intersect(const Node&,
+		const Real4*,
+		const Real4*,
+		const Real4&,
+		Real4&);
+	static int intersect(const Node&,
+		const RayPacket&,
+		int,
+		const Real4&,
+		int*,
+		Real4*);
+
+	WideBVH(const WideBVH&);
+	WideBVH& operator =(const WideBVH&);
+
+}; // WideBVH
+
+
+//////////////////////////////////////////////////////////
+//
+// WideBVH inline implementation
+// =======
+inline void
+WideBVH::decode(const Node& node,
+	int axis,
+	const Real4& origin,
+	const Real4& invDirection,
+	Real4& scale,
+	Real4& offset)
+//[]---------------------------------------------------[]
+//|  Set up the slab test of the children of a node     |
+//|  along an axis                                      |
+//|  @param the node                                    |
+//|  @param the axis                                    |
+//|  @param ray origin and inverse direction along the  |
+//|  axis                                               |
+//|  @param ray distance per quantization step (output) |
+//|  @param ray distance to the node origin (output)    |
+//|                                                     |
+//|  The distance to the plane of a quantized bound q   |
+//|  is then q * scale + offset.                        |
+//[]---------------------------------------------------[]
+{
+	union
+	{
+		int i;
+		float f;
+	} step;
+	// a zero direction component is taken as a tiny one of the same
+	// sign, lest its infinite inverse turn q * scale + offset into NaN
+	Real4 inverse = min(max(invDirection, Real4(-WIDE_BVH_MAX_INVERSE)),
+		Real4(WIDE_BVH_MAX_INVERSE));
+
+	// 2^e, built from its bits
+	step.i = (node.exponents[axis] + 127) << 23;
+	scale = Real4(step.f) * inverse;
+	offset = (Real4(node.origin[axis]) - origin) * inverse;
+}
+
+inline int
+WideBVH::intersect(const Node& node,
+	const Real4* origin,
+	const Real4* invDirection,
+	const Real4& distance,
+	Real4& tNear)
+//[]---------------------------------------------------[]
+//|  Ray/child boxes slab test                          |
+//|  @param the node                                    |
+//|  @param ray origin and inverse direction, in every  |
+//|  lane                                               |
+//|  @param distance of the closest hit                 |
+//|  @param distances to the child boxes (output)       |
+//|  @return mask of the children whose boxes the ray   |
+//|  hits not farther than distance                     |
+//[]---------------------------------------------------[]
+{
+	Real4 tFar;
+
+	for (int k = 0; k < 3; k++)
+	{
+		Real4 scale;
+		Real4 offset;
+
+		decode(node, k, origin[k], invDirection[k], scale, offset);
+
+		Real4 t1 = Real4::fromBytes(node.lower[k]) * scale + offset;
+		Real4 t2 = Real4::fromBytes(node.upper[k]) * scale + offset;
+
+		if (k == 0)
+		{
+			tNear = min(t1, t2);
+			tFar = max(t1, t2);
+		}
+		else
+		{
+			tNear = max(tNear, min(t1, t2));
+			tFar = min(tFar, max(t1, t2));
+		}
+	}
+	return ((1 << node.numberOfChildren) - 1) &
+		((tNear <= tFar) & (tFar >= Real4(0)) & (tNear <= distance)).getMask();
+}
+
+inline int
+WideBVH::intersect(const Node& node,
+	const RayPacket& packet,
+	int mask,
+	const Real4& distance,
+	int* masks,
+	Real4* tNear)
+//[]---------------------------------------------------[]
+//|  Packet/child boxes slab tests                      |
+//|  @param the node                                    |
+//|  @param the ray packet                              |
+//|  @param mask of the lanes to be tested              |
+//|  @param distances of the closest hits               |
+//|  @param masks of the lanes which hit the box of     |
+//|  each child not farther than distance (output)      |
+//|  @param distances to the child boxes (output)       |
+//|  @return mask of the children hit by any lane       |
+//[]---------------------------------------------------[]
+{
+	Real4 scale[3];
+	Real4 offset[3];
+	int hit = 0;
+
+	for (int k = 0; k < 3; k++)
+		decode(node,
+			k,
+			packet.origin[k],
+			packet.invDirection[k],
+			scale[k],
+			offset[k]);
+	for (int i = 0; i < node.numberOfChildren; i++)
+	{
+		Real4 t1 = Real4(node.lower[0][i]) * scale[0] + offset[0];
+		Real4 t2 = Real4(node.upper[0][i]) * scale[0] + offset[0];
+		Real4 tFar;
+
+		tNear[i] = min(t1, t2);
+		tFar = max(t1, t2);
+		for (int k = 1; k < 3; k++)
+		{
+			t1 = Real4(node.lower[k][i]) * scale[k] + offset[k];
+			t2 = Real4(node.upper[k][i]) * scale[k] + offset[k];
+			tNear[i] = max(tNear[i], min(t1, t2));
+			tFar = min(tFar, max(t1, t2));
+		}
+		masks[i] = mask & ((tNear[i] <= tFar) &
+			(tFar >= Real4(0)) &
+			(tNear[i] <= distance)).getMask();
+		if (masks[i] != 0)
+			hit |= 1 << i;
+	}
+	return hit;
+}
+
+template <typename Intersector>
+bool
+WideBVH::intersect(const Ray& ray, REAL& distance, Intersector& intersector) const
+//[]---------------------------------------------------[]
+//|  Front-to-back closest hit traversal                |
+//|  @param the ray (input)                             |
+//|  @param distance of the closest hit (input/output)  |
+//|  @param primitive intersector (as in BVH)           |
+//|  @return true if the ray intersects a primitive     |
+//|                                                     |
+//|  The children hit are pushed farthest first, leaves |
+//|  as the complement of their node and slot, and then |
+//|  popped until a node not farther than the closest   |
+//|  hit, testing the leaves on the way.                |
+//[]---------------------------------------------------[]
+{
+	if (numberOfNodes == 0)
+		return false;
+
+	Vec3 d = ray.direction.inverse();
+	Real4 origin[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+	Real4 invDirection[3] = {d.x, d.y, d.z};
+	int stack[WIDE_BVH_STACK_SIZE];
+	REAL stackDistance[WIDE_BVH_STACK_SIZE];
+	int top = 0;
+	int current = 0;
+	bool hit = false;
+
+	for (;;)
+	{
+		const Node& node = nodes[current];
+		Real4 tNear;
+		int mask = intersect(node, origin, invDirection, Real4(distance), tNear);
+		int bottom = top;
+
+		COUNT_STATISTIC(NodeVisits, 1);
+		for (int i = 0; i < WIDE_BVH_WIDTH; i++)
+			if (mask & 1 << i)
+			{
+				REAL t = tNear[i];
+				int k = top++;
+
+				while (k > bottom && stackDistance[k - 1] < t)
+				{
+					stack[k] = stack[k - 1];
+					stackDistance[k] = stackDistance[k - 1];
+					k--;
+				}
+				stack[k] = node.isLeaf(i) ? ~(current << 2 | i) : node.children[i];
+				stackDistance[k] = t;
+			}
+		for (;;)
+		{
+			if (top == 0)
+				return hit;
+
+			int entry = stack[--top];
+
+			if (stackDistance[top] > distance)
+				continue;
+			if (entry >= 0)
+			{
+				current = entry;
+				break;
+			}
+
+			const Node& parent = nodes[~entry >> 2];
+			int i = ~entry & 3;
+			const int* p = primitives + parent.children[i];
+
+			for (int k = 0; k < parent.counts[i]; k++)
+				if (intersector(p[k], distance))
+					hit = true;
+		}
+	}
+}
+
+template <typename PacketIntersector>
+int
+WideBVH::intersect(const RayPacket& packet,
+	int mask,
+	Real4& distance,
+	PacketIntersector& intersector) const
+//[]---------------------------------------------------[]
+//|  Front-to-back closest hit packet traversal         |
+//|  @param the ray packet (input)                      |
+//|  @param mask of the lanes to be traced              |
+//|  @param distances of the closest hits (input/output)|
+//|  @param primitive packet intersector (as in BVH)    |
+//|  @return mask of the lanes which hit a primitive    |
+//|                                                     |
+//|  The children are ordered by the distance of the    |
+//|  nearest lane hitting their boxes.                  |
+//[]---------------------------------------------------[]
+{
+	if (numberOfNodes == 0 || mask == 0)
+		return 0;
+
+	int stack[WIDE_BVH_STACK_SIZE];
+	int stackMask[WIDE_BVH_STACK_SIZE];
+	Real4 stackDistance[WIDE_BVH_STACK_SIZE];
+	REAL key[WIDE_BVH_STACK_SIZE];
+	int top = 0;
+	int current = 0;
+	int hit = 0;
+
+	for (;;)
+	{
+		const Node& node = nodes[current];
+		int masks[WIDE_BVH_WIDTH];
+		Real4 tNear[WIDE_BVH_WIDTH];
+		int children = intersect(node, packet, mask, distance, masks, tNear);
+		int bottom = top;
+
+		COUNT_STATISTIC(PacketNodeVisits, 1);
+		for (int i = 0; i < WIDE_BVH_WIDTH; i++)
+			if (children & 1 << i)
+			{
+				REAL t = Math::infinity<REAL>();
+				int k = top++;
+
+				for (int j = 0; j < RAY_PACKET_SIZE; j++)
+					if (masks[i] & 1 << j)
+						t = Math::min<REAL>(t, tNear[i][j]);
+				while (k > bottom && key[k - 1] < t)
+				{
+					stack[k] = stack[k - 1];
+					stackMask[k] = stackMask[k - 1];
+					stackDistance[k] = stackDistance[k - 1];
+					key[k] = key[k - 1];
+					k--;
+				}
+				stack[k] = node.isLeaf(i) ? ~(current << 2 | i) : node.children[i];
+				stackMask[k] = masks[i];
+				stackDistance[k] = tNear[i];
+				key[k] = t;
+			}
+		for (;;)
+		{
+			if (top == 0)
+				return hit;
+			--top;
+			mask = stackMask[top] & (stackDistance[top] <= distance).getMask();
+			if (mask == 0)
+				continue;
+
+			int entry = stack[top];
+
+			if (entry >= 0)
+			{
+				current = entry;
+				break;
+			}
+
+			const Node& parent = nodes[~entry >> 2];
+			int i = ~entry & 3;
+			const int* p = primitives + parent.children[i];
+
+			for (int k = 0; k < parent.counts[i]; k++)
+				hit |= intersector(p[k], mask, distance);
+		}
+	}
+}
+
+template <typename Intersector>
+bool
+WideBVH::occluded(const Ray& ray, REAL maxDist, Intersector& intersector) const
+//[]---------------------------------------------------[]
+//|  Any hit traversal                                  |
+//|  @param the ray                                     |
+//|  @param distance beyond which hits do not count     |
+//|  @param primitive intersector (as in BVH)           |
+//|  @return true if the ray hits any primitive closer  |
+//|  than maxDist                                       |
+//[]---------------------------------------------------[]
+{
+	if (numberOfNodes == 0)
+		return false;
+
+	Vec3 d = ray.direction.inverse();
+	Real4 origin[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+	Real4 invDirection[3] = {d.x, d.y, d.z};
+	Real4 distance(maxDist);
+	int stack[WIDE_BVH_STACK_SIZE];
+	int top = 0;
+	int current = 0;
+
+	for (;;)
+	{
+		const Node& node = nodes[current];
+		Real4 tNear;
+		int mask = intersect(node, origin, invDirection, distance, tNear);
+
+		COUNT_STATISTIC(NodeVisits, 1);
+		for (int i = 0; i < WIDE_BVH_WIDTH; i++)
+			if (mask & 1 << i)
+				stack[top++] = node.isLeaf(i) ? ~(current << 2 | i) : node.children[i];
+		for (;;)
+		{
+			if (top == 0)
+				return false;
+
+			int entry = stack[--top];
+
+			if (entry >= 0)
+			{
+				current = entry;
+				break;
+			}
+
+			const Node& parent = nodes[~entry >> 2];
+			int i = ~entry & 3;
+			const int* p = primitives + parent.children[i];
+
+			for (int k = 0; k < parent.counts[i]; k++)
+			{
+				REAL t = maxDist;
+
+				if (intersector(p[k], t))
+					return true;
+			}
+		}
+	}
+}
+
+template <typename PacketIntersector>
+int
+WideBVH::occluded(const RayPacket& packet,
+	int mask,
+	const Real4& maxDist,
+	PacketIntersector& intersector) const
+//[]---------------------------------------------------[]
+//|  Any hit packet traversal                           |
+//|  @param the ray packet                              |
+//|  @param mask of the lanes to be traced              |
+//|  @param distances beyond which hits do not count    |
+//|  @param primitive packet intersector (as in BVH)    |
+//|  @return mask of the lanes which hit any primitive  |
+//|  closer than maxDist                                |
+//|                                                     |
+//|  Lanes are retired as soon as they are occluded.    |
+//[]---------------------------------------------------[]
+{
+	if (numberOfNodes == 0 || mask == 0)
+		return 0;
+
+	int stack[WIDE_BVH_STACK_SIZE];
+	int stackMask[WIDE_BVH_STACK_SIZE];
+	int top = 0;
+	int current = 0;
+	int lanes = mask;
+	int occluded = 0;
+
+	for (;;)
+	{
+		const Node& node = nodes[current];
+		int masks[WIDE_BVH_WIDTH];
+		Real4 tNear[WIDE_BVH_WIDTH];
+		int children = intersect(node, packet, mask, maxDist, masks, tNear);
+
+		COUNT_STATISTIC(PacketNodeVisits, 1);
+		for (int i = 0; i < WIDE_BVH_WIDTH; i++)
+			if (children & 1 << i)
+			{
+				stack[top] = node.isLeaf(i) ? ~(current << 2 | i) : node.children[i];
+				stackMask[top++] = masks[i];
+			}
+		for (;;)
+		{
+			if (top == 0)
+				return occluded;
+			--top;
+			if ((mask = stackMask[top] & ~occluded) == 0)
+				continue;
+
+			int entry = stack[top];
+
+			if (entry >= 0)
+			{
+				current = entry;
+				break;
+			}
+
+			const Node& parent = nodes[~entry >> 2];
+			int i = ~entry & 3;
+			const int* p = primitives + parent.children[i];
+
+			for (int k = 0; k < parent.counts[i] && mask != 0; k++)
+			{
+				Real4 distance = maxDist;
+				int hit = intersector(p[k], mask, distance);
+
+				occluded |= hit;
+				mask &= ~hit;
+			}
+			if ((lanes & ~occluded) == 0)
+				return occluded;
+		}
+	}
+}
+
+} // end namespace Graphics
+
+#endif // __WideBVH_h